@@ -13,7 +13,9 @@
 
 #include <avr/wdt.h>
 #include <avr/boot.h>
+#include <avr/pgmspace.h>
 #include <util/atomic.h>
+#include <util/crc16.h>
 #include <util/delay.h>
 
 #include <LUFA/Drivers/USB/USB.h>
@@ -24,6 +26,13 @@
 /** Bootloader special address to start the user application */
 #define COMMAND_STARTAPPLICATION   0xFFFF
 
+/**
+ * Bootloader special address to verify pages written since the last verification,
+ * followed by the number of pages (16 bit) and CRC-16/XMODEM of their content (16 bit).
+ * The application is only started if all written pages have been verified.
+ */
+#define COMMAND_VERIFY             0xFFFE
+
 /** Magic value written to magic_boot_key to jump to application after watchdog reset. */
 #define MAGIC_BOOT_KEY             0xDC42
 
@@ -76,6 +85,157 @@ void application_jump_check() {
     MCUSR = 0;
 }
 
+/**
+ * @brief Page programming state.
+ *
+ * Erase and write of a page run in the background (the bootloader executes from NRWW section),
+ * so that the next page can be received meanwhile.
+ */
+enum flash_state {
+    FLASH_IDLE,
+    FLASH_ERASING,
+    FLASH_WRITING,
+};
+
+static uint8_t flash_state = FLASH_IDLE;
+static uint16_t flash_page_address;
+
+/** Number of pages written since the last verification, and CRC of their content read back from flash. */
+static uint16_t num_written_pages = 0;
+static uint16_t written_pages_crc = 0;
+
+/** Cleared when a page is written, set when written pages are verified. */
+static bool is_image_verified = true;
+
+/**
+ * @brief Advance page programming without blocking, return true if it's idle.
+ */
+static bool flash_task() {
+    if (flash_state == FLASH_IDLE || boot_spm_busy()) {
+        return flash_state == FLASH_IDLE;
+    }
+
+    if (flash_state == FLASH_ERASING) {
+        // the page buffer was filled before erase, which leaves it intact
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+        {
+            boot_page_write(flash_page_address);
+        }
+        flash_state = FLASH_WRITING;
+        return false;
+    }
+
+    // re-enable RWW section and read the page back
+    boot_rww_enable();
+    for (uint8_t i = 0; i < SPM_PAGESIZE; i++) {
+        written_pages_crc = _crc_xmodem_update(written_pages_crc, pgm_read_byte(flash_page_address + i));
+    }
+    num_written_pages++;
+    flash_state = FLASH_IDLE;
+    return true;
+}
+
+/**
+ * @brief Process an output report from the currently selected endpoint (control or OUT) after its address is read.
+ *
+ * Returns false if the report is invalid.
+ */
+static bool process_report(const uint16_t page_address) {
+    bool is_page_address_aligned = !(page_address & (SPM_PAGESIZE - 1));
+
+    // handle "start application" command recognized by the special address
+    if (page_address == COMMAND_STARTAPPLICATION) {
+        if (!is_image_verified) {
+            return false;
+        }
+        run_bootloader = false;
+        return true;
+    }
+
+    // the last written page must be read back before it can be verified
+    while (!flash_task());
+
+    if (page_address == COMMAND_VERIFY) {
+        uint16_t num_pages = Endpoint_Read_16_LE();
+        uint16_t crc = Endpoint_Read_16_LE();
+        is_image_verified = num_pages == num_written_pages && crc == written_pages_crc;
+        num_written_pages = 0;
+        written_pages_crc = 0;
+        return is_image_verified;
+    }
+
+    // reject otherwise invalid addresses
+    if (!(page_address < BOOT_START_ADDR && is_page_address_aligned)) {
+        return false;
+    }
+    is_image_verified = false;
+
+    // fill flash page buffer word by word, comparing it with the current content
+    bool is_page_changed = false;
+    for (uint8_t page_word = 0; page_word < (SPM_PAGESIZE / 2); page_word++)
+    {
+        if (!Endpoint_BytesInEndpoint())
+        {
+            Endpoint_ClearOUT();
+            while (!Endpoint_IsOUTReceived());
+        }
+
+        uint16_t word_address = page_address + ((uint16_t)page_word << 1);
+        uint16_t word = Endpoint_Read_16_LE();
+        is_page_changed |= pgm_read_word(word_address) != word;
+        boot_page_fill(word_address, word);
+    }
+
+    flash_page_address = page_address;
+    if (!is_page_changed) {
+        // skip erase and write, the page buffer is discarded by re-enabling RWW section in flash_task,
+        // and the page is read back and counted as if it was written
+        flash_state = FLASH_WRITING;
+        return true;
+    }
+
+    // erase the page, it's written once erase completes, see flash_task
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+        boot_page_erase(page_address);
+    }
+    flash_state = FLASH_ERASING;
+    return true;
+}
+
+/**
+ * @brief Receive output reports streamed through the OUT endpoint.
+ *
+ * The endpoint is only read when page programming is idle. Until then, the host keeps sending
+ * the next report into the endpoint banks, so programming and transfer of consecutive pages overlap.
+ */
+static void process_out_endpoint() {
+    if (USB_DeviceState != DEVICE_STATE_Configured || !flash_task()) {
+        return;
+    }
+
+    Endpoint_SelectEndpoint(HID_OUT_EPADDR);
+    if (!Endpoint_IsOUTReceived()) {
+        return;
+    }
+
+    uint8_t packet_size = Endpoint_BytesInEndpoint();
+    uint16_t page_address = Endpoint_Read_16_LE();
+    if (!process_report(page_address)) {
+        Endpoint_StallTransaction();
+    }
+
+    // some hosts pad command reports to the full report size, skip the rest up to the short packet ending them
+    if (page_address >= COMMAND_VERIFY) {
+        while (packet_size == HID_OUT_EPSIZE) {
+            Endpoint_ClearOUT();
+            while (!Endpoint_IsOUTReceived());
+            packet_size = Endpoint_BytesInEndpoint();
+        }
+    }
+    Endpoint_ClearOUT();
+}
+
 int main() {
     // disable watchdog that may have been started by application
     wdt_disable();
@@ -89,8 +249,7 @@ int main() {
     GlobalInterruptEnable();
 
     while (run_bootloader) {
-        // this is the body of USB_DeviceTask without switching between endpoints,
-        // since we don't use any endpoints other than 0 (control endpoint)
+        // this is the body of USB_DeviceTask, followed by servicing the OUT endpoint
         if (USB_DeviceState == DEVICE_STATE_Unattached) {
             continue;
         }
@@ -100,9 +259,13 @@ int main() {
         if (Endpoint_IsSETUPReceived()) {
             USB_Device_ProcessControlRequest();
         }
+
+        process_out_endpoint();
     }
 
-    // wait a short time to end all USB transactions and then disconnect from USB bus
+    // finish programming of the last page, wait a short time to end all USB transactions
+    // and then disconnect from USB bus
+    while (!flash_task());
     _delay_us(1000);
     USB_Detach();
 
@@ -119,12 +282,15 @@ void EVENT_USB_Device_ConfigurationChanged() {
     // setup HID report endpoint, it has to be configured even though it's not used
     // all incoming requests will be NAKed
     Endpoint_ConfigureEndpoint(HID_IN_EPADDR, EP_TYPE_INTERRUPT, HID_IN_EPSIZE, 1);
+    // double-banked, so that a packet can be received while the other one is read
+    Endpoint_ConfigureEndpoint(HID_OUT_EPADDR, EP_TYPE_INTERRUPT, HID_OUT_EPSIZE, 2);
 }
 
 /**
  * @brief Event handler called by LUFA to respond to application-specific USB Control request.
  *
- * The bootloader should respond to HID SetReport requests used to program flash memory.
+ * The bootloader should respond to HID SetReport requests used to program flash memory,
+ * in case the host doesn't use the OUT endpoint, and to GetReport requests for page CRCs.
  */
 void EVENT_USB_Device_ControlRequest() {
     // ignore any requests that aren't directed to the HID interface
@@ -142,55 +308,32 @@ void EVENT_USB_Device_ControlRequest() {
             // wait until the command has been sent by the host
             while (!(Endpoint_IsOUTReceived()));
 
-            // read in the write destination address, and determine if it's aligned to page size
-            uint16_t page_address = Endpoint_Read_16_LE();
-            bool is_page_address_aligned = !(page_address & (SPM_PAGESIZE - 1));
-
-            // handle "start application" command recognized by the special address
-            if (page_address == COMMAND_STARTAPPLICATION)
-            {
-                run_bootloader = false;
-            }
-            // reject otherwise invalid addresses
-            else if (!(page_address < BOOT_START_ADDR && is_page_address_aligned)) {
+            if (!process_report(Endpoint_Read_16_LE())) {
                 Endpoint_StallTransaction();
             }
-            else
-            {
-                // erase the given flash page
-                ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
-                {
-                    boot_page_erase(page_address);
-                    boot_spm_busy_wait();
-                }
 
-                // write flash page byte by byte
-                for (uint8_t page_word = 0; page_word < (SPM_PAGESIZE / 2); page_word++)
-                {
-                    if (!Endpoint_BytesInEndpoint())
-                    {
-                        Endpoint_ClearOUT();
-                        while (!Endpoint_IsOUTReceived());
-                    }
-
-                    // write the next data word to flash
-                    boot_page_fill(page_address + ((uint16_t)page_word << 1), Endpoint_Read_16_LE());
-                }
+            // finish transaction
+            Endpoint_ClearOUT();
+            Endpoint_ClearStatusStage();
+            break;
 
-                // write the filled flash page to memory
-                ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
-                {
-                    boot_page_write(page_address);
-                    boot_spm_busy_wait();
+        case HID_REQ_GetReport:
+            if (USB_ControlRequest.bmRequestType == (REQDIR_DEVICETOHOST | REQTYPE_CLASS | REQREC_INTERFACE)) {
+                // reply with CRC of each application page, so that the host only sends pages which differ
+                uint16_t page_crcs[APP_NUM_PAGES];
+                while (!flash_task());
+                for (uint8_t page = 0; page < APP_NUM_PAGES; page++) {
+                    uint16_t crc = 0;
+                    for (uint8_t i = 0; i < SPM_PAGESIZE; i++) {
+                        crc = _crc_xmodem_update(crc, pgm_read_byte(page * SPM_PAGESIZE + i));
+                    }
+                    page_crcs[page] = crc;
                 }
 
-                // re-enable RWW section
-                boot_rww_enable();
+                Endpoint_ClearSETUP();
+                Endpoint_Write_Control_Stream_LE(page_crcs, sizeof(page_crcs));
+                Endpoint_ClearOUT();
             }
-
-            // finish transaction
-            Endpoint_ClearOUT();
-            Endpoint_ClearStatusStage();
             break;
     }
 }
@@ -16,7 +16,10 @@
 /** Bootloader only has/needs one USB interface. */
 #define INTERFACE_ID 0
 
-/** HID class report descriptor. Only contains the vendor-defined report used to program the device. */
+/**
+ * HID class report descriptor. Only contains the vendor-defined report used to program the device:
+ * an output report with page address and content, and a feature report with CRC of each application page.
+ */
 const USB_Descriptor_HIDReport_Datatype_t HIDReport[] =
 {
     HID_RI_USAGE_PAGE(16, HID_VENDOR_PAGE),
@@ -27,6 +30,8 @@ const USB_Descriptor_HIDReport_Datatype_t HIDReport[] =
         HID_RI_REPORT_SIZE(8, 0x08),
         HID_RI_REPORT_COUNT(16, (sizeof(uint16_t) + SPM_PAGESIZE)),
         HID_RI_OUTPUT(8, HID_IOF_DATA | HID_IOF_VARIABLE | HID_IOF_ABSOLUTE | HID_IOF_NON_VOLATILE),
+        HID_RI_REPORT_COUNT(16, (sizeof(uint16_t) * APP_NUM_PAGES)),
+        HID_RI_FEATURE(8, HID_IOF_CONSTANT | HID_IOF_VARIABLE | HID_IOF_ABSOLUTE | HID_IOF_NON_VOLATILE),
     HID_RI_END_COLLECTION(0),
 };
 
@@ -65,6 +70,7 @@ typedef struct {
     USB_Descriptor_Interface_t            HID_Interface;
     USB_HID_Descriptor_HID_t              HID_VendorHID;
     USB_Descriptor_Endpoint_t             HID_ReportINEndpoint;
+    USB_Descriptor_Endpoint_t             HID_ReportOUTEndpoint;
 } USB_Descriptor_Configuration_t;
 
 /** Minimal required USB Configuration descriptor for this application. */
@@ -90,7 +96,7 @@ const USB_Descriptor_Configuration_t ConfigurationDescriptor =
             .InterfaceNumber        = INTERFACE_ID,
             .AlternateSetting       = 0x00,
 
-            .TotalEndpoints         = 1,
+            .TotalEndpoints         = 2,
 
             .Class                  = HID_CSCP_HIDClass,
             .SubClass               = HID_CSCP_NonBootSubclass,
@@ -119,6 +125,16 @@ const USB_Descriptor_Configuration_t ConfigurationDescriptor =
             .EndpointSize           = HID_IN_EPSIZE,
             .PollingIntervalMS      = 0x05
         },
+
+    .HID_ReportOUTEndpoint =
+        {
+            .Header                 = {.Size = sizeof(USB_Descriptor_Endpoint_t), .Type = DTYPE_Endpoint},
+
+            .EndpointAddress        = HID_OUT_EPADDR,
+            .Attributes             = (EP_TYPE_INTERRUPT | ENDPOINT_ATTR_NO_SYNC | ENDPOINT_USAGE_DATA),
+            .EndpointSize           = HID_OUT_EPSIZE,
+            .PollingIntervalMS      = 0x01
+        },
 };
 
 /** Called by LUFA to get different kinds of descriptors for this device/application. */
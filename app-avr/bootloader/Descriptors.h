@@ -8,8 +8,17 @@
 
 #include <LUFA/Drivers/USB/USB.h>
 
+/** Number of flash pages available to the application, i.e. located before the bootloader. */
+#define APP_NUM_PAGES  (BOOT_START_ADDR / SPM_PAGESIZE)
+
 /** Endpoint address of the HID data IN endpoint. */
 #define HID_IN_EPADDR  (ENDPOINT_DIR_IN | 1)
 
-/** Size in bytes of the HID reporting IN endpoint. */
-#define HID_IN_EPSIZE  64
+/** Size in bytes of the HID reporting IN endpoint. It's unused, so it's small to leave DPRAM for the OUT endpoint. */
+#define HID_IN_EPSIZE  8
+
+/** Endpoint address of the HID data OUT endpoint, hosts send output reports through it instead of control requests. */
+#define HID_OUT_EPADDR (ENDPOINT_DIR_OUT | 2)
+
+/** Size in bytes of the HID OUT endpoint. It's double-banked, so the banks hold most of a page report. */
+#define HID_OUT_EPSIZE 64
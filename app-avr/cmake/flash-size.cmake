@@ -0,0 +1,48 @@
+# This CMake function fails the build when an executable doesn't fit into its flash region.
+# The same file is run in script mode as the post-build step (cmake -P), it measures the flash image
+# (.text and .data initializers) from its lowest to its highest address, so a region which doesn't start
+# at 0 (the bootloader section) is measured correctly.
+
+if(CMAKE_SCRIPT_MODE_FILE)
+
+    set(bin_file ${ELF_FILE}.size.bin)
+    execute_process(
+        COMMAND ${AVR_OBJCOPY} -j .text -j .data -O binary ${ELF_FILE} ${bin_file}
+        RESULT_VARIABLE result
+    )
+    if(NOT result EQUAL 0)
+        message(FATAL_ERROR "Failed to extract flash image of ${ELF_FILE}")
+    endif()
+
+    # file(SIZE) requires CMake 3.14
+    file(READ ${bin_file} image HEX)
+    file(REMOVE ${bin_file})
+    string(LENGTH "${image}" image_hex_length)
+    math(EXPR image_size "${image_hex_length} / 2")
+
+    if(image_size GREATER MAX_SIZE)
+        # remove the ELF file so that the next build links (and checks) it again
+        file(REMOVE ${ELF_FILE})
+        message(FATAL_ERROR "${ELF_FILE} takes ${image_size} bytes of flash, only ${MAX_SIZE} bytes are available")
+    endif()
+    message(STATUS "${ELF_FILE} takes ${image_size} of ${MAX_SIZE} bytes of flash")
+
+else()
+
+    set(FLASH_SIZE_SCRIPT ${CMAKE_CURRENT_LIST_FILE})
+
+    function(avr_check_flash_size EXECUTABLE_NAME MAX_SIZE)
+        set(elf_file ${${EXECUTABLE_NAME}_ELF_TARGET})
+        add_custom_command(
+            TARGET ${elf_file}
+            POST_BUILD
+            COMMAND
+                ${CMAKE_COMMAND}
+                    -DELF_FILE=$<TARGET_FILE:${elf_file}>
+                    -DAVR_OBJCOPY=${AVR_OBJCOPY}
+                    -DMAX_SIZE=${MAX_SIZE}
+                    -P ${FLASH_SIZE_SCRIPT}
+        )
+    endfunction(avr_check_flash_size)
+
+endif()
@@ -35,23 +35,24 @@
  */
 
 #include "Mouse.h"
+#include "reporting.h"
 #include "spi.h"
+#include "spi_commands.h"
 
 /** Indicates what report mode the host has requested, true for normal HID reporting mode, \c false for special boot
  *  protocol reporting mode.
  */
 static bool UsingReportProtocol = true;
 
-/** Current Idle period. This is set by the host via a Set Idle HID class request to silence the device's reports
- *  for either the entire idle duration, or until the report status changes (e.g. the user moves the mouse).
- */
-static uint16_t IdleCount = 0;
+/** Report type in the high byte of wValue of Get Report request. */
+#define HID_REPORT_TYPE_INPUT 1
+#define HID_REPORT_TYPE_FEATURE 3
 
-/** Current Idle period remaining. When the IdleCount value is set, this tracks the remaining number of idle
- *  milliseconds. This is separate to the IdleCount timer and is incremented and compared as the host may request
- *  the current idle period via a Get Idle HID class request, thus its value must be preserved.
- */
-static uint16_t IdleMSRemaining = 0;
+/** Number of 10 us steps to wait for the previous message to be forwarded, longer than nRF flash page erase. */
+#define MESSAGE_WAIT_STEPS 50000
+
+/** Number of 10 us steps to wait for the data stage of a control request, same as the library stream timeout. */
+#define CONTROL_OUT_WAIT_STEPS (USB_STREAM_TIMEOUT_MS * 100)
 
 
 /** Main program entry point. This routine configures the hardware required by the application, then
@@ -67,7 +68,10 @@ int main(void)
     {
         wdt_reset();
         spi_task();
+        reporting_task();
+        hid_report_descriptor_cache_task();
         USB_USBTask();
+        IdleWhileSuspended();
     }
 }
 
@@ -80,6 +84,70 @@ void SetupHardware(void)
     /* Hardware Initialization */
     USB_DeviceState = DEVICE_STATE_Unattached;
     init_spi();
+
+    /* Enumerate right away with the cached report descriptor, SPI master only uploads it if it differs */
+    if (load_hid_report_descriptor())
+        USB_Init();
+}
+
+/** Keeps the SPI link running until the previous message (or DFU chunk) is forwarded to nRF. The host is NAKed
+ *  meanwhile, which paces it to the SPI link. Returns false if nRF does not respond in time.
+ */
+static bool WaitForMessageForwarded(void)
+{
+    for (uint16_t step = 0; is_message_pending() && step < MESSAGE_WAIT_STEPS; step++)
+    {
+        wdt_reset();
+        spi_task();
+        _delay_us(10);
+    }
+
+    /* Reporting has selected the report endpoint meanwhile, the request continues on the control endpoint */
+    Endpoint_SelectEndpoint(ENDPOINT_CONTROLEP);
+
+    return !is_message_pending();
+}
+
+/** Waits for the data stage of the current control request. Returns false if the host does not send it in time,
+ *  aborts the request with a new SETUP, or the device is detached.
+ */
+static bool WaitForControlOUT(void)
+{
+    for (uint16_t step = 0; !Endpoint_IsOUTReceived(); step++)
+    {
+        if (step >= CONTROL_OUT_WAIT_STEPS || Endpoint_IsSETUPReceived() ||
+            USB_DeviceState == DEVICE_STATE_Unattached)
+        {
+            return false;
+        }
+        _delay_us(10);
+    }
+    return true;
+}
+
+/** Puts the CPU into idle sleep while the host has suspended the bus and there is nothing left to do, which cuts
+ *  the current draw in standby (the library has already frozen the USB clock). Any interrupt wakes the CPU up:
+ *  USB resume or reset, or CS pin change and SPI transfer when nRF talks to us, e.g. to request remote wakeup.
+ */
+void IdleWhileSuspended(void)
+{
+    if (USB_DeviceState != DEVICE_STATE_Suspended || is_hid_report_descriptor_cache_pending())
+        return;
+
+    set_sleep_mode(SLEEP_MODE_IDLE);
+    cli();
+
+    /* A transaction may have ended since the SPI task ran. Otherwise interrupts are enabled by the instruction
+     * right before sleep, so that an interrupt arriving in between wakes the CPU up instead of being missed. */
+    if (!is_spi_task_pending())
+    {
+        sleep_enable();
+        sei();
+        sleep_cpu();
+        sleep_disable();
+    }
+
+    sei();
 }
 
 /** Event handler for the USB_Connect event. This indicates that the device is enumerating via the status LEDs and
@@ -115,9 +183,44 @@ void EVENT_USB_Device_ControlRequest(void)
     switch (USB_ControlRequest.bRequest)
     {
         case HID_REQ_GetReport:
-            if (USB_ControlRequest.bmRequestType == (REQDIR_DEVICETOHOST | REQTYPE_CLASS | REQREC_INTERFACE))
+            if (USB_ControlRequest.bmRequestType == (REQDIR_DEVICETOHOST | REQTYPE_CLASS | REQREC_INTERFACE) &&
+                (USB_ControlRequest.wValue >> 8) == HID_REPORT_TYPE_INPUT)
             {
-                // TBD
+                /* Reply with the last report state, unknown reports are left to the library to stall */
+                uint8_t size;
+                const uint8_t* report = get_last_report(USB_ControlRequest.wValue & 0xFF, &size);
+                if (report)
+                {
+                    Endpoint_ClearSETUP();
+
+                    Endpoint_Write_Control_Stream_LE(report, MIN(size, USB_ControlRequest.wLength));
+                    Endpoint_ClearOUT();
+                }
+            }
+            else if (USB_ControlRequest.bmRequestType == (REQDIR_DEVICETOHOST | REQTYPE_CLASS | REQREC_INTERFACE) &&
+                     USB_ControlRequest.wValue == ((HID_REPORT_TYPE_FEATURE << 8) | HID_REPORTID_DFU) &&
+                     USB_ControlRequest.wLength >= 1)
+            {
+                Endpoint_ClearSETUP();
+
+                Endpoint_Write_8(HID_REPORTID_DFU);
+                Endpoint_Write_Control_Stream_LE(get_dfu_status(),
+                                                 MIN(sizeof(struct avr_link_dfu_status), USB_ControlRequest.wLength - 1));
+                Endpoint_ClearOUT();
+            }
+            else if (USB_ControlRequest.bmRequestType == (REQDIR_DEVICETOHOST | REQTYPE_CLASS | REQREC_INTERFACE) &&
+                     USB_ControlRequest.wValue == ((HID_REPORT_TYPE_FEATURE << 8) | HID_REPORTID_APP_CHANNEL) &&
+                     USB_ControlRequest.wLength == 2 + AVR_LINK_APP_MESSAGE_MAX_SIZE)
+            {
+                uint8_t reply[AVR_LINK_APP_MESSAGE_MAX_SIZE] = {};
+                uint8_t size = read_reply(reply);
+
+                Endpoint_ClearSETUP();
+
+                Endpoint_Write_8(HID_REPORTID_APP_CHANNEL);
+                Endpoint_Write_8(size);
+                Endpoint_Write_Control_Stream_LE(reply, sizeof(reply));
+                Endpoint_ClearOUT();
             }
 
             break;
@@ -129,7 +232,11 @@ void EVENT_USB_Device_ControlRequest(void)
                 Endpoint_ClearSETUP();
 
                 // wait until the command has been sent by the host
-                while (!(Endpoint_IsOUTReceived()));
+                if (!WaitForControlOUT())
+                {
+                    Endpoint_StallTransaction();
+                    break;
+                }
 
                 Endpoint_Discard_8(); // discard report ID (already checked the value from SETUP transfer)
                 if (Endpoint_Read_8() == ENTER_BOOTLOADER_KEY) {
@@ -147,6 +254,58 @@ void EVENT_USB_Device_ControlRequest(void)
                     Endpoint_StallTransaction();
                 }
             }
+            else if (USB_ControlRequest.bmRequestType == (REQDIR_HOSTTODEVICE | REQTYPE_CLASS | REQREC_INTERFACE) &&
+                     (USB_ControlRequest.wValue & 0xFF) == HID_REPORTID_DFU &&
+                     USB_ControlRequest.wLength == 1 + sizeof(struct avr_link_dfu_chunk))
+            {
+                if (!WaitForMessageForwarded())
+                {
+                    /* nRF does not respond, the request is left to the library to stall */
+                    break;
+                }
+
+                Endpoint_ClearSETUP();
+
+                // wait until the report has been sent by the host
+                if (!WaitForControlOUT())
+                {
+                    Endpoint_StallTransaction();
+                    break;
+                }
+
+                struct avr_link_dfu_chunk chunk;
+                Endpoint_Discard_8(); // discard report ID (already checked the value from SETUP transfer)
+                Endpoint_Read_Control_Stream_LE(&chunk, sizeof(chunk));
+                Endpoint_ClearStatusStage();
+
+                post_dfu_chunk(&chunk);
+            }
+            else if (USB_ControlRequest.bmRequestType == (REQDIR_HOSTTODEVICE | REQTYPE_CLASS | REQREC_INTERFACE) &&
+                     USB_ControlRequest.wValue == ((HID_REPORT_TYPE_FEATURE << 8) | HID_REPORTID_APP_CHANNEL) &&
+                     USB_ControlRequest.wLength == 2 + AVR_LINK_APP_MESSAGE_MAX_SIZE)
+            {
+                if (!WaitForMessageForwarded())
+                {
+                    break;
+                }
+
+                Endpoint_ClearSETUP();
+
+                // wait until the report has been sent by the host
+                if (!WaitForControlOUT())
+                {
+                    Endpoint_StallTransaction();
+                    break;
+                }
+
+                uint8_t message[1 + AVR_LINK_APP_MESSAGE_MAX_SIZE];
+                Endpoint_Discard_8(); // discard report ID (already checked the value from SETUP transfer)
+                Endpoint_Read_Control_Stream_LE(message, sizeof(message));
+                Endpoint_ClearStatusStage();
+
+                // a message of invalid size is dropped
+                post_message(message[0], message + 1);
+            }
 
             break;
         case HID_REQ_GetProtocol:
@@ -180,7 +339,7 @@ void EVENT_USB_Device_ControlRequest(void)
                 Endpoint_ClearStatusStage();
 
                 /* Get idle period in MSB, must multiply by 4 to get the duration in milliseconds */
-                IdleCount = ((USB_ControlRequest.wValue & 0xFF00) >> 6);
+                set_report_idle_period((USB_ControlRequest.wValue & 0xFF00) >> 6);
             }
 
             break;
@@ -190,7 +349,7 @@ void EVENT_USB_Device_ControlRequest(void)
                 Endpoint_ClearSETUP();
 
                 /* Write the current idle duration to the host, must be divided by 4 before sent to host */
-                Endpoint_Write_8(IdleCount >> 2);
+                Endpoint_Write_8(get_report_idle_period() >> 2);
 
                 Endpoint_ClearIN();
                 Endpoint_ClearStatusStage();
@@ -203,7 +362,6 @@ void EVENT_USB_Device_ControlRequest(void)
 /** Event handler for the USB device Start Of Frame event. */
 void EVENT_USB_Device_StartOfFrame(void)
 {
-    /* One millisecond has elapsed, decrement the idle time remaining counter if it has not already elapsed */
-    if (IdleMSRemaining)
-      IdleMSRemaining--;
+    /* One millisecond has elapsed, advance the idle timer */
+    report_idle_tick();
 }
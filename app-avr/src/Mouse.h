@@ -41,6 +41,7 @@
         #include <avr/wdt.h>
         #include <avr/power.h>
         #include <avr/interrupt.h>
+        #include <avr/sleep.h>
         #include <stdbool.h>
         #include <string.h>
 
@@ -57,6 +58,7 @@
 
     /* Function Prototypes: */
         void SetupHardware(void);
+        void IdleWhileSuspended(void);
         void Mouse_Task(void);
 
         void EVENT_USB_Device_Connect(void);
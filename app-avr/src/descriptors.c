@@ -11,7 +11,10 @@
  *  the device's capabilities and functions.
  */
 
+#include <avr/eeprom.h>
+
 #include <app_bootloader_interface.h>
+#include <avr_link.h>
 
 #include "descriptors.h"
 
@@ -58,7 +61,7 @@ static USB_Descriptor_Configuration_t configuration_descriptor =
 
             .ConfigurationNumber    = 1,
             .ConfigurationStrIndex  = NO_DESCRIPTOR,
-            .ConfigAttributes       = (USB_CONFIG_ATTR_RESERVED | USB_CONFIG_ATTR_SELFPOWERED),
+            .ConfigAttributes       = (USB_CONFIG_ATTR_RESERVED | USB_CONFIG_ATTR_SELFPOWERED | USB_CONFIG_ATTR_REMOTEWAKEUP),
             .MaxPowerConsumption    = USB_CONFIG_POWER_MA(CURRENT_CONSUMPTION_MA)
         },
 
@@ -96,7 +99,7 @@ static USB_Descriptor_Configuration_t configuration_descriptor =
             .EndpointAddress        = MOUSE_EPADDR,
             .Attributes             = (EP_TYPE_INTERRUPT | ENDPOINT_ATTR_NO_SYNC | ENDPOINT_USAGE_DATA),
             .EndpointSize           = MOUSE_EPSIZE,
-            .PollingIntervalMS      = 0x05
+            .PollingIntervalMS      = 0x01  // full-speed interrupt endpoints can be polled every frame
         }
 };
 
@@ -105,8 +108,9 @@ static USB_Descriptor_Configuration_t configuration_descriptor =
  */
 #define REPORT_DESCRIPTOR_MAX_SIZE 256
 
-// The full Report descriptor consists of two parts: the Device Control report and the Application report.
-// The Device Control report is used to put the AVR into bootloader mode, and it uses report ID 8.
+// The full Report descriptor consists of two parts: the Device Control reports and the Application report.
+// The Device Control reports are used to put the AVR into bootloader mode (report ID 8), to update
+// nRF firmware (report ID 9) and to talk to nRF application (report ID 10).
 // The Application report is obtained from SPI master, and may define reports 0-7.
 // Since the Device Control report has known size, it is put first, and the Application report follows it in memory.
 #define DEVICE_CONTROL_REPORT_DESCRIPTOR { \
@@ -120,6 +124,16 @@ static USB_Descriptor_Configuration_t configuration_descriptor =
         HID_RI_REPORT_SIZE(8, 0x08), /* 8 bits */ \
         HID_RI_REPORT_COUNT(16, 1), \
         HID_RI_OUTPUT(8, HID_IOF_DATA | HID_IOF_VARIABLE | HID_IOF_ABSOLUTE | HID_IOF_NON_VOLATILE), \
+        /* nRF firmware update report */ \
+        HID_RI_REPORT_ID(8, HID_REPORTID_DFU), \
+        HID_RI_REPORT_COUNT(16, sizeof(struct avr_link_dfu_chunk)), \
+        HID_RI_OUTPUT(8, HID_IOF_DATA | HID_IOF_VARIABLE | HID_IOF_ABSOLUTE | HID_IOF_NON_VOLATILE), \
+        HID_RI_REPORT_COUNT(16, sizeof(struct avr_link_dfu_status)), \
+        HID_RI_FEATURE(8, HID_IOF_CONSTANT | HID_IOF_VARIABLE | HID_IOF_ABSOLUTE | HID_IOF_NON_VOLATILE), \
+        /* application channel report */ \
+        HID_RI_REPORT_ID(8, HID_REPORTID_APP_CHANNEL), \
+        HID_RI_REPORT_COUNT(16, 1 + AVR_LINK_APP_MESSAGE_MAX_SIZE), \
+        HID_RI_FEATURE(8, HID_IOF_DATA | HID_IOF_VARIABLE | HID_IOF_ABSOLUTE | HID_IOF_NON_VOLATILE), \
     HID_RI_END_COLLECTION(0), \
     HID_RI_REPORT_ID(8, 0), /* restore current report ID to 0 */ \
 }
@@ -134,22 +148,117 @@ static USB_Descriptor_Configuration_t configuration_descriptor =
  */
 static uint8_t hid_report_desc[REPORT_DESCRIPTOR_MAX_SIZE] = DEVICE_CONTROL_REPORT_DESCRIPTOR;
 
-void set_hid_report_size(uint8_t size) {
-    uint16_t full_size = DEVICE_CONTROL_REPORT_SIZE + (uint16_t)size;
+/**
+ * @brief Size of the Application report descriptor received so far.
+ */
+static uint8_t app_report_desc_size = 0;
+
+#define APP_REPORT_DESCRIPTOR_MAX_SIZE (REPORT_DESCRIPTOR_MAX_SIZE - DEVICE_CONTROL_REPORT_SIZE)
+
+/**
+ * @brief Whether the Application report descriptor is complete, and its hash.
+ */
+static bool is_app_report_desc_committed = false;
+static uint16_t app_report_desc_hash;
+
+/**
+ * @brief Application report descriptor cached in EEPROM, so that USB can be enabled on power-up.
+ *
+ * The header is invalidated before data is written, and is written last, so that a partially written
+ * cache is never loaded. Erased EEPROM has size 0xFF, which is invalid.
+ */
+static struct {
+    uint8_t size;
+    uint16_t hash;
+} EEMEM cache_header;
+static uint8_t EEMEM cache_data[APP_REPORT_DESCRIPTOR_MAX_SIZE];
+
+/**
+ * @brief Progress of writing the cache, see @ref hid_report_descriptor_cache_task.
+ *
+ * Index 0 invalidates the header, indices up to the descriptor size write data, then hash and size follow.
+ */
+static int16_t cache_write_idx = -1;
+
+void set_hid_report_size(bool append, uint8_t size) {
+    uint16_t app_size = (append ? app_report_desc_size : 0) + (uint16_t)size;
+    uint16_t full_size = DEVICE_CONTROL_REPORT_SIZE + app_size;
     if (USB_DeviceState == DEVICE_STATE_Unattached && full_size <= REPORT_DESCRIPTOR_MAX_SIZE) {
+        app_report_desc_size = app_size;
         configuration_descriptor.HID_MouseHID.HIDReportLength = full_size;
     }
 }
 
-void get_hid_report_descriptor_buffer(uint8_t* size, uint8_t** data) {
+void get_hid_report_descriptor_buffer(bool append, uint8_t* size, uint8_t** data) {
+    if (is_app_report_desc_committed) {
+        // the descriptor is going to change, so stop using it
+        USB_Disable();
+        is_app_report_desc_committed = false;
+        cache_write_idx = -1;
+    }
     if (USB_DeviceState == DEVICE_STATE_Unattached) {
-        *size = REPORT_DESCRIPTOR_MAX_SIZE - DEVICE_CONTROL_REPORT_SIZE;
-        *data = hid_report_desc + DEVICE_CONTROL_REPORT_SIZE;
+        uint8_t offset = append ? app_report_desc_size : 0;
+        *size = REPORT_DESCRIPTOR_MAX_SIZE - DEVICE_CONTROL_REPORT_SIZE - offset;
+        *data = hid_report_desc + DEVICE_CONTROL_REPORT_SIZE + offset;
     } else {
         *size = 0;
     }
 }
 
+void commit_hid_report_descriptor() {
+    app_report_desc_hash = avr_link_crc16(hid_report_desc + DEVICE_CONTROL_REPORT_SIZE, app_report_desc_size);
+    is_app_report_desc_committed = true;
+    cache_write_idx = 0;
+}
+
+bool load_hid_report_descriptor() {
+    uint8_t size = eeprom_read_byte(&cache_header.size);
+    if (size > APP_REPORT_DESCRIPTOR_MAX_SIZE) {
+        return false;
+    }
+    uint8_t* app_report_desc = hid_report_desc + DEVICE_CONTROL_REPORT_SIZE;
+    eeprom_read_block(app_report_desc, cache_data, size);
+    uint16_t hash = eeprom_read_word(&cache_header.hash);
+    if (avr_link_crc16(app_report_desc, size) != hash) {
+        return false;
+    }
+    set_hid_report_size(false, size);
+    app_report_desc_hash = hash;
+    is_app_report_desc_committed = true;
+    return true;
+}
+
+bool get_hid_report_descriptor_hash(uint16_t* hash) {
+    *hash = app_report_desc_hash;
+    return is_app_report_desc_committed;
+}
+
+void hid_report_descriptor_cache_task() {
+    // one byte at a time, so that the main loop is not blocked by EEPROM writes (3.4 ms each)
+    if (cache_write_idx < 0 || !eeprom_is_ready()) {
+        return;
+    }
+    uint8_t* app_report_desc = hid_report_desc + DEVICE_CONTROL_REPORT_SIZE;
+    if (cache_write_idx == 0) {
+        eeprom_update_byte(&cache_header.size, 0xFF);
+    } else if (cache_write_idx <= app_report_desc_size) {
+        eeprom_update_byte(&cache_data[cache_write_idx - 1], app_report_desc[cache_write_idx - 1]);
+    } else if (cache_write_idx == app_report_desc_size + 1) {
+        eeprom_update_byte((uint8_t*) &cache_header.hash, app_report_desc_hash & 0xFF);
+    } else if (cache_write_idx == app_report_desc_size + 2) {
+        eeprom_update_byte((uint8_t*) &cache_header.hash + 1, app_report_desc_hash >> 8);
+    } else {
+        eeprom_update_byte(&cache_header.size, app_report_desc_size);
+        cache_write_idx = -1;
+        return;
+    }
+    cache_write_idx++;
+}
+
+bool is_hid_report_descriptor_cache_pending() {
+    return cache_write_idx >= 0;
+}
+
 /** Language descriptor structure. This descriptor, located in FLASH memory, is returned when the host requests
  *  the string descriptor with index 0 (the first index). It is actually an array of 16-bit integers, which indicate
  *  via the language ID table available at USB.org what languages the device supports for its string descriptors.
@@ -6,6 +6,7 @@
 
 #pragma once
 
+#include <stdbool.h>
 #include <stdint.h>
 
     /* Includes: */
@@ -27,6 +28,21 @@
          */
         #define HID_REPORTID_DEVICE_CONTROL 8  // reports 0-7 are reserved for nRF application
 
+        /**
+         * @brief HID Report ID for nRF firmware update.
+         *
+         * The output report carries struct avr_link_dfu_chunk, the feature report struct avr_link_dfu_status.
+         */
+        #define HID_REPORTID_DFU 9
+
+        /**
+         * @brief HID Report ID for the application channel between the host and nRF.
+         *
+         * The feature report carries message size followed by message data, in both directions.
+         * Reading a report of zero size means there is no reply yet.
+         */
+        #define HID_REPORTID_APP_CHANNEL 10
+
     /* Type Defines: */
         /** Type define for the device configuration descriptor structure. This must be defined in the
          *  application code, as the configuration descriptor contains several sub-descriptors which
@@ -62,5 +78,43 @@
             STRING_ID_Product      = 2, /**< Product string ID */
         };
 
-void set_hid_report_size(uint8_t size);
-void get_hid_report_descriptor_buffer(uint8_t* size, uint8_t** data);
+/**
+ * @brief Set size of the Application report descriptor, or extend it by @p size bytes if @p append is true.
+ */
+void set_hid_report_size(bool append, uint8_t size);
+
+/**
+ * @brief Get a buffer to receive (or to append to, if @p append is true) the Application report descriptor.
+ *
+ * If the descriptor is in use, USB is disabled first.
+ */
+void get_hid_report_descriptor_buffer(bool append, uint8_t* size, uint8_t** data);
+
+/**
+ * @brief Mark the Application report descriptor as complete, before USB is enabled with it.
+ *
+ * The descriptor is then written to EEPROM by @ref hid_report_descriptor_cache_task.
+ */
+void commit_hid_report_descriptor();
+
+/**
+ * @brief Load the Application report descriptor cached in EEPROM, return true if it's valid.
+ *
+ * The descriptor is committed if loaded.
+ */
+bool load_hid_report_descriptor();
+
+/**
+ * @brief Get CRC-16 of the Application report descriptor, return false if it's not committed.
+ */
+bool get_hid_report_descriptor_hash(uint16_t* hash);
+
+/**
+ * @brief Write the committed Application report descriptor to EEPROM in the background.
+ */
+void hid_report_descriptor_cache_task();
+
+/**
+ * @brief Check if @ref hid_report_descriptor_cache_task has bytes left to write.
+ */
+bool is_hid_report_descriptor_cache_pending();
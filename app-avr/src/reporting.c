@@ -1,19 +1,152 @@
 #include "reporting.h"
 
-#include <stddef.h>
+#include <string.h>
 
 #include <LUFA/Drivers/USB/USB.h>
+#include <util/atomic.h>
+#include <hid_report_struct.h>
 
 #include "descriptors.h"
 
-void send_report(const uint8_t size, const uint8_t* data) {
+// the host polls every 1 ms, so this absorbs a few ms of jitter between SPI master and the host
+#define REPORT_QUEUE_SIZE 4
+
+static uint8_t queue[REPORT_QUEUE_SIZE][MOUSE_EPSIZE];
+static uint8_t queue_sizes[REPORT_QUEUE_SIZE];
+static uint8_t queue_head = 0;
+static uint8_t queue_count = 0;
+
+static struct avr_link_report_stats stats;
+
+// last report written to the endpoint, with relative values cleared, i.e. current state as seen by the host
+static uint8_t last_report[MOUSE_EPSIZE];
+static uint8_t last_report_size = 0;
+
+// idle period set by the host, 0 means infinity (report only on change)
+static uint16_t idle_period_ms = 0;
+static volatile uint16_t idle_ms_remaining = 0;
+
+static bool is_mouse_report(const uint8_t size, const uint8_t* data) {
+    // only the mouse report layout is known, the report ID is followed by the report itself
+    return size == 1 + sizeof(struct hid_report) && data[0] == HID_REPORT_ID;
+}
+
+static bool is_report_endpoint_ready() {
     if (USB_DeviceState != DEVICE_STATE_Configured) {
-        return;
+        return false;
     }
     Endpoint_SelectEndpoint(MOUSE_EPADDR);
+    return Endpoint_IsReadWriteAllowed();
+}
+
+static void write_report(const uint8_t size, const uint8_t* data) {
+    Endpoint_Write_Stream_LE(data, size, NULL);
+    Endpoint_ClearIN();
+
+    if (data != last_report) {
+        memcpy(last_report, data, size);
+        last_report_size = size;
+        if (is_mouse_report(size, data)) {
+            clear_non_persistent_data_in_report((struct hid_report*) (last_report + 1));
+        }
+    }
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        idle_ms_remaining = idle_period_ms;
+    }
+}
+
+/**
+ * @brief Check if the report carries no change compared to what the host has already got.
+ */
+static bool is_duplicate_report(const uint8_t size, const uint8_t* data) {
+    // cached report has relative values cleared, so an equal report has no motion either;
+    // reports of unknown layout may carry relative values, so they are never considered duplicates
+    return is_mouse_report(size, data) && size == last_report_size && !memcmp(data, last_report, size);
+}
+
+/**
+ * @brief Merge relative values of a report into a queued one, return false if the reports can't be merged.
+ */
+static bool merge_report(uint8_t* into, const uint8_t size, const uint8_t* data) {
+    if (!is_mouse_report(size, data) || into[0] != HID_REPORT_ID) {
+        return false;
+    }
+    merge_hid_reports((struct hid_report*) (into + 1), (const struct hid_report*) (data + 1));
+    return true;
+}
+
+bool is_report_queue_ready() {
+    return USB_DeviceState == DEVICE_STATE_Configured && queue_count < REPORT_QUEUE_SIZE - 1;
+}
+
+void queue_report(const uint8_t size, const uint8_t* data) {
+    if (!size || size > MOUSE_EPSIZE) {
+        return;
+    }
+    if (!queue_count && is_duplicate_report(size, data)) {
+        // the host is reminded about the state once idle period elapses
+        return;
+    }
+    if (!queue_count && is_report_endpoint_ready()) {
+        write_report(size, data);
+        return;
+    }
+    stats.busy++;
+
+    if (queue_count == REPORT_QUEUE_SIZE) {
+        stats.overflows++;
+        uint8_t last = (queue_head + queue_count - 1) % REPORT_QUEUE_SIZE;
+        // if the reports can't be merged, the newer one is dropped
+        merge_report(queue[last], size, data);
+        return;
+    }
+    uint8_t tail = (queue_head + queue_count) % REPORT_QUEUE_SIZE;
+    memcpy(queue[tail], data, size);
+    queue_sizes[tail] = size;
+    queue_count++;
+}
+
+void reporting_task() {
+    if (USB_DeviceState != DEVICE_STATE_Configured) {
+        // host won't get the reports anymore
+        queue_count = 0;
+        last_report_size = 0;
+        return;
+    }
+    if (queue_count && is_report_endpoint_ready()) {
+        write_report(queue_sizes[queue_head], queue[queue_head]);
+        queue_head = (queue_head + 1) % REPORT_QUEUE_SIZE;
+        queue_count--;
+    } else if (!queue_count && last_report_size && idle_period_ms && !idle_ms_remaining && is_report_endpoint_ready()) {
+        write_report(last_report_size, last_report);
+    }
+}
+
+void set_report_idle_period(const uint16_t period_ms) {
+    idle_period_ms = period_ms;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        idle_ms_remaining = period_ms;
+    }
+}
+
+uint16_t get_report_idle_period() {
+    return idle_period_ms;
+}
+
+void report_idle_tick() {
+    if (idle_ms_remaining) {
+        idle_ms_remaining--;
+    }
+}
 
-    if (Endpoint_IsReadWriteAllowed()) {
-        Endpoint_Write_Stream_LE(data, size, NULL);
-        Endpoint_ClearIN();
+const uint8_t* get_last_report(const uint8_t report_id, uint8_t* size) {
+    if (!last_report_size || last_report[0] != report_id) {
+        return NULL;
     }
+    *size = last_report_size;
+    return last_report;
+}
+
+const struct avr_link_report_stats* get_report_stats() {
+    return &stats;
 }
@@ -1,5 +1,50 @@
 #pragma once
 
+#include <stdbool.h>
 #include <stdint.h>
 
-void send_report(uint8_t size, const uint8_t* data);
+#include <avr_link.h>
+
+/**
+ * @brief Check if the report queue can accept a report without merging it.
+ *
+ * One slot is kept in reserve for a report sent by SPI master before it learns that the queue is filling up.
+ */
+bool is_report_queue_ready();
+
+/**
+ * @brief Queue a report to be sent to the host.
+ *
+ * The report is written to the IN endpoint right away if it's free. When the queue is full,
+ * relative values of the report are merged into the last queued one.
+ */
+void queue_report(uint8_t size, const uint8_t* data);
+
+/**
+ * @brief Write the oldest queued report to the IN endpoint once it's free.
+ */
+void reporting_task();
+
+const struct avr_link_report_stats* get_report_stats();
+
+/**
+ * @brief Set idle period requested by the host with Set_Idle, 0 for infinity.
+ *
+ * A report which doesn't change the state is not sent, unless the idle period elapses,
+ * in which case the last report is repeated.
+ */
+void set_report_idle_period(uint16_t period_ms);
+
+uint16_t get_report_idle_period();
+
+/**
+ * @brief Advance idle timer by 1 ms, called on Start-of-Frame.
+ */
+void report_idle_tick();
+
+/**
+ * @brief Get the last report with given ID as seen by the host (relative values cleared), for Get_Report.
+ *
+ * Returns NULL if no such report was sent.
+ */
+const uint8_t* get_last_report(uint8_t report_id, uint8_t* size);
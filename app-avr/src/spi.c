@@ -4,26 +4,65 @@
 
 #include <avr/io.h>
 #include <avr/interrupt.h>
-#include <avr/wdt.h>
-#include <util/delay.h>
-#include <util/crc16.h>
+#include <util/atomic.h>
+
+#include <avr_link.h>
 
 #include "spi_commands.h"
 
 #define PIN_IRQ PB4
 #define DDR_IRQ DDRB
 
-// number of remaining bytes to send/receive
-static uint8_t num_tx = 0;
-static uint8_t num_rx = 0;
-// data buffers
-static const uint8_t* tx_data;  // first byte not included as it's sent right away
-static uint8_t* rx_data;
-// index to the buffer
-static uint8_t tx_idx = 0;
-static uint8_t rx_idx = 0;
-
-static uint8_t tx_crc = 0;
+// Data is transferred by SPI_STC_vect, the main loop only prepares and processes frames between transactions.
+//
+// SPI is single-buffered in the TX direction: the next byte can only be written to SPDR once the current byte
+// is clocked, and must be written before the master starts clocking the next one. In mode 3 that is half
+// of SCK period after the last sampling edge. The vector therefore writes a pre-staged byte before anything
+// else, in a naked prologue, and only then jumps to the C body, which stores RX and stages the following byte.
+// A compiler-generated prologue would save every register the body uses (about a dozen push instructions)
+// before the write.
+//
+// Worst-case latency from the end of a byte to the SPDR write, at 16 MHz (cycles from the instruction set manual
+// and the datasheet, the instructions are the ones written below):
+//   4 cycles   wake-up from idle sleep (while USB is suspended, see IdleWhileSuspended), or completing
+//              the current instruction when awake (3 cycles at most, call/ret/reti)
+//   5 cycles   interrupt response, pushing PC
+//   3 cycles   jmp from the vector table
+//   2 cycles   push r24
+//   2 cycles   lds r24, next_tx_byte
+//   1 cycle    out SPDR, r24
+// giving 17 cycles, i.e. 1.06 us. The master clocks bytes back-to-back, so half of SCK period must exceed it:
+//   500 kHz    1 us half-period (16 cycles), NOT sustainable
+//   250 kHz    2 us half-period (32 cycles), sustainable with 15 cycles (0.94 us) to spare, which covers
+//              the short ATOMIC_BLOCKs of the main loop (a 16-bit store)
+//   125 kHz    4 us half-period (64 cycles), sustainable even if interrupts are disabled for ~40 cycles
+// Any other ISR running when a byte ends delays the write past the window. The only other frequent interrupt
+// is USB Start-of-Frame (every 1 ms), so it is masked while CS is low. Remaining USB interrupts (suspend,
+// reset etc.) are rare, a byte they corrupt is detected with frame CRC.
+
+enum spi_state {
+    SPI_STATE_DISARMED,   // frame is not staged yet or the previous transaction is not processed yet
+    SPI_STATE_HANDSHAKE,  // waiting for the handshake byte
+    SPI_STATE_VERSION,    // waiting for the protocol version byte
+    SPI_STATE_FRAME,      // exchanging frames
+    SPI_STATE_IGNORE,     // handshake or version mismatch, ignore the rest of the transaction
+};
+
+// frames exchanged in a transaction, see avr_link.h
+// TX is double-buffered, so that a frame can be prepared while the previous one is still staged
+static uint8_t tx_frames[2][AVR_LINK_FRAME_MAX_SIZE];
+static uint8_t rx_frame[AVR_LINK_FRAME_MAX_SIZE];
+static uint8_t* volatile tx_frame = tx_frames[0];
+static volatile uint8_t tx_size = 0;  // size of the staged frame, 0 if not prepared
+
+// shared with ISRs
+static volatile uint8_t state = SPI_STATE_DISARMED;
+static volatile uint8_t completed_state;  // state at the end of the transaction to be processed
+static volatile uint8_t next_tx_byte = 0;  // written to SPDR as soon as the current byte is clocked
+static volatile uint8_t tx_idx = 0;
+static volatile uint8_t rx_idx = 0;
+static volatile bool is_transaction_done = false;
+static uint8_t sof_interrupt_enable = 0;
 
 void init_spi() {
     // set C6 low and make it an output -- this enables MISO voltage divider
@@ -34,9 +73,28 @@ void init_spi() {
     DDRB = 0;
 }
 
+/**
+ * @brief Assert or release IRQ line.
+ *
+ * IRQ is active low. It is never driven high, because the AVR runs at higher voltage than the master,
+ * instead it is released and pulled up by the master.
+ */
+static inline void set_irq_asserted(bool asserted) {
+    if (asserted) {
+        DDR_IRQ |= (1 << PIN_IRQ);
+    } else {
+        DDR_IRQ &= ~(1 << PIN_IRQ);
+    }
+}
+
+static inline uint8_t is_cs_high() {
+    return PINB & (1 << PB0);
+}
+
 static void enable_spi() {
     DDRB |= 1 << PB3;  // set B3 (MISO) as output
     SPCR = 0
+        | (1 << SPIE)  // enable transfer complete interrupt
         | (1 << SPE)   // enable SPI
         | (0 << MSTR)  // slave mode
         | (0 << DORD)  // MSB is transmitted first
@@ -44,70 +102,122 @@ static void enable_spi() {
         | (1 << CPHA)  // sample on trailing edge
     ;
 
-    // set IRQ as output low
-    DDR_IRQ |= (1 << PIN_IRQ);
-}
+    // CS (B0) is PCINT0, it marks transaction start and end
+    PCMSK0 |= 1 << PCINT0;
+    PCICR |= 1 << PCIE0;
 
-static inline uint8_t is_cs_high() {
-    return PINB & (1 << PB0);
+    // status is not known by the master yet, so IRQ is asserted right away (this is also used for presence detection)
+    set_irq_asserted(true);
 }
 
-static inline uint8_t get_next_tx_byte() {
-    if (tx_idx < num_tx) {
-        uint8_t next_byte = tx_data[tx_idx++];
-        tx_crc = _crc_ibutton_update(tx_crc, next_byte);
-        return next_byte;
-    }
-    return tx_crc;
+// The vector only writes the staged byte, r24 is restored and SREG is not affected, so the body starts with
+// the registers of the interrupted code and returns to it with reti.
+ISR(SPI_STC_vect, ISR_NAKED) {
+    asm volatile(
+        "push r24"          "\n\t"
+        "lds r24, %[next]"  "\n\t"
+        "out %[spdr], r24"  "\n\t"
+        "pop r24"           "\n\t"
+        "jmp __vector_spi_stc_body"
+        :
+        : [next] "i" (&next_tx_byte), [spdr] "I" (_SFR_IO_ADDR(SPDR))
+    );
 }
 
-static inline void store_rx_byte(const uint8_t value) {
-    if (rx_idx < num_rx) {
-        rx_data[rx_idx++] = value;
+// __vector prefix makes it a regular ISR to the compiler, it's entered by a jump from SPI_STC_vect only
+ISR(__vector_spi_stc_body) {
+    uint8_t rx_byte = SPDR;
+
+    switch (state) {
+        case SPI_STATE_HANDSHAKE:
+            if (rx_byte == AVR_LINK_HANDSHAKE_TX) {
+                state = SPI_STATE_VERSION;
+                // goes out with the first frame byte, as the byte after the version is already being clocked
+                next_tx_byte = tx_frame[0];
+                tx_idx = 1;
+            } else {
+                state = SPI_STATE_IGNORE;
+                next_tx_byte = 0;
+            }
+            break;
+        case SPI_STATE_VERSION:
+            state = rx_byte == AVR_LINK_VERSION ? SPI_STATE_FRAME : SPI_STATE_IGNORE;
+            next_tx_byte = tx_idx < tx_size ? tx_frame[tx_idx++] : 0;
+            break;
+        case SPI_STATE_FRAME:
+            if (rx_idx < sizeof(rx_frame)) {
+                rx_frame[rx_idx++] = rx_byte;
+            }
+            next_tx_byte = tx_idx < tx_size ? tx_frame[tx_idx++] : 0;
+            break;
+        default:
+            // transactions are ignored while disarmed, the master sees a failed handshake and retries
+            next_tx_byte = 0;
+            break;
     }
 }
 
-static inline uint8_t wait_for_rx_byte() {
-    // wait for up to 1 ms to receive
-    uint16_t wait_counter = 1000;
-    while (!(SPSR & (1 << SPIF)) && wait_counter--) {
-        _delay_us(1);
+ISR(PCINT0_vect) {
+    if (is_cs_high()) {
+        UDIEN |= sof_interrupt_enable;
+        if (state != SPI_STATE_DISARMED) {
+            // keep the frames intact until the main loop processes them
+            completed_state = state;
+            state = SPI_STATE_DISARMED;
+            is_transaction_done = true;
+        }
+        SPDR = 0;
+    } else {
+        // the SOF ISR would delay SPI_STC_vect past the SPDR write window
+        sof_interrupt_enable = UDIEN & (1 << SOFE);
+        UDIEN &= ~(1 << SOFE);
     }
-    return (SPSR & (1 << SPIF)) ? SPDR : 0;
 }
 
-static inline void transceive_byte(const register uint8_t tx_byte) {
-    // wait for the current byte to be fully clocked out, set TX and store RX
-    // the SPDR has a very narrow time window to be set, because it must happen during one SPI CLK period
-    // (after previous byte is clocked out, but before the new one is)
-    // to keep up with this hard timing requirement, it is essentially "spammed" in the loop below
-    cli();
-    while (true) {
-        SPDR = tx_byte;
-        if (SPSR & (1 << SPIF)) {
-            // finished clocking out one byte, set TX and store RX
-            SPDR = tx_byte;
-            store_rx_byte(SPDR);
-            break;
-        }
-        SPDR = tx_byte;
-        if (is_cs_high()) {
-            // CS went high, stop data transfer and don't save RX
-            break;
+/**
+ * @brief Prepare a new frame if needed and stage it, unless a transaction has already started.
+ *
+ * SPI is armed (i.e. the handshake response is queued) once a frame is staged.
+ */
+static void stage_frame() {
+    if (tx_size && !is_frame_outdated(tx_frame)) {
+        return;
+    }
+    uint8_t* frame = tx_frame == tx_frames[0] ? tx_frames[1] : tx_frames[0];
+    uint8_t size = prepare_frame(frame);
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        if (state == SPI_STATE_DISARMED && is_cs_high() && !is_transaction_done) {
+            tx_frame = frame;
+            tx_size = size;
+            SPDR = AVR_LINK_HANDSHAKE_RX;
+            state = SPI_STATE_HANDSHAKE;
+        } else if (state == SPI_STATE_HANDSHAKE) {
+            // armed, but no byte is clocked yet
+            tx_frame = frame;
+            tx_size = size;
         }
-        SPDR = tx_byte;
     }
-    sei();
 }
 
-static inline bool handshake() {
-    // queue 0x43 to be transmitted as a handshake
-    SPDR = 0x43;
-    if (wait_for_rx_byte() != 0x42) {
-        SPDR = 0;  // reset SPDR in case waiting for RX timed out, so that 0x43 is not shifted out later accidentally
-        return false;
+static void finish_transaction() {
+    if (completed_state == SPI_STATE_HANDSHAKE) {
+        // master kept CS low without clocking data, which happens when it resets or loses track of AVR,
+        // make sure it is notified again once it is back
+        reset_reported_status();
+    } else if (completed_state == SPI_STATE_FRAME) {
+        // a byte is received while the byte at the same position is sent, so the frame was delivered
+        // if as many bytes were received
+        if (rx_idx >= tx_size) {
+            frame_sent(tx_frame);
+        }
+        process_frame(rx_frame, rx_idx);
     }
-    return true;
+
+    // cleanup, SPI is disarmed until the next frame is prepared
+    next_tx_byte = 0;
+    tx_size = 0;
+    tx_idx = rx_idx = 0;
+    is_transaction_done = false;
 }
 
 void spi_task() {
@@ -120,40 +230,16 @@ void spi_task() {
         }
         return;
     }
-    if (!is_cs_high()) {
-        if (!handshake()) {
-            return;
-        }
-        const uint8_t command_id = wait_for_rx_byte();
-        if (!command_id) {
-            return;
-        }
-        // prepare response (tx and rx buffers)
-        const uint8_t first_tx_byte = prepare_response(command_id, &num_tx, &tx_data, &num_rx, &rx_data);
-        SPDR = first_tx_byte;  // set SPDR as early as possible
-
-        tx_crc = _crc_ibutton_update(0, first_tx_byte);
-
-        // wait for transfer to begin by detecting WCOL (write collision) bit
-        do {
-            SPDR = first_tx_byte;
-        } while (!(SPSR & (1 << WCOL)) && !is_cs_high());
-
-        // main data transfer loop
-        while (!is_cs_high()) {
-            // the loop is always entered shortly after a new 8-byte clock cycle started -- clear previous flags
-            SPSR |= (1 << WCOL) | (1 << SPIF);
-            transceive_byte(get_next_tx_byte());
-            wdt_reset();
-        }
-        // if there was data received, and all TX was done, process command result
-        if (rx_idx && tx_idx == num_tx) {
-            process_transaction(command_id, tx_idx, tx_data, rx_idx, rx_data);
-        }
-
-        // cleanup
-        num_tx = num_rx = 0;
-        tx_idx = rx_idx = 0;
-        SPSR |= (1 << WCOL) | (1 << SPIF);
+    if (is_transaction_done) {
+        finish_transaction();
+    }
+    if (is_cs_high()) {
+        // between transactions, keep the frame up to date and request master's attention if there is something new
+        stage_frame();
+        set_irq_asserted(is_attention_needed());
     }
 }
+
+bool is_spi_task_pending() {
+    return is_transaction_done;
+}
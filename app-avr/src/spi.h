@@ -1,4 +1,11 @@
 #pragma once
 
+#include <stdbool.h>
+
 void init_spi();
 void spi_task();
+
+/**
+ * @brief Check if a transaction has ended and waits for @ref spi_task to process it.
+ */
+bool is_spi_task_pending();
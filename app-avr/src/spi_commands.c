@@ -1,50 +1,211 @@
 #include "spi_commands.h"
 
+#include <string.h>
+
 #include <LUFA/Drivers/USB/USB.h>
+#include <avr_link.h>
 
 #include "descriptors.h"
 #include "reporting.h"
 
-static const uint8_t device_id_response[] = {0x1E, 0x93, 0x89};
-static uint8_t rx_buf[32];
+static const uint8_t device_id[] = {0x1E, 0x93, 0x89};
+
+#define STATUS_UNKNOWN 0xFF  // SPI master has not received the status yet
+
+// application message or DFU chunk, they share the buffer to save RAM
+static uint8_t message[AVR_LINK_APP_MESSAGE_MAX_SIZE];
+static uint8_t message_type;
+static uint8_t message_size = 0;
+
+_Static_assert(sizeof(struct avr_link_dfu_chunk) <= AVR_LINK_APP_MESSAGE_MAX_SIZE, "DFU chunk must fit into message");
+
+static struct avr_link_dfu_status dfu_status;
+
+// application replies waiting to be read by the host, each one prefixed with its size
+#define REPLY_QUEUE_SIZE 3
+static uint8_t replies[REPLY_QUEUE_SIZE][1 + AVR_LINK_APP_MESSAGE_MAX_SIZE];
+static uint8_t reply_head = 0;
+static uint8_t num_replies = 0;
 
-uint8_t prepare_response(
-    const uint8_t command_id,
-    uint8_t* num_tx, const uint8_t** tx_data,
-    uint8_t* num_rx, uint8_t** rx_data
-) {
-    uint8_t first_tx_byte = 0;
-    if (command_id == 0x06) { // read device ID
-        first_tx_byte = *device_id_response;
-        *tx_data = device_id_response + 1;
-        *num_tx = sizeof(device_id_response) - 1;
+// status and report stats as last received by SPI master
+static uint8_t reported_status = STATUS_UNKNOWN;
+static struct avr_link_report_stats reported_stats;
+
+static uint8_t tx_seq = 0;  // sequence number of the next frame sent to master
+static uint8_t rx_seq = 0;  // sequence number of the last frame accepted from master
+
+static uint8_t get_status() {
+    uint8_t status = 0;
+    if (is_report_queue_ready()) {
+        status |= AVR_LINK_STATUS_REPORT_QUEUE_READY;
+    }
+    if (USB_DeviceState == DEVICE_STATE_Configured) {
+        status |= AVR_LINK_STATUS_USB_CONFIGURED;
     }
-    else if (command_id == 0x08) { // set report descriptor
-        get_hid_report_descriptor_buffer(num_rx, rx_data);
+    else if (USB_DeviceState == DEVICE_STATE_Suspended && USB_Device_ConfigurationNumber) {
+        // the configuration is restored on resume, so master keeps USB as its transport
+        status |= AVR_LINK_STATUS_USB_CONFIGURED | AVR_LINK_STATUS_USB_SUSPENDED;
     }
-    else if (command_id == 0x09) { // enable USB controller
-        *rx_data = rx_buf;
-        *num_rx = 1;
+    if (USB_Device_RemoteWakeupEnabled) {
+        status |= AVR_LINK_STATUS_REMOTE_WAKEUP;
     }
-    else if (command_id == 0x0A) { // send report
-        *rx_data = rx_buf;
-        *num_rx = sizeof(rx_buf);
+    // a message does not fit into a frame along with device ID, so it waits until master knows the status
+    if (message_size && reported_status != STATUS_UNKNOWN) {
+        status |= AVR_LINK_STATUS_MESSAGE_PENDING;
     }
-    return first_tx_byte;
+    status |= (REPLY_QUEUE_SIZE - num_replies) << AVR_LINK_STATUS_REPLY_SLOTS_SHIFT;
+    return status;
+}
+
+bool is_attention_needed() {
+    // busy count changes all the time at high report rates, it is only sent along with other updates
+    return get_status() != reported_status || get_report_stats()->overflows != reported_stats.overflows;
+}
+
+// status message is always the first one in the frame
+static inline uint8_t get_frame_status(const uint8_t* frame) {
+    return frame[AVR_LINK_FRAME_HEADER_SIZE + AVR_LINK_MESSAGE_HEADER_SIZE];
+}
+
+bool is_frame_outdated(const uint8_t* frame) {
+    return get_status() != get_frame_status(frame);
 }
 
-void process_transaction(
-    const uint8_t command_id,
-    const uint8_t num_tx, const uint8_t* tx_data,
-    const uint8_t num_rx, const uint8_t* rx_data
-) {
-    if (command_id == 0x08) { // set report descriptor
-        set_hid_report_size(num_rx);
+void reset_reported_status() {
+    reported_status = STATUS_UNKNOWN;
+}
+
+static bool post(const uint8_t type, const uint8_t size, const void* data) {
+    if (message_size || !size || size > AVR_LINK_APP_MESSAGE_MAX_SIZE) {
+        return false;
     }
-    else if (command_id == 0x09) { // enable USB
-        if (rx_data[0]) USB_Init();
+    memcpy(message, data, size);
+    message_type = type;
+    message_size = size;
+    return true;
+}
+
+bool post_message(const uint8_t size, const uint8_t* data) {
+    return post(AVR_LINK_MSG_APP, size, data);
+}
+
+bool post_dfu_chunk(const struct avr_link_dfu_chunk* chunk) {
+    return post(AVR_LINK_MSG_DFU_CHUNK, sizeof(*chunk), chunk);
+}
+
+bool is_message_pending() {
+    return message_size != 0;
+}
+
+uint8_t read_reply(uint8_t* data) {
+    if (!num_replies) {
+        return 0;
+    }
+    const uint8_t* reply = replies[reply_head];
+    memcpy(data, reply + 1, reply[0]);
+    reply_head = (reply_head + 1) % REPLY_QUEUE_SIZE;
+    num_replies--;
+    return reply[0];
+}
+
+static void queue_reply(const uint8_t size, const uint8_t* data) {
+    // master only sends a reply when it knows there is a free slot
+    if (num_replies < REPLY_QUEUE_SIZE && size <= AVR_LINK_APP_MESSAGE_MAX_SIZE) {
+        uint8_t* reply = replies[(reply_head + num_replies) % REPLY_QUEUE_SIZE];
+        reply[0] = size;
+        memcpy(reply + 1, data, size);
+        num_replies++;
+    }
+}
+
+const struct avr_link_dfu_status* get_dfu_status() {
+    return &dfu_status;
+}
+
+uint8_t prepare_frame(uint8_t* frame) {
+    uint8_t status = get_status();
+    avr_link_frame_init(frame, tx_seq, rx_seq);
+    avr_link_frame_add(frame, AVR_LINK_MSG_STATUS, &status, 1);
+    if (reported_status == STATUS_UNKNOWN) {
+        // master (re)connected, let it verify who it talks to
+        avr_link_frame_add(frame, AVR_LINK_MSG_DEVICE_ID, device_id, sizeof(device_id));
+        // master skips uploading the descriptor if it has the same one
+        uint16_t hash;
+        if (get_hid_report_descriptor_hash(&hash)) {
+            avr_link_frame_add(frame, AVR_LINK_MSG_DESCRIPTOR_HASH, &hash, sizeof(hash));
+        }
     }
-    else if (command_id == 0x0A) { // send report
-        send_report(num_rx, rx_data);
+    if (status & AVR_LINK_STATUS_MESSAGE_PENDING) {
+        avr_link_frame_add(frame, message_type, message, message_size);
+    }
+    // master only clocks a frame longer than status while IRQ is asserted
+    const struct avr_link_report_stats* stats = get_report_stats();
+    if (is_attention_needed() && memcmp(stats, &reported_stats, sizeof(reported_stats))) {
+        avr_link_frame_add(frame, AVR_LINK_MSG_REPORT_STATS, stats, sizeof(*stats));
+    }
+    return avr_link_frame_finish(frame);
+}
+
+void frame_sent(const uint8_t* frame) {
+    tx_seq++;
+    reported_status = get_frame_status(frame);
+    if (reported_status & AVR_LINK_STATUS_MESSAGE_PENDING) {
+        message_size = 0;
+    }
+
+    uint8_t offset = 0, type, size;
+    const uint8_t* data;
+    while (avr_link_frame_next(frame, &offset, &type, &data, &size)) {
+        if (type == AVR_LINK_MSG_REPORT_STATS) {
+            memcpy(&reported_stats, data, sizeof(reported_stats));
+        }
+    }
+}
+
+static void set_report_descriptor_chunk(const uint8_t size, const uint8_t* data) {
+    // first byte is offset, only zero (start over) or non-zero (append) matters,
+    // the master detects lost frames and restarts the upload
+    uint8_t capacity;
+    uint8_t* buffer;
+    bool append = data[0] != 0;
+    get_hid_report_descriptor_buffer(append, &capacity, &buffer);
+    if (size - 1 <= capacity) {
+        memcpy(buffer, data + 1, size - 1);
+        set_hid_report_size(append, size - 1);
+    }
+}
+
+void process_frame(const uint8_t* frame, const uint8_t size) {
+    // a frame following a lost one is discarded as well, the master resends both in order
+    if (!avr_link_rx_accept(&rx_seq, frame, size)) {
+        return;
+    }
+
+    uint8_t offset = 0, type, data_size;
+    const uint8_t* data;
+    while (avr_link_frame_next(frame, &offset, &type, &data, &data_size)) {
+        if (type == AVR_LINK_MSG_REPORT) {
+            queue_report(data_size, data);
+        }
+        else if (type == AVR_LINK_MSG_DESCRIPTOR && data_size) {
+            set_report_descriptor_chunk(data_size, data);
+        }
+        else if (type == AVR_LINK_MSG_ENABLE_USB && data_size) {
+            if (data[0]) {
+                commit_hid_report_descriptor();
+                USB_Init();
+            }
+        }
+        else if (type == AVR_LINK_MSG_DFU_STATUS && data_size == sizeof(dfu_status)) {
+            memcpy(&dfu_status, data, sizeof(dfu_status));
+        }
+        else if (type == AVR_LINK_MSG_APP_REPLY && data_size) {
+            queue_reply(data_size, data);
+        }
+        else if (type == AVR_LINK_MSG_WAKEUP) {
+            if (USB_DeviceState == DEVICE_STATE_Suspended && USB_Device_RemoteWakeupEnabled) {
+                USB_Device_SendRemoteWakeup();
+            }
+        }
     }
 }
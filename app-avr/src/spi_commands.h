@@ -1,6 +1,74 @@
 #pragma once
 
+#include <stdbool.h>
 #include <stdint.h>
 
-uint8_t prepare_response(uint8_t command_id, uint8_t* num_tx, const uint8_t** tx_data, uint8_t* num_rx, uint8_t** rx_data);
-void process_transaction(uint8_t command_id, uint8_t num_tx, const uint8_t* tx_data, uint8_t num_rx, const uint8_t* rx_data);
+#include <avr_link.h>
+
+/**
+ * @brief Prepare a frame to be sent to SPI master in the next transaction, return its size.
+ *
+ * The frame is not considered sent until @ref frame_sent is called with it, so it may be discarded.
+ */
+uint8_t prepare_frame(uint8_t* frame);
+
+/**
+ * @brief Called once the prepared frame has been fully clocked out.
+ */
+void frame_sent(const uint8_t* frame);
+
+/**
+ * @brief Validate and process a frame received from SPI master, unless it's out of sequence.
+ */
+void process_frame(const uint8_t* frame, uint8_t size);
+
+/**
+ * @brief Check if the status changed since it was last received by SPI master.
+ *
+ * SPI master is notified about this with IRQ line.
+ */
+bool is_attention_needed();
+
+/**
+ * @brief Check if the status changed since the frame was prepared.
+ */
+bool is_frame_outdated(const uint8_t* frame);
+
+/**
+ * @brief Forget the status reported to SPI master, so that it is notified again.
+ *
+ * Used when SPI master seems to have restarted.
+ */
+void reset_reported_status();
+
+/**
+ * @brief Post a message to be sent to SPI master.
+ *
+ * Returns false if the previous message was not sent yet or the message is too long.
+ */
+bool post_message(uint8_t size, const uint8_t* data);
+
+/**
+ * @brief Post a DFU chunk to be forwarded to SPI master.
+ *
+ * Chunks share the buffer with messages, so returns false if the previous message or chunk was not sent yet.
+ */
+bool post_dfu_chunk(const struct avr_link_dfu_chunk* chunk);
+
+/**
+ * @brief Check if an application message or a DFU chunk is waiting to be sent to SPI master.
+ */
+bool is_message_pending();
+
+/**
+ * @brief Pop the oldest application reply received from SPI master.
+ *
+ * @param data Buffer of @ref AVR_LINK_APP_MESSAGE_MAX_SIZE bytes
+ * @return size of the reply, 0 if there is none
+ */
+uint8_t read_reply(uint8_t* data);
+
+/**
+ * @brief Get DFU status last received from SPI master.
+ */
+const struct avr_link_dfu_status* get_dfu_status();
@@ -1,8 +1,11 @@
 #pragma once
 
+#include <stdbool.h>
 #include <stdint.h>
 
 #include <hal/nrf_spim.h>
+#include <zephyr/drivers/sensor.h>
+#include <zephyr/kernel.h>
 
 #define DT_DRV_COMPAT pixart_adns7530
 
@@ -49,6 +52,8 @@
 
 #define ADNS7530_PRODUCT_ID            0x31
 #define ADNS7530_RESET_VALUE           0x5a  // writing this value to ADNS7530_REG_POWER_UP_RESET resets the chip
+#define ADNS7530_RESET_TIME_MS         10    // time to wait after reset before accessing the chip
+#define ADNS7530_SHUTDOWN_VALUE        0xe7  // writing this value to ADNS7530_REG_SHUTDOWN shuts the chip down
 
 // ADNS7530_REG_MOTION
 #define ADNS7530_LASER_FAULT_MASK      BIT(2)
@@ -70,7 +75,41 @@
 #define ADNS7530_RUN_RATE_7MS          0b101
 #define ADNS7530_RUN_RATE_8MS          0b110
 
+// REST downshift value applied while the sensor is lifted (minimal time before entering rest mode)
+#define ADNS7530_LIFTED_DOWNSHIFT      0x01
+
+/**
+ * @brief Private sensor channel, its value is 1 if the sensor is lifted and 0 otherwise.
+ */
+#define ADNS7530_CHAN_LIFTED           ((enum sensor_channel) SENSOR_CHAN_PRIV_START)
+
+/**
+ * @brief Private sensor attribute, resolution in counts per inch (one of 400, 800, 1200, 1600).
+ */
+#define ADNS7530_ATTR_CPI              ((enum sensor_attribute) SENSOR_ATTR_PRIV_START)
+
+struct adns7530_reg_value {
+    uint8_t reg;
+    uint8_t value;
+};
+
 struct adns7530_data {
+    // serializes register access sequences, the sensor is used by the collector thread
+    // and suspended, resumed or reconfigured from other threads
+    struct k_mutex lock;
+
     int16_t delta_x;
     int16_t delta_y;
+
+    bool lifted;
+    int64_t land_time_ms;
+
+    // downshift values configured by sensor on power up, restored after landing
+    uint8_t run_downshift;
+    uint8_t rest1_downshift;
+
+    uint8_t resolution;  // ADNS7530_RESOLUTION_*
+
+    bool suspended;
+    uint32_t resume_time_us;  // duration of the latest resume from shutdown
 };
@@ -8,3 +8,9 @@
 
 #define BTN_OFF_PPI_CH         NRF_PPI_CHANNEL1
 #define BTN_OFF_GPIOTE_CH_NUM  1
+
+#define SPI_TIMER              NRF_TIMER3
+#define SPI_TIMER_DT_NODE      DT_NODELABEL(timer3)
+#define SPI_TIMER_START_PPI_CH NRF_PPI_CHANNEL2
+#define SPI_CS_PPI_CH          NRF_PPI_CHANNEL3
+#define SPI_CS_GPIOTE_CH_NUM   2
@@ -5,18 +5,63 @@
 
 #include <hal/nrf_spim.h>
 #include <zephyr/kernel.h>
+#include <zephyr/sys/slist.h>
+
+#define SPI_STATS_HIST_NUM_BUCKETS 12
+
+struct spi_device_counters {
+    uint32_t num_transactions;
+    /// Transactions aborted by segment callback
+    uint32_t errors;
+    uint32_t bytes;
+    /// Number of times the configuration was actually applied to SPIM (i.e. was not cached)
+    uint32_t reconfigurations;
+    /// Number of times a transaction was delayed by CONFIG_SPI_ENABLE_CLK_DELAY
+    uint32_t clk_enable_stalls;
+    /// Number of times SCK was brought low after CONFIG_SPI_DISABLE_CLK_DELAY of inactivity
+    uint32_t clk_disables;
+    uint32_t wait_max_us;
+    /// Histograms of time waiting in the queue and time occupying the bus,
+    /// bucket i counts values in [2^i, 2^(i+1)) us, first bucket includes 0, last one includes anything above
+    uint32_t wait_hist[SPI_STATS_HIST_NUM_BUCKETS];
+    uint32_t transfer_hist[SPI_STATS_HIST_NUM_BUCKETS];
+};
+
+/**
+ * @brief Per-device SPI statistics, referenced from spi_configuration.
+ */
+struct spi_device_stats {
+    const char* name;
+    struct spi_device_counters counters;
+
+    // managed by the SPI layer
+    sys_snode_t node;
+    bool is_registered;
+};
 
 struct spi_configuration {
     nrf_spim_mode_t op_mode;
     nrf_spim_bit_order_t bit_order;
     nrf_spim_frequency_t freq;
 
+    /// Minimum delay between segments of a transaction (us), enforced by hardware timer
+    uint16_t segment_gap_us;
+    /// Delay between the end of the last segment and CS deassertion (us), enforced by hardware timer
+    uint16_t cs_hold_us;
+
     /// If true, subsequent calls to spi_configure() with the same pointer will have no effect
     bool is_const;
+
+    /// Optional, statistics of transactions made with this configuration
+    struct spi_device_stats* stats;
 };
 
+/**
+ * @brief A single SPI transfer. RX buffer must be in RAM, TX buffer may be located anywhere:
+ * if it's not in RAM, it's copied to an internal bounce buffer.
+ */
 struct spi_transfer_spec {
-    void* tx_buf;
+    const void* tx_buf;
     uint32_t tx_len;
     void* rx_buf;
     uint32_t rx_len;
@@ -57,7 +102,7 @@ int spi_configure(const struct spi_configuration* config);
  *
  * This is a low-level interface. This function configures the buffers and starts
  * SPIM transfer with DMA engine. The specified callback is called from ISR when
- * the transfer is done.
+ * the transfer is done. TX data not in RAM must fit into CONFIG_SPI_BOUNCE_BUF_SIZE.
  */
 int spi_transceive(const struct spi_transfer_spec* spec, void (*callback)(void*), void* arg);
 
@@ -66,15 +111,106 @@ int spi_transceive(const struct spi_transfer_spec* spec, void (*callback)(void*)
  */
 int spi_transceive_sync(struct spi_transfer_spec* spec);
 
+enum spi_priority {
+    SPI_PRIORITY_NORMAL,
+    /// Latency-sensitive transactions, e.g. sensor reads
+    SPI_PRIORITY_HIGH,
+
+    SPI_NUM_PRIORITIES,
+};
+
+struct spi_transaction;
+
+/**
+ * @brief Called from ISR when a transaction is completed (or aborted by its segment_done callback).
+ */
+typedef void (*spi_transaction_cb)(struct spi_transaction* transaction, int err);
+
 /**
- * @brief Perform an SPI data transfer with given SPI configuration and managed CS pin.
+ * @brief Called from ISR after each segment of a transaction is transferred.
  *
- * This is a higher-level interface that manages SPI lock, SPI configuration and CS pin state.
- * When the transfer is completed, it calls the callback from ISR context and passes a semafore
- * that the caller thread awaits on with the specified timeout. The callback can then either
- * perform an additional transmission(s) with @ref spi_transceive, or give the semafore to signal
- * the completion and unblock the caller thread. Upon return, the function will pull CS high.
+ * @return 0 to continue with the next segment, negative error code to abort the transaction
+ */
+typedef int (*spi_segment_cb)(struct spi_transaction* transaction, uint32_t segment_idx);
+
+/**
+ * @brief A queued SPI transaction: a number of transfers performed back-to-back with CS held low.
+ *
+ * The structure (as well as the configuration, segments and buffers it points to) must stay valid
+ * until the completion callback is called. Transactions are never preempted, so bulk transfers should be
+ * split into several transactions to let higher priority ones through.
+ */
+struct spi_transaction {
+    const struct spi_configuration* config;
+    uint32_t cs_pin;
+    enum spi_priority priority;
+    const struct spi_transfer_spec* segments;
+    uint32_t num_segments;
+
+    /// Optional, called after each segment
+    spi_segment_cb segment_done;
+    /// Optional, called upon completion
+    spi_transaction_cb callback;
+    void* user_data;
+
+    // managed by the SPI layer
+    sys_snode_t node;
+    uint32_t current_segment;
+    uint32_t segment_offset;
+    uint32_t submit_cycles;
+    uint32_t start_cycles;
+};
+
+struct spi_queue_stats {
+    /// Uptime at which the statistics were reset
+    int64_t since_ms;
+    uint32_t num_transactions;
+    /// Total time the bus was occupied by queued transactions (CS low)
+    uint64_t busy_us;
+    /// Sum and maximum of the time between submission and completion of a transaction
+    uint64_t latency_sum_us;
+    uint32_t latency_max_us;
+    /// Maximum time between submission and start of a transaction, per priority
+    uint32_t wait_max_us[SPI_NUM_PRIORITIES];
+    /// Time spent in spi_lock waiting for the mutex and the queue to become idle
+    uint32_t num_locks;
+    uint64_t lock_wait_sum_us;
+    uint32_t lock_wait_max_us;
+};
+
+typedef void (*spi_device_stats_cb)(const char* name, const struct spi_device_counters* counters, void* user_data);
+
+/**
+ * @brief Append a transaction to the SPI queue.
+ *
+ * Queued transactions are executed in order of priority and submission, each with its own configuration and CS pin.
+ * The next transaction is started from ISR right after the previous one completes.
+ * The queue is paused while the bus is locked with @ref spi_lock. Can be called from ISR.
+ *
+ * @return 0 on success, negative error code otherwise
+ */
+int spi_submit(struct spi_transaction* transaction);
+
+/**
+ * @brief Submit a transaction and wait for it to complete.
+ *
+ * Overwrites callback and user_data of the transaction.
+ *
+ * @return 0 on success, error passed to the completion callback or negative error code otherwise
+ */
+int spi_transact(struct spi_transaction* transaction, k_timeout_t timeout);
+
+/**
+ * @brief Get SPI queue statistics (bus utilisation and transaction latency).
+ */
+void spi_queue_stats_get(struct spi_queue_stats* stats);
+
+/**
+ * @brief Reset SPI queue statistics, including per-device statistics.
+ */
+void spi_queue_stats_reset();
+
+/**
+ * @brief Call @p callback with a snapshot of statistics of each device that has submitted a transaction.
  */
-int spi_transceive_managed(const struct spi_configuration* config, uint32_t cs_pin,
-                           const struct spi_transfer_spec* spec, void (*callback)(void*),
-                           k_timeout_t timeout);
+void spi_device_stats_foreach(spi_device_stats_cb callback, void* user_data);
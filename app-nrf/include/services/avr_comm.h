@@ -0,0 +1,75 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <zephyr/kernel.h>
+
+#include "avr_link.h"
+#include "hid_report_struct.h"
+
+typedef void (*avr_comm_usb_ready_cb)(bool ready);
+typedef void (*avr_comm_message_cb)(const uint8_t* data, uint8_t size);
+typedef void (*avr_comm_dfu_chunk_cb)(const struct avr_link_dfu_chunk* chunk, struct avr_link_dfu_status* status);
+typedef void (*avr_comm_link_up_cb)();
+
+/**
+ * @brief Check if the AVR is present and has been configured by USB host.
+ *
+ * USB stays ready while the host is suspended, so that it's not replaced by another transport.
+ */
+bool avr_comm_usb_ready();
+
+/**
+ * @brief Set a callback to be called when the value returned by @ref avr_comm_usb_ready changes.
+ *
+ * The callback is called from AVR communication thread.
+ */
+void avr_comm_set_usb_ready_cb(avr_comm_usb_ready_cb callback);
+
+/**
+ * @brief Queue a report to be sent to the host via AVR.
+ *
+ * A report is sent as soon as the AVR signals that its endpoint is free. Movement of reports submitted
+ * in between is accumulated into the pending one. A report with different button state can't be merged,
+ * in this case the function blocks until the pending report is sent.
+ *
+ * While the host has suspended USB, reports are dropped. The first one wakes the host up, if it allows that.
+ *
+ * @return 0 on success, -ENOTCONN if USB is not ready, -EAGAIN if the pending report was not sent in time.
+ */
+int avr_comm_submit_report(const struct hid_report* report);
+
+/**
+ * @brief Set a callback to be called when the AVR sends a message (e.g. written by USB host).
+ *
+ * The callback is called from AVR communication thread.
+ */
+void avr_comm_set_message_cb(avr_comm_message_cb callback);
+
+/**
+ * @brief Queue a reply for USB host to read via the application channel of the AVR.
+ *
+ * Replies are delivered in order, up to @ref AVR_LINK_APP_MESSAGE_MAX_SIZE bytes each. They are discarded
+ * when USB becomes unavailable.
+ *
+ * @return 0 on success, -EINVAL if the size is invalid, -ENOTCONN if USB is not ready,
+ *         -EAGAIN if the queue stays full (the host does not read replies).
+ */
+int avr_comm_send_reply(const uint8_t* data, uint8_t size, k_timeout_t timeout);
+
+/**
+ * @brief Set a callback to process firmware update chunks written by USB host.
+ *
+ * The callback is called from AVR communication thread. It fills the status, which is then sent to the AVR
+ * for the host to read.
+ */
+void avr_comm_set_dfu_chunk_cb(avr_comm_dfu_chunk_cb callback);
+
+/**
+ * @brief Set a callback to be called each time the link with the AVR is established, i.e. the AVR has
+ * answered the handshake with the expected ID.
+ *
+ * The callback is called from AVR communication thread.
+ */
+void avr_comm_set_link_up_cb(avr_comm_link_up_cb callback);
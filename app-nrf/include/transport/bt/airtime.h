@@ -0,0 +1,35 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Radio-on time estimates of a peripheral sending notifications, see Core spec Vol 6, Part B, 2.1 and 4.5.
+ *
+ * In each connection event the central sends a packet (empty, as there's nothing for the peripheral),
+ * the peripheral answers with a data PDU after T_IFS. More data PDUs follow in the same event while the
+ * peripheral sets the MD bit and the event length allows. PHY is one of BT_GAP_LE_PHY_1M, BT_GAP_LE_PHY_2M.
+ */
+
+// inter frame space, us
+#define AIRTIME_T_IFS_US 150
+// L2CAP header and ATT notification header (opcode, handle)
+#define AIRTIME_NOTIFICATION_OVERHEAD (4 + 3)
+// largest LL payload without data length extension
+#define AIRTIME_LL_DEFAULT_MAX_PAYLOAD 27
+
+/**
+ * @brief Get air time of a data channel PDU carrying @p payload_size bytes of LL payload.
+ *
+ * @param encrypted true to account for MIC, which is present in encrypted PDUs with non-empty payload
+ */
+uint32_t airtime_pdu_us(uint8_t phy, uint8_t payload_size, bool encrypted);
+
+/**
+ * @brief Get radio-on time of a connection event in which the peripheral sends @p num_pdus data PDUs.
+ */
+uint32_t airtime_event_us(uint8_t phy, uint8_t payload_size, uint8_t num_pdus);
+
+/**
+ * @brief Get number of data PDUs the peripheral can send in a connection event of given length.
+ */
+uint32_t airtime_pdus_per_event(uint8_t phy, uint8_t payload_size, uint32_t event_len_us);
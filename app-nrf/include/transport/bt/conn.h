@@ -1,6 +1,17 @@
 #pragma once
 
+#include <stdbool.h>
+
+typedef void (*transport_bt_availability_cb)(bool available);
+
 extern struct bt_conn *current_client;
 
 int transport_bt_conn_init();
 int transport_bt_available();
+
+/**
+ * @brief Set a callback to be called when the value returned by @ref transport_bt_available changes.
+ *
+ * The callback is called from BT stack context and should not block for long.
+ */
+void transport_bt_set_availability_cb(transport_bt_availability_cb callback);
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <zephyr/bluetooth/conn.h>
+
+/* Connection parameters manager.
+ *
+ * While the user is active, the shortest interval with no peripheral latency is requested, so that reports
+ * reach the central as soon as possible. After a period of inactivity, a longer interval with peripheral
+ * latency is requested to save power. The policy is kept apart from the BT stack, so that it can be driven
+ * by a simulated central (time, activity and granted parameters are its only inputs).
+ */
+
+enum conn_params_profile {
+    CONN_PARAMS_NONE,    // parameters chosen by the central, or not matching any profile
+    CONN_PARAMS_ACTIVE,  // low latency
+    CONN_PARAMS_IDLE,    // low power
+};
+
+struct conn_params_policy {
+    int64_t last_activity_ms;
+    int64_t hold_until_ms;             // no requests are made before this time
+    int64_t requested_ms;              // when the last request was made
+    enum conn_params_profile requested;
+    enum conn_params_profile granted;  // profile matching parameters in use
+};
+
+// the central is left alone until service discovery and pairing are likely done
+#define CONN_PARAMS_CONNECT_DELAY_MS 5000
+// a request that was not granted is repeated after T_GAP(conn_param_timeout)
+#define CONN_PARAMS_RETRY_MS 30000
+// returned as next evaluation time when there is nothing to wait for
+#define CONN_PARAMS_NEVER INT64_MAX
+
+/**
+ * @brief Get connection parameters of a profile, as requested from the central.
+ */
+const struct bt_le_conn_param* conn_params_profile_get(enum conn_params_profile profile);
+
+/**
+ * @brief Change connection interval range of a profile (in 1.25 ms units).
+ */
+void conn_params_profile_set_interval(enum conn_params_profile profile, uint16_t interval_min, uint16_t interval_max);
+
+/**
+ * @brief Start the policy for a new connection.
+ */
+void conn_params_policy_init(struct conn_params_policy* policy, int64_t now_ms);
+
+/**
+ * @brief Record user activity.
+ *
+ * @return true if the active profile is not in use, so the policy should be evaluated right away
+ */
+bool conn_params_policy_activity(struct conn_params_policy* policy, int64_t now_ms);
+
+/**
+ * @brief Record parameters granted by the central.
+ */
+void conn_params_policy_granted(struct conn_params_policy* policy, uint16_t interval, uint16_t latency);
+
+/**
+ * @brief Decide which profile to request now.
+ *
+ * The returned profile is considered requested.
+ *
+ * @param next_eval_ms Set to the time the policy should be evaluated again, unless there is activity
+ * @return profile to request, or CONN_PARAMS_NONE if no request is needed
+ */
+enum conn_params_profile conn_params_policy_evaluate(struct conn_params_policy* policy,
+                                                     int64_t now_ms,
+                                                     int64_t* next_eval_ms);
+
+void transport_bt_conn_params_connected(struct bt_conn* conn);
+void transport_bt_conn_params_disconnected(struct bt_conn* conn);
+void transport_bt_conn_params_updated(struct bt_conn* conn, uint16_t interval, uint16_t latency, uint16_t timeout);
+
+/**
+ * @brief Change the active profile interval range, e.g. for a host that needs lower latency.
+ */
+void transport_bt_conn_params_set_active_interval(uint16_t interval_min, uint16_t interval_max);
+
+/**
+ * @brief Notify about user activity (a report being sent), which switches to the active profile.
+ */
+void transport_bt_conn_params_activity();
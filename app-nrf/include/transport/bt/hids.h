@@ -1,5 +1,8 @@
 #pragma once
 
+#include <stdbool.h>
+#include <stdint.h>
+
 #include <zephyr/bluetooth/conn.h>
 
 #include "hid_report_struct.h"
@@ -8,4 +11,28 @@ int transport_bt_hids_init();
 int transport_bt_hids_connected(struct bt_conn *conn);
 int transport_bt_hids_disconnected(struct bt_conn *conn);
 int transport_bt_hids_deinit();
+
+/**
+ * @brief Send a report, or merge it into the pending one while notifications are queued.
+ *
+ * Blocks while all notification buffers are in flight, until the pending report is taken to be sent.
+ *
+ * @return 0 on success, -EAGAIN if the report was dropped because the pending one could not be sent in time
+ */
 int transport_bt_send(struct hid_report* report);
+
+/**
+ * @brief Counters of the notification queue, since boot or reset.
+ */
+struct transport_bt_send_stats {
+    uint32_t sent;           // notifications handed to the stack
+    uint32_t completed;      // notifications transmitted
+    uint32_t coalesced;      // reports merged into the pending one
+    uint32_t drops;          // reports lost
+    uint8_t in_flight;       // notifications queued at the moment
+    uint8_t max_in_flight;   // highest number of notifications queued
+    bool is_report_pending;  // a report is waiting for a buffer
+};
+
+void transport_bt_send_stats_get(struct transport_bt_send_stats* stats);
+void transport_bt_send_stats_reset();
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <zephyr/bluetooth/addr.h>
+#include <zephyr/bluetooth/conn.h>
+
+/* Host slots.
+ *
+ * Each slot holds at most one bonded host, along with sensor resolution and active connection interval
+ * used with it. Only the host of the current slot is advertised to, a slot without a host advertises
+ * undirected so that a new host can pair into it (replacing the previous one, if any). Hosts of other
+ * slots are disconnected right away. Slots are switched by holding the special button and pressing
+ * forward (next slot) or backward (previous slot).
+ *
+ * Slots are stored in settings under "hosts".
+ */
+
+#define TRANSPORT_BT_HOSTS_NUM CONFIG_APP_BT_HOST_SLOTS
+
+struct transport_bt_host {
+    bt_addr_le_t addr;             // BT_ADDR_LE_ANY if no host is bonded
+    uint16_t cpi;                  // optical sensor resolution
+    uint16_t active_interval_min;  // active connection interval range, in 1.25 ms units
+    uint16_t active_interval_max;
+};
+
+/**
+ * @brief Set defaults of slots not found in settings, assign bonds which are not in any slot yet
+ * and apply current slot settings.
+ *
+ * Must be called after settings are loaded.
+ */
+int transport_bt_hosts_init();
+
+uint8_t transport_bt_hosts_current();
+
+/**
+ * @brief Get a copy of the slot.
+ */
+int transport_bt_hosts_get(uint8_t slot, struct transport_bt_host* host);
+
+/**
+ * @brief Get address of the current slot host.
+ *
+ * @return false if the current slot has no host yet
+ */
+bool transport_bt_hosts_current_addr(bt_addr_le_t* addr);
+
+/**
+ * @brief Check whether a peer may connect, i.e. it's not the host of another slot.
+ */
+bool transport_bt_hosts_accepts(const bt_addr_le_t* peer);
+
+/**
+ * @brief Assign a peer which has just secured the link to the current slot.
+ */
+void transport_bt_hosts_secured(struct bt_conn* conn);
+
+/**
+ * @brief Switch to another slot, disconnecting the current host.
+ *
+ * The switch itself is done in the system work queue, so this can be called from ISR.
+ */
+int transport_bt_hosts_select(uint8_t slot);
+
+int transport_bt_hosts_set_cpi(uint8_t slot, uint16_t cpi);
+int transport_bt_hosts_set_active_interval(uint8_t slot, uint16_t interval_min, uint16_t interval_max);
+
+/**
+ * @brief Remove the host of the slot and its bond.
+ */
+int transport_bt_hosts_forget(uint8_t slot);
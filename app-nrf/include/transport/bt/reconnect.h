@@ -0,0 +1,46 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Reconnect time measurement.
+ *
+ * Steps are timed from boot (system uptime, so a wake from system off counts from the reset), from
+ * the last disconnection or from a host switch, up to the first report sent. Each step is recorded once.
+ */
+
+enum transport_bt_reconnect_cause {
+    TRANSPORT_BT_RECONNECT_BOOT,
+    TRANSPORT_BT_RECONNECT_DISCONNECTION,
+    TRANSPORT_BT_RECONNECT_SWITCH,  // see transport_bt_hosts_select
+};
+
+enum transport_bt_reconnect_step {
+    TRANSPORT_BT_RECONNECT_ENABLED,       // BT enabled and bonds loaded, boot only
+    TRANSPORT_BT_RECONNECT_DISCONNECTED,  // link to the previous host torn down, switch only
+    TRANSPORT_BT_RECONNECT_ADVERTISING,   // first advertising started
+    TRANSPORT_BT_RECONNECT_CONNECTED,
+    TRANSPORT_BT_RECONNECT_SECURED,       // link encrypted, reports can be sent
+    TRANSPORT_BT_RECONNECT_FIRST_REPORT,  // first report handed to the stack
+    TRANSPORT_BT_RECONNECT_NUM_STEPS,
+};
+
+struct transport_bt_reconnect_stats {
+    int64_t start_ms;
+    enum transport_bt_reconnect_cause cause;
+    int64_t step_ms[TRANSPORT_BT_RECONNECT_NUM_STEPS];  // time since start, -1 if not reached
+};
+
+/**
+ * @brief Start timing a reconnection.
+ *
+ * A disconnection during a switch is recorded as a step of the switch instead.
+ */
+void transport_bt_reconnect_start(enum transport_bt_reconnect_cause cause);
+
+/**
+ * @brief Record a step, unless it's already recorded since start.
+ */
+void transport_bt_reconnect_mark(enum transport_bt_reconnect_step step);
+
+void transport_bt_reconnect_stats_get(struct transport_bt_reconnect_stats* stats);
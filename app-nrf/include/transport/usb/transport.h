@@ -0,0 +1,18 @@
+#pragma once
+
+#include <stdbool.h>
+
+#include "transport/transport.h"
+
+typedef void (*transport_usb_availability_cb)(bool available);
+
+extern struct transport usb_transport;
+
+int transport_usb_available();
+
+/**
+ * @brief Set a callback to be called when the value returned by @ref transport_usb_available changes.
+ *
+ * The callback is called from AVR communication thread and should not block for long.
+ */
+void transport_usb_set_availability_cb(transport_usb_availability_cb callback);
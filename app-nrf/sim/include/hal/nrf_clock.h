@@ -0,0 +1,50 @@
+#pragma once
+
+/* Simulated subset of nrf HAL CLOCK: HFXO starts instantly. */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "sim/periph.h"
+
+typedef enum {
+    NRF_CLOCK_HFCLK_LOW_ACCURACY,
+    NRF_CLOCK_HFCLK_HIGH_ACCURACY,
+} nrf_clock_hfclk_t;
+
+typedef struct {
+    struct sim_periph periph;
+    sim_reg_t TASKS_HFCLKSTART;
+    sim_reg_t TASKS_HFCLKSTOP;
+    sim_reg_t EVENTS_HFCLKSTARTED;
+    nrf_clock_hfclk_t HFCLKSTAT;
+} NRF_CLOCK_Type;
+
+extern NRF_CLOCK_Type sim_clock;
+#define NRF_CLOCK (&sim_clock)
+
+typedef enum {
+    NRF_CLOCK_TASK_HFCLKSTART = offsetof(NRF_CLOCK_Type, TASKS_HFCLKSTART),
+    NRF_CLOCK_TASK_HFCLKSTOP = offsetof(NRF_CLOCK_Type, TASKS_HFCLKSTOP),
+} nrf_clock_task_t;
+
+typedef enum {
+    NRF_CLOCK_EVENT_HFCLKSTARTED = offsetof(NRF_CLOCK_Type, EVENTS_HFCLKSTARTED),
+} nrf_clock_event_t;
+
+static inline void nrf_clock_task_trigger(NRF_CLOCK_Type* p_reg, nrf_clock_task_t task) {
+    sim_task_trigger(&p_reg->periph, task);
+}
+
+static inline bool nrf_clock_event_check(NRF_CLOCK_Type const* p_reg, nrf_clock_event_t event) {
+    return SIM_REG(p_reg, event);
+}
+
+static inline void nrf_clock_event_clear(NRF_CLOCK_Type* p_reg, nrf_clock_event_t event) {
+    SIM_REG(p_reg, event) = 0;
+}
+
+static inline nrf_clock_hfclk_t nrf_clock_hf_src_get(NRF_CLOCK_Type const* p_reg) {
+    return p_reg->HFCLKSTAT;
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+/* Simulated subset of nrf HAL GPIO, see sim/include/sim/gpio.h for the simulation control API. */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define NRF_GPIO_NUM_PINS 32
+
+typedef enum {
+    NRF_GPIO_PIN_NOPULL = 0,
+    NRF_GPIO_PIN_PULLDOWN = 1,
+    NRF_GPIO_PIN_PULLUP = 3,
+} nrf_gpio_pin_pull_t;
+
+typedef enum {
+    NRF_GPIO_PIN_NOSENSE = 0,
+    NRF_GPIO_PIN_SENSE_HIGH = 2,
+    NRF_GPIO_PIN_SENSE_LOW = 3,
+} nrf_gpio_pin_sense_t;
+
+struct sim_gpio_pin_cnf {
+    bool is_output;
+    bool is_input_connected;
+    nrf_gpio_pin_pull_t pull;
+    nrf_gpio_pin_sense_t sense;
+};
+
+typedef struct {
+    uint32_t OUT;
+    uint32_t IN;
+    struct sim_gpio_pin_cnf PIN_CNF[NRF_GPIO_NUM_PINS];
+
+    // simulation state
+    uint32_t level;            // actual line levels
+    uint32_t ext_driven;       // pins driven by external devices
+    uint32_t ext_level;
+    uint32_t periph_driven;    // pins driven by peripherals (GPIOTE, SPIM)
+    uint32_t periph_level;
+    bool detect;
+} NRF_GPIO_Type;
+
+extern NRF_GPIO_Type sim_gpio_p0;
+#define NRF_P0 (&sim_gpio_p0)
+
+/**
+ * @brief Recompute line levels, IN register and DETECT signal after any change.
+ */
+void sim_gpio_update(void);
+
+static inline void nrf_gpio_cfg_input(uint32_t pin, nrf_gpio_pin_pull_t pull) {
+    NRF_P0->PIN_CNF[pin] = (struct sim_gpio_pin_cnf) {
+        .is_input_connected = true,
+        .pull = pull,
+    };
+    sim_gpio_update();
+}
+
+static inline void nrf_gpio_cfg_output(uint32_t pin) {
+    NRF_P0->PIN_CNF[pin] = (struct sim_gpio_pin_cnf) {
+        .is_output = true,
+    };
+    sim_gpio_update();
+}
+
+static inline void nrf_gpio_cfg_default(uint32_t pin) {
+    NRF_P0->PIN_CNF[pin] = (struct sim_gpio_pin_cnf) {};
+    sim_gpio_update();
+}
+
+static inline void nrf_gpio_cfg_sense_input(uint32_t pin, nrf_gpio_pin_pull_t pull, nrf_gpio_pin_sense_t sense) {
+    NRF_P0->PIN_CNF[pin] = (struct sim_gpio_pin_cnf) {
+        .is_input_connected = true,
+        .pull = pull,
+        .sense = sense,
+    };
+    sim_gpio_update();
+}
+
+static inline void nrf_gpio_cfg_sense_set(uint32_t pin, nrf_gpio_pin_sense_t sense) {
+    NRF_P0->PIN_CNF[pin].sense = sense;
+    sim_gpio_update();
+}
+
+static inline void nrf_gpio_pin_set(uint32_t pin) {
+    NRF_P0->OUT |= 1u << pin;
+    sim_gpio_update();
+}
+
+static inline void nrf_gpio_pin_clear(uint32_t pin) {
+    NRF_P0->OUT &= ~(1u << pin);
+    sim_gpio_update();
+}
+
+static inline void nrf_gpio_pin_write(uint32_t pin, uint32_t value) {
+    if (value) {
+        nrf_gpio_pin_set(pin);
+    } else {
+        nrf_gpio_pin_clear(pin);
+    }
+}
+
+static inline uint32_t nrf_gpio_pin_read(uint32_t pin) {
+    return (NRF_P0->IN >> pin) & 1;
+}
+
+static inline uint32_t nrf_gpio_port_in_read(NRF_GPIO_Type const* p_reg) {
+    return p_reg->IN;
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+/* Simulated subset of nrf HAL GPIOTE: task mode channels and PORT event. */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#include "sim/periph.h"
+
+#define NRF_GPIOTE_NUM_CHANNELS 8
+
+typedef enum {
+    NRF_GPIOTE_POLARITY_NONE = 0,
+    NRF_GPIOTE_POLARITY_LOTOHI = 1,
+    NRF_GPIOTE_POLARITY_HITOLO = 2,
+    NRF_GPIOTE_POLARITY_TOGGLE = 3,
+} nrf_gpiote_polarity_t;
+
+typedef enum {
+    NRF_GPIOTE_INITIAL_VALUE_LOW = 0,
+    NRF_GPIOTE_INITIAL_VALUE_HIGH = 1,
+} nrf_gpiote_outinit_t;
+
+struct sim_gpiote_config {
+    bool is_task;
+    uint32_t pin;
+    nrf_gpiote_polarity_t polarity;
+    uint32_t value;
+};
+
+typedef struct {
+    struct sim_periph periph;
+    sim_reg_t TASKS_OUT[NRF_GPIOTE_NUM_CHANNELS];
+    sim_reg_t TASKS_SET[NRF_GPIOTE_NUM_CHANNELS];
+    sim_reg_t TASKS_CLR[NRF_GPIOTE_NUM_CHANNELS];
+    sim_reg_t EVENTS_IN[NRF_GPIOTE_NUM_CHANNELS];
+    sim_reg_t EVENTS_PORT;
+    struct sim_gpiote_config CONFIG[NRF_GPIOTE_NUM_CHANNELS];
+} NRF_GPIOTE_Type;
+
+extern NRF_GPIOTE_Type sim_gpiote;
+#define NRF_GPIOTE (&sim_gpiote)
+
+#define SIM_GPIOTE_TASK(kind, idx) NRF_GPIOTE_TASK_ ## kind ## _ ## idx = offsetof(NRF_GPIOTE_Type, TASKS_ ## kind[idx])
+
+typedef enum {
+    SIM_GPIOTE_TASK(OUT, 0), SIM_GPIOTE_TASK(OUT, 1), SIM_GPIOTE_TASK(OUT, 2), SIM_GPIOTE_TASK(OUT, 3),
+    SIM_GPIOTE_TASK(OUT, 4), SIM_GPIOTE_TASK(OUT, 5), SIM_GPIOTE_TASK(OUT, 6), SIM_GPIOTE_TASK(OUT, 7),
+    SIM_GPIOTE_TASK(SET, 0), SIM_GPIOTE_TASK(SET, 1), SIM_GPIOTE_TASK(SET, 2), SIM_GPIOTE_TASK(SET, 3),
+    SIM_GPIOTE_TASK(SET, 4), SIM_GPIOTE_TASK(SET, 5), SIM_GPIOTE_TASK(SET, 6), SIM_GPIOTE_TASK(SET, 7),
+    SIM_GPIOTE_TASK(CLR, 0), SIM_GPIOTE_TASK(CLR, 1), SIM_GPIOTE_TASK(CLR, 2), SIM_GPIOTE_TASK(CLR, 3),
+    SIM_GPIOTE_TASK(CLR, 4), SIM_GPIOTE_TASK(CLR, 5), SIM_GPIOTE_TASK(CLR, 6), SIM_GPIOTE_TASK(CLR, 7),
+} nrf_gpiote_task_t;
+
+typedef enum {
+    NRF_GPIOTE_EVENT_IN_0 = offsetof(NRF_GPIOTE_Type, EVENTS_IN[0]),
+    NRF_GPIOTE_EVENT_IN_1 = offsetof(NRF_GPIOTE_Type, EVENTS_IN[1]),
+    NRF_GPIOTE_EVENT_IN_2 = offsetof(NRF_GPIOTE_Type, EVENTS_IN[2]),
+    NRF_GPIOTE_EVENT_IN_3 = offsetof(NRF_GPIOTE_Type, EVENTS_IN[3]),
+    NRF_GPIOTE_EVENT_IN_4 = offsetof(NRF_GPIOTE_Type, EVENTS_IN[4]),
+    NRF_GPIOTE_EVENT_IN_5 = offsetof(NRF_GPIOTE_Type, EVENTS_IN[5]),
+    NRF_GPIOTE_EVENT_IN_6 = offsetof(NRF_GPIOTE_Type, EVENTS_IN[6]),
+    NRF_GPIOTE_EVENT_IN_7 = offsetof(NRF_GPIOTE_Type, EVENTS_IN[7]),
+    NRF_GPIOTE_EVENT_PORT = offsetof(NRF_GPIOTE_Type, EVENTS_PORT),
+} nrf_gpiote_event_t;
+
+typedef enum {
+    NRF_GPIOTE_INT_PORT_MASK = 1u << 31,
+} nrf_gpiote_int_t;
+
+/**
+ * @brief Generate PORT event, called by GPIO simulation on rising edge of DETECT signal.
+ */
+void sim_gpiote_port_event(void);
+
+void nrf_gpiote_task_configure(NRF_GPIOTE_Type* p_reg, uint32_t idx, uint32_t pin,
+                               nrf_gpiote_polarity_t polarity, nrf_gpiote_outinit_t init_val);
+void nrf_gpiote_task_enable(NRF_GPIOTE_Type* p_reg, uint32_t idx);
+void nrf_gpiote_task_disable(NRF_GPIOTE_Type* p_reg, uint32_t idx);
+
+static inline void nrf_gpiote_task_trigger(NRF_GPIOTE_Type* p_reg, nrf_gpiote_task_t task) {
+    sim_task_trigger(&p_reg->periph, task);
+}
+
+static inline uint32_t nrf_gpiote_task_address_get(NRF_GPIOTE_Type const* p_reg, nrf_gpiote_task_t task) {
+    return SIM_REG_ADDRESS(p_reg, task);
+}
+
+static inline bool nrf_gpiote_event_check(NRF_GPIOTE_Type const* p_reg, nrf_gpiote_event_t event) {
+    return SIM_REG(p_reg, event);
+}
+
+static inline void nrf_gpiote_event_clear(NRF_GPIOTE_Type* p_reg, nrf_gpiote_event_t event) {
+    SIM_REG(p_reg, event) = 0;
+}
+
+static inline void nrf_gpiote_int_enable(NRF_GPIOTE_Type* p_reg, uint32_t mask) {
+    p_reg->periph.inten |= mask;
+}
+
+static inline void nrf_gpiote_int_disable(NRF_GPIOTE_Type* p_reg, uint32_t mask) {
+    p_reg->periph.inten &= ~mask;
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+/* Simulated subset of nrf HAL POWER: System OFF terminates the simulation. */
+
+#include <zephyr/toolchain.h>
+
+typedef struct {
+    int unused;
+} NRF_POWER_Type;
+
+extern NRF_POWER_Type sim_power;
+#define NRF_POWER (&sim_power)
+
+FUNC_NORETURN void nrf_power_system_off(NRF_POWER_Type* p_reg);
@@ -0,0 +1,44 @@
+#pragma once
+
+/* Simulated subset of nrf HAL PPI. Channel groups are not supported. */
+
+#include <stdint.h>
+
+#define NRF_PPI_NUM_CHANNELS 20
+
+typedef enum {
+    NRF_PPI_CHANNEL0, NRF_PPI_CHANNEL1, NRF_PPI_CHANNEL2, NRF_PPI_CHANNEL3, NRF_PPI_CHANNEL4,
+    NRF_PPI_CHANNEL5, NRF_PPI_CHANNEL6, NRF_PPI_CHANNEL7, NRF_PPI_CHANNEL8, NRF_PPI_CHANNEL9,
+    NRF_PPI_CHANNEL10, NRF_PPI_CHANNEL11, NRF_PPI_CHANNEL12, NRF_PPI_CHANNEL13, NRF_PPI_CHANNEL14,
+    NRF_PPI_CHANNEL15, NRF_PPI_CHANNEL16, NRF_PPI_CHANNEL17, NRF_PPI_CHANNEL18, NRF_PPI_CHANNEL19,
+} nrf_ppi_channel_t;
+
+typedef struct {
+    uint32_t CHEN;
+    struct {
+        uint32_t EEP;
+        uint32_t TEP;
+    } CH[NRF_PPI_NUM_CHANNELS];
+    uint32_t FORK_TEP[NRF_PPI_NUM_CHANNELS];
+} NRF_PPI_Type;
+
+extern NRF_PPI_Type sim_ppi;
+#define NRF_PPI (&sim_ppi)
+
+static inline void nrf_ppi_channel_enable(NRF_PPI_Type* p_reg, nrf_ppi_channel_t channel) {
+    p_reg->CHEN |= 1u << channel;
+}
+
+static inline void nrf_ppi_channel_disable(NRF_PPI_Type* p_reg, nrf_ppi_channel_t channel) {
+    p_reg->CHEN &= ~(1u << channel);
+}
+
+static inline void nrf_ppi_channel_endpoint_setup(NRF_PPI_Type* p_reg, nrf_ppi_channel_t channel,
+                                                  uint32_t eep, uint32_t tep) {
+    p_reg->CH[channel].EEP = eep;
+    p_reg->CH[channel].TEP = tep;
+}
+
+static inline void nrf_ppi_fork_endpoint_setup(NRF_PPI_Type* p_reg, nrf_ppi_channel_t channel, uint32_t fork_tep) {
+    p_reg->FORK_TEP[channel] = fork_tep;
+}
@@ -0,0 +1,168 @@
+#pragma once
+
+/* Simulated subset of nrf HAL PWM: sequence playback timing only, pin waveforms are not simulated. */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <zephyr/kernel.h>
+
+#include "sim/periph.h"
+
+#define NRF_PWM_CHANNEL_COUNT 4
+#define NRF_PWM_PIN_NOT_CONNECTED UINT32_MAX
+
+typedef enum {
+    NRF_PWM_CLK_16MHz,
+    NRF_PWM_CLK_8MHz,
+    NRF_PWM_CLK_4MHz,
+    NRF_PWM_CLK_2MHz,
+    NRF_PWM_CLK_1MHz,
+    NRF_PWM_CLK_500kHz,
+    NRF_PWM_CLK_250kHz,
+    NRF_PWM_CLK_125kHz,
+} nrf_pwm_clk_t;
+
+typedef enum {
+    NRF_PWM_MODE_UP,
+    NRF_PWM_MODE_UP_AND_DOWN,
+} nrf_pwm_mode_t;
+
+typedef enum {
+    NRF_PWM_LOAD_COMMON,
+    NRF_PWM_LOAD_GROUPED,
+    NRF_PWM_LOAD_INDIVIDUAL,
+    NRF_PWM_LOAD_WAVE_FORM,
+} nrf_pwm_dec_load_t;
+
+typedef enum {
+    NRF_PWM_STEP_AUTO,
+    NRF_PWM_STEP_TRIGGERED,
+} nrf_pwm_dec_step_t;
+
+typedef struct {
+    struct sim_periph periph;
+    sim_reg_t TASKS_STOP;
+    sim_reg_t TASKS_SEQSTART[2];
+    sim_reg_t TASKS_NEXTSTEP;
+    sim_reg_t EVENTS_STOPPED;
+    sim_reg_t EVENTS_SEQSTARTED[2];
+    sim_reg_t EVENTS_SEQEND[2];
+    sim_reg_t EVENTS_PWMPERIODEND;
+    sim_reg_t EVENTS_LOOPSDONE;
+    uint32_t SHORTS;
+    uint32_t ENABLE;
+    nrf_pwm_mode_t MODE;
+    uint16_t COUNTERTOP;
+    nrf_pwm_clk_t PRESCALER;
+    nrf_pwm_dec_load_t DECODER_LOAD;
+    nrf_pwm_dec_step_t DECODER_MODE;
+    uint16_t LOOP;
+    struct {
+        const uint16_t* PTR;
+        uint16_t CNT;
+        uint32_t REFRESH;
+        uint32_t ENDDELAY;
+    } SEQ[2];
+    uint32_t PSEL_OUT[NRF_PWM_CHANNEL_COUNT];
+
+    // simulation state
+    int active_seq;
+    struct k_timer seq_timer;
+} NRF_PWM_Type;
+
+extern NRF_PWM_Type sim_pwm0;
+#define NRF_PWM0 (&sim_pwm0)
+
+typedef enum {
+    NRF_PWM_TASK_STOP = offsetof(NRF_PWM_Type, TASKS_STOP),
+    NRF_PWM_TASK_SEQSTART0 = offsetof(NRF_PWM_Type, TASKS_SEQSTART[0]),
+    NRF_PWM_TASK_SEQSTART1 = offsetof(NRF_PWM_Type, TASKS_SEQSTART[1]),
+    NRF_PWM_TASK_NEXTSTEP = offsetof(NRF_PWM_Type, TASKS_NEXTSTEP),
+} nrf_pwm_task_t;
+
+typedef enum {
+    NRF_PWM_EVENT_STOPPED = offsetof(NRF_PWM_Type, EVENTS_STOPPED),
+    NRF_PWM_EVENT_SEQSTARTED0 = offsetof(NRF_PWM_Type, EVENTS_SEQSTARTED[0]),
+    NRF_PWM_EVENT_SEQSTARTED1 = offsetof(NRF_PWM_Type, EVENTS_SEQSTARTED[1]),
+    NRF_PWM_EVENT_SEQEND0 = offsetof(NRF_PWM_Type, EVENTS_SEQEND[0]),
+    NRF_PWM_EVENT_SEQEND1 = offsetof(NRF_PWM_Type, EVENTS_SEQEND[1]),
+    NRF_PWM_EVENT_PWMPERIODEND = offsetof(NRF_PWM_Type, EVENTS_PWMPERIODEND),
+    NRF_PWM_EVENT_LOOPSDONE = offsetof(NRF_PWM_Type, EVENTS_LOOPSDONE),
+} nrf_pwm_event_t;
+
+typedef enum {
+    NRF_PWM_SHORT_SEQEND0_STOP_MASK = 1u << 0,
+    NRF_PWM_SHORT_SEQEND1_STOP_MASK = 1u << 1,
+    NRF_PWM_SHORT_LOOPSDONE_SEQSTART0_MASK = 1u << 2,
+    NRF_PWM_SHORT_LOOPSDONE_SEQSTART1_MASK = 1u << 3,
+    NRF_PWM_SHORT_LOOPSDONE_STOP_MASK = 1u << 4,
+} nrf_pwm_short_mask_t;
+
+typedef enum {
+    NRF_PWM_INT_STOPPED_MASK = 1u << 1,
+    NRF_PWM_INT_SEQSTARTED0_MASK = 1u << 2,
+    NRF_PWM_INT_SEQSTARTED1_MASK = 1u << 3,
+    NRF_PWM_INT_SEQEND0_MASK = 1u << 4,
+    NRF_PWM_INT_SEQEND1_MASK = 1u << 5,
+    NRF_PWM_INT_PWMPERIODEND_MASK = 1u << 6,
+    NRF_PWM_INT_LOOPSDONE_MASK = 1u << 7,
+} nrf_pwm_int_mask_t;
+
+static inline void nrf_pwm_enable(NRF_PWM_Type* p_reg) {
+    p_reg->ENABLE = 1;
+}
+
+static inline void nrf_pwm_disable(NRF_PWM_Type* p_reg) {
+    p_reg->ENABLE = 0;
+}
+
+static inline void nrf_pwm_configure(NRF_PWM_Type* p_reg, nrf_pwm_clk_t base_clock, nrf_pwm_mode_t mode, uint16_t top_value) {
+    p_reg->PRESCALER = base_clock;
+    p_reg->MODE = mode;
+    p_reg->COUNTERTOP = top_value;
+}
+
+static inline void nrf_pwm_decoder_set(NRF_PWM_Type* p_reg, nrf_pwm_dec_load_t dec_load, nrf_pwm_dec_step_t dec_step) {
+    p_reg->DECODER_LOAD = dec_load;
+    p_reg->DECODER_MODE = dec_step;
+}
+
+static inline void nrf_pwm_pins_set(NRF_PWM_Type* p_reg, uint32_t out_pins[NRF_PWM_CHANNEL_COUNT]) {
+    for (int i = 0; i < NRF_PWM_CHANNEL_COUNT; i++) {
+        p_reg->PSEL_OUT[i] = out_pins[i];
+    }
+}
+
+static inline void nrf_pwm_loop_set(NRF_PWM_Type* p_reg, uint16_t loop_count) {
+    p_reg->LOOP = loop_count;
+}
+
+static inline void nrf_pwm_seq_ptr_set(NRF_PWM_Type* p_reg, uint8_t seq_id, uint16_t const* p_values) {
+    p_reg->SEQ[seq_id].PTR = p_values;
+}
+
+static inline void nrf_pwm_seq_cnt_set(NRF_PWM_Type* p_reg, uint8_t seq_id, uint16_t length) {
+    p_reg->SEQ[seq_id].CNT = length;
+}
+
+static inline void nrf_pwm_seq_refresh_set(NRF_PWM_Type* p_reg, uint8_t seq_id, uint32_t refresh) {
+    p_reg->SEQ[seq_id].REFRESH = refresh;
+}
+
+static inline void nrf_pwm_shorts_set(NRF_PWM_Type* p_reg, uint32_t mask) {
+    p_reg->SHORTS = mask;
+}
+
+static inline void nrf_pwm_task_trigger(NRF_PWM_Type* p_reg, nrf_pwm_task_t task) {
+    sim_task_trigger(&p_reg->periph, task);
+}
+
+static inline void nrf_pwm_event_clear(NRF_PWM_Type* p_reg, nrf_pwm_event_t event) {
+    SIM_REG(p_reg, event) = 0;
+}
+
+static inline bool nrf_pwm_event_check(NRF_PWM_Type const* p_reg, nrf_pwm_event_t event) {
+    return SIM_REG(p_reg, event);
+}
@@ -0,0 +1,136 @@
+#pragma once
+
+/* Simulated subset of nrf HAL QDEC. Rotation is injected with sim_qdec_rotate. */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <zephyr/kernel.h>
+
+#include "sim/periph.h"
+
+typedef enum {
+    NRF_QDEC_SAMPLEPER_128us,
+    NRF_QDEC_SAMPLEPER_256us,
+    NRF_QDEC_SAMPLEPER_512us,
+    NRF_QDEC_SAMPLEPER_1024us,
+    NRF_QDEC_SAMPLEPER_2048us,
+    NRF_QDEC_SAMPLEPER_4096us,
+    NRF_QDEC_SAMPLEPER_8192us,
+    NRF_QDEC_SAMPLEPER_16384us,
+} nrf_qdec_sampleper_t;
+
+typedef enum {
+    NRF_QDEC_REPORTPER_10,
+    NRF_QDEC_REPORTPER_40,
+    NRF_QDEC_REPORTPER_80,
+    NRF_QDEC_REPORTPER_120,
+    NRF_QDEC_REPORTPER_160,
+    NRF_QDEC_REPORTPER_200,
+    NRF_QDEC_REPORTPER_240,
+    NRF_QDEC_REPORTPER_280,
+    NRF_QDEC_REPORTPER_1,
+} nrf_qdec_reportper_t;
+
+#define NRF_QDEC_LED_NOT_CONNECTED UINT32_MAX
+
+typedef struct {
+    struct sim_periph periph;
+    sim_reg_t TASKS_START;
+    sim_reg_t TASKS_STOP;
+    sim_reg_t TASKS_READCLRACC;
+    sim_reg_t EVENTS_SAMPLERDY;
+    sim_reg_t EVENTS_REPORTRDY;
+    uint32_t SHORTS;
+    uint32_t ENABLE;
+    uint32_t SAMPLEPER;
+    uint32_t REPORTPER;
+    int32_t ACC;
+    int32_t ACCREAD;
+    uint32_t PSEL_LED;
+    uint32_t PSEL_A;
+    uint32_t PSEL_B;
+    uint32_t DBFEN;
+
+    // simulation state
+    bool running;
+    struct k_timer report_timer;
+} NRF_QDEC_Type;
+
+extern NRF_QDEC_Type sim_qdec;
+#define NRF_QDEC (&sim_qdec)
+
+typedef enum {
+    NRF_QDEC_TASK_START = offsetof(NRF_QDEC_Type, TASKS_START),
+    NRF_QDEC_TASK_STOP = offsetof(NRF_QDEC_Type, TASKS_STOP),
+    NRF_QDEC_TASK_READCLRACC = offsetof(NRF_QDEC_Type, TASKS_READCLRACC),
+} nrf_qdec_task_t;
+
+typedef enum {
+    NRF_QDEC_EVENT_SAMPLERDY = offsetof(NRF_QDEC_Type, EVENTS_SAMPLERDY),
+    NRF_QDEC_EVENT_REPORTRDY = offsetof(NRF_QDEC_Type, EVENTS_REPORTRDY),
+} nrf_qdec_event_t;
+
+typedef enum {
+    NRF_QDEC_SHORT_REPORTRDY_READCLRACC_MASK = 1u << 0,
+} nrf_qdec_short_mask_t;
+
+typedef enum {
+    NRF_QDEC_INT_SAMPLERDY_MASK = 1u << 0,
+    NRF_QDEC_INT_REPORTRDY_MASK = 1u << 1,
+} nrf_qdec_int_mask_t;
+
+static inline void nrf_qdec_enable(NRF_QDEC_Type* p_reg) {
+    p_reg->ENABLE = 1;
+}
+
+static inline void nrf_qdec_disable(NRF_QDEC_Type* p_reg) {
+    p_reg->ENABLE = 0;
+}
+
+static inline void nrf_qdec_task_trigger(NRF_QDEC_Type* p_reg, nrf_qdec_task_t task) {
+    sim_task_trigger(&p_reg->periph, task);
+}
+
+static inline void nrf_qdec_event_clear(NRF_QDEC_Type* p_reg, nrf_qdec_event_t event) {
+    SIM_REG(p_reg, event) = 0;
+}
+
+static inline bool nrf_qdec_event_check(NRF_QDEC_Type const* p_reg, nrf_qdec_event_t event) {
+    return SIM_REG(p_reg, event);
+}
+
+static inline void nrf_qdec_int_enable(NRF_QDEC_Type* p_reg, uint32_t mask) {
+    p_reg->periph.inten |= mask;
+}
+
+static inline void nrf_qdec_shorts_enable(NRF_QDEC_Type* p_reg, uint32_t mask) {
+    p_reg->SHORTS |= mask;
+}
+
+static inline void nrf_qdec_pins_set(NRF_QDEC_Type* p_reg, uint32_t phase_a_pin, uint32_t phase_b_pin, uint32_t led_pin) {
+    p_reg->PSEL_A = phase_a_pin;
+    p_reg->PSEL_B = phase_b_pin;
+    p_reg->PSEL_LED = led_pin;
+}
+
+static inline void nrf_qdec_sampleper_set(NRF_QDEC_Type* p_reg, nrf_qdec_sampleper_t sampleper) {
+    p_reg->SAMPLEPER = sampleper;
+}
+
+static inline void nrf_qdec_reportper_set(NRF_QDEC_Type* p_reg, nrf_qdec_reportper_t reportper) {
+    p_reg->REPORTPER = reportper;
+}
+
+static inline void nrf_qdec_dbfen_enable(NRF_QDEC_Type* p_reg) {
+    p_reg->DBFEN = 1;
+}
+
+static inline void nrf_qdec_dbfen_disable(NRF_QDEC_Type* p_reg) {
+    p_reg->DBFEN = 0;
+}
+
+static inline int32_t nrf_qdec_accread_get(NRF_QDEC_Type const* p_reg) {
+    return p_reg->ACCREAD;
+}
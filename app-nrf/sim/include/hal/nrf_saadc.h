@@ -0,0 +1,183 @@
+#pragma once
+
+/* Simulated subset of nrf HAL SAADC, one-shot sampling of single-ended inputs.
+ * Input voltages are set with sim_saadc_input_set_mv.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <zephyr/kernel.h>
+
+#include "sim/periph.h"
+
+#define NRF_SAADC_CHANNEL_COUNT 8
+
+typedef int16_t nrf_saadc_value_t;
+
+typedef enum {
+    NRF_SAADC_RESOLUTION_8BIT,
+    NRF_SAADC_RESOLUTION_10BIT,
+    NRF_SAADC_RESOLUTION_12BIT,
+    NRF_SAADC_RESOLUTION_14BIT,
+} nrf_saadc_resolution_t;
+
+typedef enum {
+    NRF_SAADC_INPUT_DISABLED,
+    NRF_SAADC_INPUT_AIN0,
+    NRF_SAADC_INPUT_AIN1,
+    NRF_SAADC_INPUT_AIN2,
+    NRF_SAADC_INPUT_AIN3,
+    NRF_SAADC_INPUT_AIN4,
+    NRF_SAADC_INPUT_AIN5,
+    NRF_SAADC_INPUT_AIN6,
+    NRF_SAADC_INPUT_AIN7,
+    NRF_SAADC_INPUT_VDD,
+} nrf_saadc_input_t;
+
+typedef enum {
+    NRF_SAADC_RESISTOR_DISABLED,
+    NRF_SAADC_RESISTOR_PULLDOWN,
+    NRF_SAADC_RESISTOR_PULLUP,
+    NRF_SAADC_RESISTOR_VDD1_2,
+} nrf_saadc_resistor_t;
+
+typedef enum {
+    NRF_SAADC_GAIN1_6,
+    NRF_SAADC_GAIN1_5,
+    NRF_SAADC_GAIN1_4,
+    NRF_SAADC_GAIN1_3,
+    NRF_SAADC_GAIN1_2,
+    NRF_SAADC_GAIN1,
+    NRF_SAADC_GAIN2,
+    NRF_SAADC_GAIN4,
+} nrf_saadc_gain_t;
+
+typedef enum {
+    NRF_SAADC_REFERENCE_INTERNAL,
+    NRF_SAADC_REFERENCE_VDD4,
+} nrf_saadc_reference_t;
+
+typedef enum {
+    NRF_SAADC_ACQTIME_3US,
+    NRF_SAADC_ACQTIME_5US,
+    NRF_SAADC_ACQTIME_10US,
+    NRF_SAADC_ACQTIME_15US,
+    NRF_SAADC_ACQTIME_20US,
+    NRF_SAADC_ACQTIME_40US,
+} nrf_saadc_acqtime_t;
+
+typedef enum {
+    NRF_SAADC_MODE_SINGLE_ENDED,
+    NRF_SAADC_MODE_DIFFERENTIAL,
+} nrf_saadc_mode_t;
+
+typedef enum {
+    NRF_SAADC_BURST_DISABLED,
+    NRF_SAADC_BURST_ENABLED,
+} nrf_saadc_burst_t;
+
+typedef struct {
+    nrf_saadc_resistor_t resistor_p;
+    nrf_saadc_resistor_t resistor_n;
+    nrf_saadc_gain_t gain;
+    nrf_saadc_reference_t reference;
+    nrf_saadc_acqtime_t acq_time;
+    nrf_saadc_mode_t mode;
+    nrf_saadc_burst_t burst;
+} nrf_saadc_channel_config_t;
+
+typedef struct {
+    struct sim_periph periph;
+    sim_reg_t TASKS_START;
+    sim_reg_t TASKS_SAMPLE;
+    sim_reg_t TASKS_STOP;
+    sim_reg_t EVENTS_STARTED;
+    sim_reg_t EVENTS_END;
+    sim_reg_t EVENTS_DONE;
+    sim_reg_t EVENTS_RESULTDONE;
+    sim_reg_t EVENTS_STOPPED;
+    uint32_t ENABLE;
+    struct {
+        nrf_saadc_channel_config_t CONFIG;
+        nrf_saadc_input_t PSELP;
+        nrf_saadc_input_t PSELN;
+    } CH[NRF_SAADC_CHANNEL_COUNT];
+    nrf_saadc_resolution_t RESOLUTION;
+    nrf_saadc_value_t* RESULT_PTR;
+    uint16_t RESULT_MAXCNT;
+    uint16_t RESULT_AMOUNT;
+
+    // simulation state
+    bool started;
+    struct k_timer sample_timer;
+} NRF_SAADC_Type;
+
+extern NRF_SAADC_Type sim_saadc;
+#define NRF_SAADC (&sim_saadc)
+
+typedef enum {
+    NRF_SAADC_TASK_START = offsetof(NRF_SAADC_Type, TASKS_START),
+    NRF_SAADC_TASK_SAMPLE = offsetof(NRF_SAADC_Type, TASKS_SAMPLE),
+    NRF_SAADC_TASK_STOP = offsetof(NRF_SAADC_Type, TASKS_STOP),
+} nrf_saadc_task_t;
+
+typedef enum {
+    NRF_SAADC_EVENT_STARTED = offsetof(NRF_SAADC_Type, EVENTS_STARTED),
+    NRF_SAADC_EVENT_END = offsetof(NRF_SAADC_Type, EVENTS_END),
+    NRF_SAADC_EVENT_DONE = offsetof(NRF_SAADC_Type, EVENTS_DONE),
+    NRF_SAADC_EVENT_RESULTDONE = offsetof(NRF_SAADC_Type, EVENTS_RESULTDONE),
+    NRF_SAADC_EVENT_STOPPED = offsetof(NRF_SAADC_Type, EVENTS_STOPPED),
+} nrf_saadc_event_t;
+
+typedef enum {
+    NRF_SAADC_INT_STARTED = 1u << 0,
+    NRF_SAADC_INT_END = 1u << 1,
+    NRF_SAADC_INT_DONE = 1u << 2,
+    NRF_SAADC_INT_RESULTDONE = 1u << 3,
+    NRF_SAADC_INT_STOPPED = 1u << 5,
+} nrf_saadc_int_mask_t;
+
+static inline void nrf_saadc_enable(NRF_SAADC_Type* p_reg) {
+    p_reg->ENABLE = 1;
+}
+
+static inline void nrf_saadc_disable(NRF_SAADC_Type* p_reg) {
+    p_reg->ENABLE = 0;
+}
+
+static inline void nrf_saadc_task_trigger(NRF_SAADC_Type* p_reg, nrf_saadc_task_t task) {
+    sim_task_trigger(&p_reg->periph, task);
+}
+
+static inline void nrf_saadc_event_clear(NRF_SAADC_Type* p_reg, nrf_saadc_event_t event) {
+    SIM_REG(p_reg, event) = 0;
+}
+
+static inline bool nrf_saadc_event_check(NRF_SAADC_Type const* p_reg, nrf_saadc_event_t event) {
+    return SIM_REG(p_reg, event);
+}
+
+static inline void nrf_saadc_int_set(NRF_SAADC_Type* p_reg, uint32_t mask) {
+    p_reg->periph.inten = mask;
+}
+
+static inline void nrf_saadc_resolution_set(NRF_SAADC_Type* p_reg, nrf_saadc_resolution_t resolution) {
+    p_reg->RESOLUTION = resolution;
+}
+
+static inline void nrf_saadc_buffer_init(NRF_SAADC_Type* p_reg, nrf_saadc_value_t* p_buffer, uint32_t size) {
+    p_reg->RESULT_PTR = p_buffer;
+    p_reg->RESULT_MAXCNT = size;
+}
+
+static inline void nrf_saadc_channel_init(NRF_SAADC_Type* p_reg, uint8_t channel, nrf_saadc_channel_config_t const* config) {
+    p_reg->CH[channel].CONFIG = *config;
+}
+
+static inline void nrf_saadc_channel_input_set(NRF_SAADC_Type* p_reg, uint8_t channel,
+                                               nrf_saadc_input_t pselp, nrf_saadc_input_t pseln) {
+    p_reg->CH[channel].PSELP = pselp;
+    p_reg->CH[channel].PSELN = pseln;
+}
@@ -0,0 +1,166 @@
+#pragma once
+
+/* Simulated subset of nrf HAL SPIM with EasyDMA. Transfer duration is derived from the configured
+ * frequency, data is exchanged with a device model set by sim_spim_transfer_cb_set.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <zephyr/kernel.h>
+
+#include "sim/periph.h"
+
+typedef enum {
+    NRF_SPIM_MODE_0,  // CPOL 0, CPHA 0
+    NRF_SPIM_MODE_1,  // CPOL 0, CPHA 1
+    NRF_SPIM_MODE_2,  // CPOL 1, CPHA 0
+    NRF_SPIM_MODE_3,  // CPOL 1, CPHA 1
+} nrf_spim_mode_t;
+
+typedef enum {
+    NRF_SPIM_BIT_ORDER_MSB_FIRST,
+    NRF_SPIM_BIT_ORDER_LSB_FIRST,
+} nrf_spim_bit_order_t;
+
+// unlike the real HAL, the values are frequencies in Hz
+typedef enum {
+    NRF_SPIM_FREQ_125K = 125000,
+    NRF_SPIM_FREQ_250K = 250000,
+    NRF_SPIM_FREQ_500K = 500000,
+    NRF_SPIM_FREQ_1M = 1000000,
+    NRF_SPIM_FREQ_2M = 2000000,
+    NRF_SPIM_FREQ_4M = 4000000,
+    NRF_SPIM_FREQ_8M = 8000000,
+} nrf_spim_frequency_t;
+
+typedef struct {
+    struct sim_periph periph;
+    sim_reg_t TASKS_START;
+    sim_reg_t TASKS_STOP;
+    sim_reg_t EVENTS_STOPPED;
+    sim_reg_t EVENTS_ENDRX;
+    sim_reg_t EVENTS_END;
+    sim_reg_t EVENTS_ENDTX;
+    sim_reg_t EVENTS_STARTED;
+    uint32_t ENABLE;
+    uint32_t FREQUENCY;
+    nrf_spim_mode_t MODE;
+    nrf_spim_bit_order_t BIT_ORDER;
+    uint8_t ORC;
+    uint32_t PSEL_SCK;
+    uint32_t PSEL_MOSI;
+    uint32_t PSEL_MISO;
+    const uint8_t* TXD_PTR;
+    size_t TXD_MAXCNT;
+    size_t TXD_AMOUNT;
+    uint8_t* RXD_PTR;
+    size_t RXD_MAXCNT;
+    size_t RXD_AMOUNT;
+
+    // simulation state, buffers are latched on START
+    bool busy;
+    const uint8_t* tx_ptr;
+    size_t tx_len;
+    uint8_t* rx_ptr;
+    size_t rx_len;
+    struct k_timer end_timer;
+} NRF_SPIM_Type;
+
+extern NRF_SPIM_Type sim_spim0;
+#define NRF_SPIM0 (&sim_spim0)
+
+typedef enum {
+    NRF_SPIM_TASK_START = offsetof(NRF_SPIM_Type, TASKS_START),
+    NRF_SPIM_TASK_STOP = offsetof(NRF_SPIM_Type, TASKS_STOP),
+} nrf_spim_task_t;
+
+typedef enum {
+    NRF_SPIM_EVENT_STOPPED = offsetof(NRF_SPIM_Type, EVENTS_STOPPED),
+    NRF_SPIM_EVENT_ENDRX = offsetof(NRF_SPIM_Type, EVENTS_ENDRX),
+    NRF_SPIM_EVENT_END = offsetof(NRF_SPIM_Type, EVENTS_END),
+    NRF_SPIM_EVENT_ENDTX = offsetof(NRF_SPIM_Type, EVENTS_ENDTX),
+    NRF_SPIM_EVENT_STARTED = offsetof(NRF_SPIM_Type, EVENTS_STARTED),
+} nrf_spim_event_t;
+
+typedef enum {
+    NRF_SPIM_INT_STOPPED_MASK = 1u << 1,
+    NRF_SPIM_INT_ENDRX_MASK = 1u << 4,
+    NRF_SPIM_INT_END_MASK = 1u << 6,
+    NRF_SPIM_INT_ENDTX_MASK = 1u << 8,
+    NRF_SPIM_INT_STARTED_MASK = 1u << 19,
+} nrf_spim_int_mask_t;
+
+/**
+ * @brief Apply pin levels driven by SPIM (SCK idle level depends on mode).
+ */
+void sim_spim_update_pins(NRF_SPIM_Type* p_reg);
+
+static inline void nrf_spim_task_trigger(NRF_SPIM_Type* p_reg, nrf_spim_task_t task) {
+    sim_task_trigger(&p_reg->periph, task);
+}
+
+static inline uint32_t nrf_spim_task_address_get(NRF_SPIM_Type const* p_reg, nrf_spim_task_t task) {
+    return SIM_REG_ADDRESS(p_reg, task);
+}
+
+static inline bool nrf_spim_event_check(NRF_SPIM_Type const* p_reg, nrf_spim_event_t event) {
+    return SIM_REG(p_reg, event);
+}
+
+static inline void nrf_spim_event_clear(NRF_SPIM_Type* p_reg, nrf_spim_event_t event) {
+    SIM_REG(p_reg, event) = 0;
+}
+
+static inline uint32_t nrf_spim_event_address_get(NRF_SPIM_Type const* p_reg, nrf_spim_event_t event) {
+    return SIM_REG_ADDRESS(p_reg, event);
+}
+
+static inline void nrf_spim_int_enable(NRF_SPIM_Type* p_reg, uint32_t mask) {
+    p_reg->periph.inten |= mask;
+}
+
+static inline void nrf_spim_int_disable(NRF_SPIM_Type* p_reg, uint32_t mask) {
+    p_reg->periph.inten &= ~mask;
+}
+
+static inline void nrf_spim_enable(NRF_SPIM_Type* p_reg) {
+    p_reg->ENABLE = 1;
+    sim_spim_update_pins(p_reg);
+}
+
+static inline void nrf_spim_disable(NRF_SPIM_Type* p_reg) {
+    p_reg->ENABLE = 0;
+    sim_spim_update_pins(p_reg);
+}
+
+static inline void nrf_spim_pins_set(NRF_SPIM_Type* p_reg, uint32_t sck_pin, uint32_t mosi_pin, uint32_t miso_pin) {
+    p_reg->PSEL_SCK = sck_pin;
+    p_reg->PSEL_MOSI = mosi_pin;
+    p_reg->PSEL_MISO = miso_pin;
+}
+
+static inline void nrf_spim_frequency_set(NRF_SPIM_Type* p_reg, nrf_spim_frequency_t frequency) {
+    p_reg->FREQUENCY = frequency;
+}
+
+static inline void nrf_spim_configure(NRF_SPIM_Type* p_reg, nrf_spim_mode_t spi_mode, nrf_spim_bit_order_t spi_bit_order) {
+    p_reg->MODE = spi_mode;
+    p_reg->BIT_ORDER = spi_bit_order;
+    sim_spim_update_pins(p_reg);
+}
+
+static inline void nrf_spim_orc_set(NRF_SPIM_Type* p_reg, uint8_t orc) {
+    p_reg->ORC = orc;
+}
+
+static inline void nrf_spim_tx_buffer_set(NRF_SPIM_Type* p_reg, uint8_t const* p_buffer, size_t length) {
+    p_reg->TXD_PTR = p_buffer;
+    p_reg->TXD_MAXCNT = length;
+}
+
+static inline void nrf_spim_rx_buffer_set(NRF_SPIM_Type* p_reg, uint8_t* p_buffer, size_t length) {
+    p_reg->RXD_PTR = p_buffer;
+    p_reg->RXD_MAXCNT = length;
+}
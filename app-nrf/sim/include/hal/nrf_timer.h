@@ -0,0 +1,178 @@
+#pragma once
+
+/* Simulated subset of nrf HAL TIMER, timer mode only. Compare events are scheduled on the virtual clock,
+ * so their resolution is limited to a kernel tick.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <zephyr/kernel.h>
+
+#include "sim/periph.h"
+
+#define NRF_TIMER_CC_COUNT 6
+
+typedef struct {
+    struct sim_periph periph;
+    sim_reg_t TASKS_START;
+    sim_reg_t TASKS_STOP;
+    sim_reg_t TASKS_COUNT;
+    sim_reg_t TASKS_CLEAR;
+    sim_reg_t TASKS_SHUTDOWN;
+    sim_reg_t TASKS_CAPTURE[NRF_TIMER_CC_COUNT];
+    sim_reg_t EVENTS_COMPARE[NRF_TIMER_CC_COUNT];
+    uint32_t SHORTS;
+    uint32_t MODE;
+    uint32_t BITMODE;
+    uint32_t PRESCALER;
+    uint32_t CC[NRF_TIMER_CC_COUNT];
+
+    // simulation state
+    bool running;
+    uint32_t cc_used;
+    uint32_t base_count;
+    uint64_t base_time_us;
+    struct k_timer compare_timers[NRF_TIMER_CC_COUNT];
+} NRF_TIMER_Type;
+
+extern NRF_TIMER_Type sim_timers[5];
+#define NRF_TIMER0 (&sim_timers[0])
+#define NRF_TIMER1 (&sim_timers[1])
+#define NRF_TIMER2 (&sim_timers[2])
+#define NRF_TIMER3 (&sim_timers[3])
+#define NRF_TIMER4 (&sim_timers[4])
+
+typedef enum {
+    NRF_TIMER_TASK_START = offsetof(NRF_TIMER_Type, TASKS_START),
+    NRF_TIMER_TASK_STOP = offsetof(NRF_TIMER_Type, TASKS_STOP),
+    NRF_TIMER_TASK_COUNT = offsetof(NRF_TIMER_Type, TASKS_COUNT),
+    NRF_TIMER_TASK_CLEAR = offsetof(NRF_TIMER_Type, TASKS_CLEAR),
+    NRF_TIMER_TASK_SHUTDOWN = offsetof(NRF_TIMER_Type, TASKS_SHUTDOWN),
+    NRF_TIMER_TASK_CAPTURE0 = offsetof(NRF_TIMER_Type, TASKS_CAPTURE[0]),
+    NRF_TIMER_TASK_CAPTURE1 = offsetof(NRF_TIMER_Type, TASKS_CAPTURE[1]),
+    NRF_TIMER_TASK_CAPTURE2 = offsetof(NRF_TIMER_Type, TASKS_CAPTURE[2]),
+    NRF_TIMER_TASK_CAPTURE3 = offsetof(NRF_TIMER_Type, TASKS_CAPTURE[3]),
+    NRF_TIMER_TASK_CAPTURE4 = offsetof(NRF_TIMER_Type, TASKS_CAPTURE[4]),
+    NRF_TIMER_TASK_CAPTURE5 = offsetof(NRF_TIMER_Type, TASKS_CAPTURE[5]),
+} nrf_timer_task_t;
+
+typedef enum {
+    NRF_TIMER_EVENT_COMPARE0 = offsetof(NRF_TIMER_Type, EVENTS_COMPARE[0]),
+    NRF_TIMER_EVENT_COMPARE1 = offsetof(NRF_TIMER_Type, EVENTS_COMPARE[1]),
+    NRF_TIMER_EVENT_COMPARE2 = offsetof(NRF_TIMER_Type, EVENTS_COMPARE[2]),
+    NRF_TIMER_EVENT_COMPARE3 = offsetof(NRF_TIMER_Type, EVENTS_COMPARE[3]),
+    NRF_TIMER_EVENT_COMPARE4 = offsetof(NRF_TIMER_Type, EVENTS_COMPARE[4]),
+    NRF_TIMER_EVENT_COMPARE5 = offsetof(NRF_TIMER_Type, EVENTS_COMPARE[5]),
+} nrf_timer_event_t;
+
+typedef enum {
+    NRF_TIMER_CC_CHANNEL0, NRF_TIMER_CC_CHANNEL1, NRF_TIMER_CC_CHANNEL2,
+    NRF_TIMER_CC_CHANNEL3, NRF_TIMER_CC_CHANNEL4, NRF_TIMER_CC_CHANNEL5,
+} nrf_timer_cc_channel_t;
+
+typedef enum {
+    NRF_TIMER_SHORT_COMPARE0_CLEAR_MASK = 1u << 0,
+    NRF_TIMER_SHORT_COMPARE1_CLEAR_MASK = 1u << 1,
+    NRF_TIMER_SHORT_COMPARE2_CLEAR_MASK = 1u << 2,
+    NRF_TIMER_SHORT_COMPARE3_CLEAR_MASK = 1u << 3,
+    NRF_TIMER_SHORT_COMPARE4_CLEAR_MASK = 1u << 4,
+    NRF_TIMER_SHORT_COMPARE5_CLEAR_MASK = 1u << 5,
+    NRF_TIMER_SHORT_COMPARE0_STOP_MASK = 1u << 8,
+    NRF_TIMER_SHORT_COMPARE1_STOP_MASK = 1u << 9,
+    NRF_TIMER_SHORT_COMPARE2_STOP_MASK = 1u << 10,
+    NRF_TIMER_SHORT_COMPARE3_STOP_MASK = 1u << 11,
+    NRF_TIMER_SHORT_COMPARE4_STOP_MASK = 1u << 12,
+    NRF_TIMER_SHORT_COMPARE5_STOP_MASK = 1u << 13,
+} nrf_timer_short_mask_t;
+
+typedef enum {
+    NRF_TIMER_INT_COMPARE0_MASK = 1u << 16,
+    NRF_TIMER_INT_COMPARE1_MASK = 1u << 17,
+    NRF_TIMER_INT_COMPARE2_MASK = 1u << 18,
+    NRF_TIMER_INT_COMPARE3_MASK = 1u << 19,
+    NRF_TIMER_INT_COMPARE4_MASK = 1u << 20,
+    NRF_TIMER_INT_COMPARE5_MASK = 1u << 21,
+} nrf_timer_int_mask_t;
+
+typedef enum {
+    NRF_TIMER_MODE_TIMER = 0,
+} nrf_timer_mode_t;
+
+typedef enum {
+    NRF_TIMER_BIT_WIDTH_16 = 0,
+    NRF_TIMER_BIT_WIDTH_8 = 1,
+    NRF_TIMER_BIT_WIDTH_24 = 2,
+    NRF_TIMER_BIT_WIDTH_32 = 3,
+} nrf_timer_bit_width_t;
+
+typedef enum {
+    NRF_TIMER_FREQ_16MHz = 0,
+    NRF_TIMER_FREQ_8MHz,
+    NRF_TIMER_FREQ_4MHz,
+    NRF_TIMER_FREQ_2MHz,
+    NRF_TIMER_FREQ_1MHz,
+    NRF_TIMER_FREQ_500kHz,
+    NRF_TIMER_FREQ_250kHz,
+    NRF_TIMER_FREQ_125kHz,
+    NRF_TIMER_FREQ_62500Hz,
+    NRF_TIMER_FREQ_31250Hz,
+} nrf_timer_frequency_t;
+
+/**
+ * @brief Reschedule compare events after the counter or CC values have changed.
+ */
+void sim_timer_reschedule(NRF_TIMER_Type* p_reg);
+
+static inline void nrf_timer_task_trigger(NRF_TIMER_Type* p_reg, nrf_timer_task_t task) {
+    sim_task_trigger(&p_reg->periph, task);
+}
+
+static inline uint32_t nrf_timer_task_address_get(NRF_TIMER_Type const* p_reg, nrf_timer_task_t task) {
+    return SIM_REG_ADDRESS(p_reg, task);
+}
+
+static inline bool nrf_timer_event_check(NRF_TIMER_Type const* p_reg, nrf_timer_event_t event) {
+    return SIM_REG(p_reg, event);
+}
+
+static inline void nrf_timer_event_clear(NRF_TIMER_Type* p_reg, nrf_timer_event_t event) {
+    SIM_REG(p_reg, event) = 0;
+}
+
+static inline uint32_t nrf_timer_event_address_get(NRF_TIMER_Type const* p_reg, nrf_timer_event_t event) {
+    return SIM_REG_ADDRESS(p_reg, event);
+}
+
+static inline void nrf_timer_shorts_set(NRF_TIMER_Type* p_reg, uint32_t mask) {
+    p_reg->SHORTS = mask;
+}
+
+static inline void nrf_timer_int_enable(NRF_TIMER_Type* p_reg, uint32_t mask) {
+    p_reg->periph.inten |= mask;
+}
+
+static inline void nrf_timer_int_disable(NRF_TIMER_Type* p_reg, uint32_t mask) {
+    p_reg->periph.inten &= ~mask;
+}
+
+static inline void nrf_timer_mode_set(NRF_TIMER_Type* p_reg, nrf_timer_mode_t mode) {
+    p_reg->MODE = mode;
+}
+
+static inline void nrf_timer_bit_width_set(NRF_TIMER_Type* p_reg, nrf_timer_bit_width_t bit_width) {
+    p_reg->BITMODE = bit_width;
+    sim_timer_reschedule(p_reg);
+}
+
+static inline void nrf_timer_frequency_set(NRF_TIMER_Type* p_reg, nrf_timer_frequency_t frequency) {
+    p_reg->PRESCALER = frequency;
+    sim_timer_reschedule(p_reg);
+}
+
+static inline void nrf_timer_cc_set(NRF_TIMER_Type* p_reg, nrf_timer_cc_channel_t cc_channel, uint32_t cc_value) {
+    p_reg->CC[cc_channel] = cc_value;
+    p_reg->cc_used |= 1u << cc_channel;
+    sim_timer_reschedule(p_reg);
+}
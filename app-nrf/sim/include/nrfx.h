@@ -0,0 +1,11 @@
+#pragma once
+
+/* Simulated subset of nrfx common definitions. */
+
+#include <stdbool.h>
+
+#include "sim/periph.h"
+
+static inline bool nrfx_is_in_ram(void const* p_object) {
+    return sim_is_in_ram(p_object);
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <hal/nrf_saadc.h>
+
+/**
+ * @brief Set voltage on an analog input sampled by SAADC.
+ */
+void sim_saadc_input_set_mv(nrf_saadc_input_t input, int32_t mv);
+
+/**
+ * @brief Rotate the encoder connected to QDEC by a number of steps (sign determines direction).
+ */
+void sim_qdec_rotate(int32_t steps);
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief Drive a pin from outside, as an external device would. Outputs of the SoC take precedence.
+ */
+void sim_gpio_drive(uint32_t pin, bool level);
+
+/**
+ * @brief Stop driving a pin from outside, its level is then determined by pull resistor configuration.
+ */
+void sim_gpio_release(uint32_t pin);
+
+/**
+ * @brief Get actual line level of a pin, regardless of its configuration.
+ */
+bool sim_gpio_level_get(uint32_t pin);
+
+/**
+ * @brief Drive a pin by a peripheral (e.g. GPIOTE task or SPIM), overriding GPIO configuration.
+ */
+void sim_gpio_periph_drive(uint32_t pin, bool level);
+
+/**
+ * @brief Return control over the pin to GPIO.
+ */
+void sim_gpio_periph_release(uint32_t pin);
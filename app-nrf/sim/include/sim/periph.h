@@ -0,0 +1,70 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Simulated peripherals keep their registers in plain structs. Tasks and events are addressed
+ * by their offset within the struct, same as in nrf HAL, so that PPI can connect them by address.
+ * Addresses are truncated to 32 bits, therefore the simulation requires 32-bit native_sim (the default).
+ */
+
+typedef volatile uint32_t sim_reg_t;
+
+struct sim_periph;
+
+/**
+ * @brief Called when a task of the peripheral is triggered, either by software or by PPI.
+ */
+typedef void (*sim_task_handler)(struct sim_periph* periph, uint32_t task);
+
+struct sim_periph {
+    sim_task_handler task_handler;
+    unsigned int irq;
+    uint32_t inten;
+    size_t size;
+};
+
+#define SIM_PERIPH_INIT(_type, _task_handler, _irq) \
+    {.task_handler = (_task_handler), .irq = (_irq), .size = sizeof(_type)}
+
+#define SIM_REG(p_reg, offset) (*(sim_reg_t*) ((uint8_t*) (p_reg) + (offset)))
+
+#define SIM_REG_ADDRESS(p_reg, offset) ((uint32_t) (uintptr_t) ((uint8_t*) (p_reg) + (offset)))
+
+/**
+ * @brief Trigger a task of a peripheral.
+ */
+void sim_task_trigger(struct sim_periph* periph, uint32_t task);
+
+/**
+ * @brief Trigger a task by its address, e.g. PPI TEP.
+ */
+void sim_task_trigger_address(uint32_t address);
+
+/**
+ * @brief Generate an event: set the event register, trigger tasks connected via PPI and
+ * pend the peripheral interrupt if any of the bits in @p int_mask is enabled.
+ */
+void sim_event_generate(struct sim_periph* periph, uint32_t event, uint32_t int_mask);
+
+/**
+ * @brief Trigger tasks connected via enabled PPI channels to the event at given address.
+ */
+void sim_ppi_event_dispatch(uint32_t event_address);
+
+/**
+ * @brief Current time of the virtual clock.
+ *
+ * The virtual clock is native_sim simulated time, so it only advances when the kernel
+ * sleeps or busy-waits, and is independent of the host wall clock.
+ */
+uint64_t sim_clock_now_us(void);
+
+/**
+ * @brief Whether the object is accessible by simulated EasyDMA.
+ *
+ * Read-only data of the executable plays the role of flash, anything else (data, bss, host stacks
+ * and heap) is RAM.
+ */
+bool sim_is_in_ram(const void* ptr);
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Device model callback, called when SPIM transfer ends.
+ *
+ * The model can determine addressed device by CS pin levels (see sim_gpio_level_get).
+ * RX buffer is pre-filled with ORC value.
+ */
+typedef void (*sim_spim_transfer_cb)(const uint8_t* tx, size_t tx_len, uint8_t* rx, size_t rx_len, void* user_data);
+
+void sim_spim_transfer_cb_set(sim_spim_transfer_cb callback, void* user_data);
@@ -0,0 +1,63 @@
+#include "sim/periph.h"
+
+#include <board_irq.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/util.h>
+
+#include <hal/nrf_clock.h>
+#include <hal/nrf_gpiote.h>
+#include <hal/nrf_pwm.h>
+#include <hal/nrf_qdec.h>
+#include <hal/nrf_saadc.h>
+#include <hal/nrf_spim.h>
+#include <hal/nrf_timer.h>
+
+// all peripherals which have tasks, used to resolve task address
+static struct sim_periph* const periphs[] = {
+    &NRF_CLOCK->periph,
+    &NRF_GPIOTE->periph,
+    &NRF_PWM0->periph,
+    &NRF_QDEC->periph,
+    &NRF_SAADC->periph,
+    &NRF_SPIM0->periph,
+    &NRF_TIMER0->periph,
+    &NRF_TIMER1->periph,
+    &NRF_TIMER2->periph,
+    &NRF_TIMER3->periph,
+    &NRF_TIMER4->periph,
+};
+
+// provided by the host linker and libc startup code, text and read-only data lie between them
+extern const char __executable_start[];
+extern char __data_start[];
+
+uint64_t sim_clock_now_us(void) {
+    return k_ticks_to_us_floor64(k_uptime_ticks());
+}
+
+bool sim_is_in_ram(const void* ptr) {
+    uintptr_t addr = (uintptr_t) ptr;
+    return addr < (uintptr_t) __executable_start || addr >= (uintptr_t) __data_start;
+}
+
+void sim_task_trigger(struct sim_periph* periph, uint32_t task) {
+    periph->task_handler(periph, task);
+}
+
+void sim_task_trigger_address(uint32_t address) {
+    for (size_t i = 0; i < ARRAY_SIZE(periphs); i++) {
+        uint32_t base = (uint32_t) (uintptr_t) periphs[i];
+        if (address >= base && address < base + periphs[i]->size) {
+            sim_task_trigger(periphs[i], address - base);
+            return;
+        }
+    }
+}
+
+void sim_event_generate(struct sim_periph* periph, uint32_t event, uint32_t int_mask) {
+    SIM_REG(periph, event) = 1;
+    sim_ppi_event_dispatch(SIM_REG_ADDRESS(periph, event));
+    if (periph->inten & int_mask) {
+        posix_sw_set_pending_IRQ(periph->irq);
+    }
+}
@@ -0,0 +1,143 @@
+#include <hal/nrf_gpio.h>
+#include <hal/nrf_gpiote.h>
+#include <hal/nrf_ppi.h>
+#include <zephyr/kernel.h>
+
+#include "sim/gpio.h"
+#include "sim/periph.h"
+
+NRF_GPIO_Type sim_gpio_p0 = {};
+NRF_PPI_Type sim_ppi = {};
+
+static void sim_gpiote_task_handler(struct sim_periph* periph, uint32_t task);
+
+NRF_GPIOTE_Type sim_gpiote = {
+    .periph = SIM_PERIPH_INIT(NRF_GPIOTE_Type, sim_gpiote_task_handler, 6),
+};
+
+void sim_gpio_update(void) {
+    NRF_GPIO_Type* p = NRF_P0;
+    unsigned key = irq_lock();
+
+    for (uint32_t pin = 0; pin < NRF_GPIO_NUM_PINS; pin++) {
+        uint32_t bit = 1u << pin;
+        const struct sim_gpio_pin_cnf* cnf = &p->PIN_CNF[pin];
+        uint32_t level;
+        if (p->periph_driven & bit) {
+            level = p->periph_level & bit;
+        } else if (cnf->is_output) {
+            level = p->OUT & bit;
+        } else if (p->ext_driven & bit) {
+            level = p->ext_level & bit;
+        } else if (cnf->pull == NRF_GPIO_PIN_PULLUP) {
+            level = bit;
+        } else if (cnf->pull == NRF_GPIO_PIN_PULLDOWN) {
+            level = 0;
+        } else {
+            level = p->level & bit;  // floating, keeps previous level
+        }
+        p->level = (p->level & ~bit) | level;
+    }
+
+    uint32_t input_connected = 0;
+    bool detect = false;
+    for (uint32_t pin = 0; pin < NRF_GPIO_NUM_PINS; pin++) {
+        const struct sim_gpio_pin_cnf* cnf = &p->PIN_CNF[pin];
+        bool is_high = p->level & (1u << pin);
+        if (cnf->is_input_connected) {
+            input_connected |= 1u << pin;
+            detect |= (cnf->sense == NRF_GPIO_PIN_SENSE_HIGH && is_high) || (cnf->sense == NRF_GPIO_PIN_SENSE_LOW && !is_high);
+        }
+    }
+    p->IN = p->level & input_connected;
+
+    bool is_detect_rising = detect && !p->detect;
+    p->detect = detect;
+
+    irq_unlock(key);
+
+    if (is_detect_rising) {
+        sim_gpiote_port_event();
+    }
+}
+
+void sim_gpio_drive(uint32_t pin, bool level) {
+    NRF_P0->ext_driven |= 1u << pin;
+    NRF_P0->ext_level = (NRF_P0->ext_level & ~(1u << pin)) | ((uint32_t) level << pin);
+    sim_gpio_update();
+}
+
+void sim_gpio_release(uint32_t pin) {
+    NRF_P0->ext_driven &= ~(1u << pin);
+    sim_gpio_update();
+}
+
+bool sim_gpio_level_get(uint32_t pin) {
+    return NRF_P0->level & (1u << pin);
+}
+
+void sim_gpio_periph_drive(uint32_t pin, bool level) {
+    NRF_P0->periph_driven |= 1u << pin;
+    NRF_P0->periph_level = (NRF_P0->periph_level & ~(1u << pin)) | ((uint32_t) level << pin);
+    sim_gpio_update();
+}
+
+void sim_gpio_periph_release(uint32_t pin) {
+    NRF_P0->periph_driven &= ~(1u << pin);
+    sim_gpio_update();
+}
+
+void sim_gpiote_port_event(void) {
+    sim_event_generate(&NRF_GPIOTE->periph, NRF_GPIOTE_EVENT_PORT, NRF_GPIOTE_INT_PORT_MASK);
+}
+
+void nrf_gpiote_task_configure(NRF_GPIOTE_Type* p_reg, uint32_t idx, uint32_t pin,
+                               nrf_gpiote_polarity_t polarity, nrf_gpiote_outinit_t init_val) {
+    p_reg->CONFIG[idx].pin = pin;
+    p_reg->CONFIG[idx].polarity = polarity;
+    p_reg->CONFIG[idx].value = init_val;
+}
+
+void nrf_gpiote_task_enable(NRF_GPIOTE_Type* p_reg, uint32_t idx) {
+    p_reg->CONFIG[idx].is_task = true;
+    sim_gpio_periph_drive(p_reg->CONFIG[idx].pin, p_reg->CONFIG[idx].value);
+}
+
+void nrf_gpiote_task_disable(NRF_GPIOTE_Type* p_reg, uint32_t idx) {
+    p_reg->CONFIG[idx].is_task = false;
+    sim_gpio_periph_release(p_reg->CONFIG[idx].pin);
+}
+
+static void sim_gpiote_task_handler(struct sim_periph* periph, uint32_t task) {
+    NRF_GPIOTE_Type* p_reg = (NRF_GPIOTE_Type*) periph;
+    uint32_t idx = (task - NRF_GPIOTE_TASK_OUT_0) / sizeof(sim_reg_t) % NRF_GPIOTE_NUM_CHANNELS;
+    struct sim_gpiote_config* config = &p_reg->CONFIG[idx];
+    if (!config->is_task) {
+        return;
+    }
+
+    if (task < NRF_GPIOTE_TASK_SET_0) {
+        switch (config->polarity) {
+            case NRF_GPIOTE_POLARITY_LOTOHI: config->value = 1; break;
+            case NRF_GPIOTE_POLARITY_HITOLO: config->value = 0; break;
+            case NRF_GPIOTE_POLARITY_TOGGLE: config->value = !config->value; break;
+            default: break;
+        }
+    } else {
+        config->value = task < NRF_GPIOTE_TASK_CLR_0;
+    }
+    sim_gpio_periph_drive(config->pin, config->value);
+}
+
+void sim_ppi_event_dispatch(uint32_t event_address) {
+    for (uint32_t ch = 0; ch < NRF_PPI_NUM_CHANNELS; ch++) {
+        if ((NRF_PPI->CHEN & (1u << ch)) && NRF_PPI->CH[ch].EEP == event_address) {
+            if (NRF_PPI->CH[ch].TEP) {
+                sim_task_trigger_address(NRF_PPI->CH[ch].TEP);
+            }
+            if (NRF_PPI->FORK_TEP[ch]) {
+                sim_task_trigger_address(NRF_PPI->FORK_TEP[ch]);
+            }
+        }
+    }
+}
@@ -0,0 +1,37 @@
+#include <hal/nrf_clock.h>
+#include <hal/nrf_power.h>
+#include <posix_board_if.h>
+
+#include "sim/periph.h"
+
+static void sim_clock_task_handler(struct sim_periph* periph, uint32_t task);
+
+NRF_CLOCK_Type sim_clock = {
+    .periph = SIM_PERIPH_INIT(NRF_CLOCK_Type, sim_clock_task_handler, 0),
+    .HFCLKSTAT = NRF_CLOCK_HFCLK_LOW_ACCURACY,
+};
+
+NRF_POWER_Type sim_power;
+
+static void sim_clock_task_handler(struct sim_periph* periph, uint32_t task) {
+    NRF_CLOCK_Type* p_reg = (NRF_CLOCK_Type*) periph;
+
+    switch (task) {
+        case NRF_CLOCK_TASK_HFCLKSTART:
+            // crystal oscillator startup time is not simulated
+            p_reg->HFCLKSTAT = NRF_CLOCK_HFCLK_HIGH_ACCURACY;
+            sim_event_generate(periph, NRF_CLOCK_EVENT_HFCLKSTARTED, 0);
+            break;
+        case NRF_CLOCK_TASK_HFCLKSTOP:
+            p_reg->HFCLKSTAT = NRF_CLOCK_HFCLK_LOW_ACCURACY;
+            break;
+    }
+}
+
+void nrf_power_system_off(NRF_POWER_Type* p_reg) {
+    ARG_UNUSED(p_reg);
+
+    // wake up from System OFF is a reset, which is equivalent to restarting the simulation
+    posix_exit(0);
+    CODE_UNREACHABLE;
+}
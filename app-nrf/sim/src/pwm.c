@@ -0,0 +1,73 @@
+#include <hal/nrf_pwm.h>
+#include <zephyr/init.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/util.h>
+
+#include "sim/periph.h"
+
+static void sim_pwm_task_handler(struct sim_periph* periph, uint32_t task);
+
+NRF_PWM_Type sim_pwm0 = {
+    .periph = SIM_PERIPH_INIT(NRF_PWM_Type, sim_pwm_task_handler, 28),
+    .active_seq = -1,
+};
+
+static uint64_t sim_pwm_seq_duration_us(NRF_PWM_Type* p_reg, int seq) {
+    static const uint8_t decoder_channels[] = {
+        [NRF_PWM_LOAD_COMMON] = 1,
+        [NRF_PWM_LOAD_GROUPED] = 2,
+        [NRF_PWM_LOAD_INDIVIDUAL] = 4,
+        [NRF_PWM_LOAD_WAVE_FORM] = 4,
+    };
+
+    uint64_t period_ticks = (uint64_t) p_reg->COUNTERTOP * (p_reg->MODE == NRF_PWM_MODE_UP_AND_DOWN ? 2 : 1);
+    uint64_t num_steps = p_reg->SEQ[seq].CNT / decoder_channels[p_reg->DECODER_LOAD];
+    uint64_t num_periods = num_steps * (p_reg->SEQ[seq].REFRESH + 1) + p_reg->SEQ[seq].ENDDELAY;
+    // base clock is 16 MHz divided by 2^PRESCALER
+    return DIV_ROUND_UP(num_periods * period_ticks << p_reg->PRESCALER, 16);
+}
+
+static void sim_pwm_seq_end(struct k_timer* timer) {
+    NRF_PWM_Type* p_reg = CONTAINER_OF(timer, NRF_PWM_Type, seq_timer);
+    int seq = p_reg->active_seq;
+
+    sim_event_generate(&p_reg->periph, seq ? NRF_PWM_EVENT_SEQEND1 : NRF_PWM_EVENT_SEQEND0,
+                       seq ? NRF_PWM_INT_SEQEND1_MASK : NRF_PWM_INT_SEQEND0_MASK);
+    if (p_reg->SHORTS & (seq ? NRF_PWM_SHORT_SEQEND1_STOP_MASK : NRF_PWM_SHORT_SEQEND0_STOP_MASK)) {
+        sim_task_trigger(&p_reg->periph, NRF_PWM_TASK_STOP);
+    }
+    // otherwise the last value of the sequence keeps being played
+}
+
+static void sim_pwm_task_handler(struct sim_periph* periph, uint32_t task) {
+    NRF_PWM_Type* p_reg = (NRF_PWM_Type*) periph;
+
+    switch (task) {
+        case NRF_PWM_TASK_SEQSTART0:
+        case NRF_PWM_TASK_SEQSTART1:
+            if (p_reg->ENABLE) {
+                int seq = task == NRF_PWM_TASK_SEQSTART1;
+                p_reg->active_seq = seq;
+                sim_event_generate(periph, seq ? NRF_PWM_EVENT_SEQSTARTED1 : NRF_PWM_EVENT_SEQSTARTED0,
+                                   seq ? NRF_PWM_INT_SEQSTARTED1_MASK : NRF_PWM_INT_SEQSTARTED0_MASK);
+                k_timer_start(&p_reg->seq_timer, K_USEC(MAX(sim_pwm_seq_duration_us(p_reg, seq), 1)), K_NO_WAIT);
+            }
+            break;
+        case NRF_PWM_TASK_STOP:
+            k_timer_stop(&p_reg->seq_timer);
+            if (p_reg->active_seq >= 0) {
+                p_reg->active_seq = -1;
+                sim_event_generate(periph, NRF_PWM_EVENT_STOPPED, NRF_PWM_INT_STOPPED_MASK);
+            }
+            break;
+    }
+}
+
+static int sim_pwm_init(const struct device* dev) {
+    ARG_UNUSED(dev);
+
+    k_timer_init(&sim_pwm0.seq_timer, sim_pwm_seq_end, NULL);
+    return 0;
+}
+
+SYS_INIT(sim_pwm_init, PRE_KERNEL_1, 0);
@@ -0,0 +1,67 @@
+#include <hal/nrf_qdec.h>
+#include <zephyr/init.h>
+#include <zephyr/kernel.h>
+
+#include "sim/analog.h"
+#include "sim/periph.h"
+
+static void sim_qdec_task_handler(struct sim_periph* periph, uint32_t task);
+
+NRF_QDEC_Type sim_qdec = {
+    .periph = SIM_PERIPH_INIT(NRF_QDEC_Type, sim_qdec_task_handler, 18),
+};
+
+static uint32_t sim_qdec_sample_period_us(NRF_QDEC_Type* p_reg) {
+    return 128u << p_reg->SAMPLEPER;
+}
+
+static void sim_qdec_report(struct k_timer* timer) {
+    NRF_QDEC_Type* p_reg = CONTAINER_OF(timer, NRF_QDEC_Type, report_timer);
+
+    sim_event_generate(&p_reg->periph, NRF_QDEC_EVENT_REPORTRDY, NRF_QDEC_INT_REPORTRDY_MASK);
+    if (p_reg->SHORTS & NRF_QDEC_SHORT_REPORTRDY_READCLRACC_MASK) {
+        sim_task_trigger(&p_reg->periph, NRF_QDEC_TASK_READCLRACC);
+    }
+}
+
+void sim_qdec_rotate(int32_t steps) {
+    NRF_QDEC_Type* p_reg = NRF_QDEC;
+
+    if (!p_reg->ENABLE || !p_reg->running || steps == 0) {
+        return;
+    }
+
+    // report is generated after the number of samples with movement reaches REPORTPER,
+    // which is at most one sample period away from now for REPORTPER_1
+    p_reg->ACC += steps;
+    if (k_timer_remaining_ticks(&p_reg->report_timer) == 0) {
+        k_timer_start(&p_reg->report_timer, K_USEC(sim_qdec_sample_period_us(p_reg)), K_NO_WAIT);
+    }
+}
+
+static void sim_qdec_task_handler(struct sim_periph* periph, uint32_t task) {
+    NRF_QDEC_Type* p_reg = (NRF_QDEC_Type*) periph;
+
+    switch (task) {
+        case NRF_QDEC_TASK_START:
+            p_reg->running = p_reg->ENABLE;
+            break;
+        case NRF_QDEC_TASK_STOP:
+            p_reg->running = false;
+            k_timer_stop(&p_reg->report_timer);
+            break;
+        case NRF_QDEC_TASK_READCLRACC:
+            p_reg->ACCREAD = p_reg->ACC;
+            p_reg->ACC = 0;
+            break;
+    }
+}
+
+static int sim_qdec_init(const struct device* dev) {
+    ARG_UNUSED(dev);
+
+    k_timer_init(&sim_qdec.report_timer, sim_qdec_report, NULL);
+    return 0;
+}
+
+SYS_INIT(sim_qdec_init, PRE_KERNEL_1, 0);
@@ -0,0 +1,104 @@
+#include <hal/nrf_saadc.h>
+#include <zephyr/init.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/util.h>
+
+#include "sim/analog.h"
+#include "sim/periph.h"
+
+#define INTERNAL_REFERENCE_MV 600
+
+static void sim_saadc_task_handler(struct sim_periph* periph, uint32_t task);
+
+NRF_SAADC_Type sim_saadc = {
+    .periph = SIM_PERIPH_INIT(NRF_SAADC_Type, sim_saadc_task_handler, 7),
+};
+
+static int32_t input_mv[NRF_SAADC_INPUT_VDD + 1] = {
+    [NRF_SAADC_INPUT_VDD] = 3000,
+};
+
+// gain as a fraction, indexed by nrf_saadc_gain_t
+static const struct {
+    uint8_t num;
+    uint8_t den;
+} gains[] = {
+    {1, 6}, {1, 5}, {1, 4}, {1, 3}, {1, 2}, {1, 1}, {2, 1}, {4, 1},
+};
+
+void sim_saadc_input_set_mv(nrf_saadc_input_t input, int32_t mv) {
+    if (input > NRF_SAADC_INPUT_DISABLED && input < ARRAY_SIZE(input_mv)) {
+        input_mv[input] = mv;
+    }
+}
+
+static nrf_saadc_value_t sim_saadc_convert(NRF_SAADC_Type* p_reg, int channel) {
+    nrf_saadc_channel_config_t* config = &p_reg->CH[channel].CONFIG;
+    int32_t reference_mv = config->reference == NRF_SAADC_REFERENCE_INTERNAL
+        ? INTERNAL_REFERENCE_MV
+        : input_mv[NRF_SAADC_INPUT_VDD] / 4;
+    int32_t resolution_bits = 8 + 2 * p_reg->RESOLUTION;
+    int64_t value = (int64_t) input_mv[p_reg->CH[channel].PSELP] * gains[config->gain].num << resolution_bits;
+    value /= (int64_t) reference_mv * gains[config->gain].den;
+    return CLAMP(value, 0, BIT(resolution_bits) - 1);
+}
+
+static void sim_saadc_sample_done(struct k_timer* timer) {
+    NRF_SAADC_Type* p_reg = CONTAINER_OF(timer, NRF_SAADC_Type, sample_timer);
+
+    for (int ch = 0; ch < NRF_SAADC_CHANNEL_COUNT && p_reg->RESULT_AMOUNT < p_reg->RESULT_MAXCNT; ch++) {
+        if (p_reg->CH[ch].PSELP != NRF_SAADC_INPUT_DISABLED) {
+            p_reg->RESULT_PTR[p_reg->RESULT_AMOUNT++] = sim_saadc_convert(p_reg, ch);
+        }
+    }
+    sim_event_generate(&p_reg->periph, NRF_SAADC_EVENT_DONE, NRF_SAADC_INT_DONE);
+    sim_event_generate(&p_reg->periph, NRF_SAADC_EVENT_RESULTDONE, NRF_SAADC_INT_RESULTDONE);
+
+    if (p_reg->RESULT_AMOUNT >= p_reg->RESULT_MAXCNT) {
+        p_reg->started = false;
+        sim_event_generate(&p_reg->periph, NRF_SAADC_EVENT_END, NRF_SAADC_INT_END);
+    }
+}
+
+static uint32_t sim_saadc_acq_time_us(nrf_saadc_acqtime_t acq_time) {
+    static const uint8_t acq_times_us[] = {3, 5, 10, 15, 20, 40};
+    return acq_times_us[acq_time];
+}
+
+static void sim_saadc_task_handler(struct sim_periph* periph, uint32_t task) {
+    NRF_SAADC_Type* p_reg = (NRF_SAADC_Type*) periph;
+
+    switch (task) {
+        case NRF_SAADC_TASK_START:
+            if (p_reg->ENABLE) {
+                p_reg->started = true;
+                p_reg->RESULT_AMOUNT = 0;
+                sim_event_generate(periph, NRF_SAADC_EVENT_STARTED, NRF_SAADC_INT_STARTED);
+            }
+            break;
+        case NRF_SAADC_TASK_SAMPLE:
+            if (p_reg->started) {
+                // acquisition time of the first channel plus 2 us conversion time
+                uint32_t duration_us = sim_saadc_acq_time_us(p_reg->CH[0].CONFIG.acq_time) + 2;
+                k_timer_start(&p_reg->sample_timer, K_USEC(duration_us), K_NO_WAIT);
+            }
+            break;
+        case NRF_SAADC_TASK_STOP:
+            k_timer_stop(&p_reg->sample_timer);
+            if (p_reg->started) {
+                p_reg->started = false;
+                sim_event_generate(periph, NRF_SAADC_EVENT_END, NRF_SAADC_INT_END);
+            }
+            sim_event_generate(periph, NRF_SAADC_EVENT_STOPPED, NRF_SAADC_INT_STOPPED);
+            break;
+    }
+}
+
+static int sim_saadc_init(const struct device* dev) {
+    ARG_UNUSED(dev);
+
+    k_timer_init(&sim_saadc.sample_timer, sim_saadc_sample_done, NULL);
+    return 0;
+}
+
+SYS_INIT(sim_saadc_init, PRE_KERNEL_1, 0);
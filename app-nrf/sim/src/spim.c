@@ -0,0 +1,82 @@
+#include <string.h>
+
+#include <hal/nrf_spim.h>
+#include <zephyr/init.h>
+#include <zephyr/kernel.h>
+
+#include "sim/gpio.h"
+#include "sim/periph.h"
+#include "sim/spim.h"
+
+static void sim_spim_task_handler(struct sim_periph* periph, uint32_t task);
+
+NRF_SPIM_Type sim_spim0 = {
+    .periph = SIM_PERIPH_INIT(NRF_SPIM_Type, sim_spim_task_handler, 3),
+};
+
+static sim_spim_transfer_cb transfer_cb = NULL;
+static void* transfer_cb_user_data = NULL;
+
+void sim_spim_transfer_cb_set(sim_spim_transfer_cb callback, void* user_data) {
+    transfer_cb = callback;
+    transfer_cb_user_data = user_data;
+}
+
+void sim_spim_update_pins(NRF_SPIM_Type* p_reg) {
+    if (p_reg->ENABLE) {
+        sim_gpio_periph_drive(p_reg->PSEL_SCK, p_reg->MODE == NRF_SPIM_MODE_2 || p_reg->MODE == NRF_SPIM_MODE_3);
+        sim_gpio_periph_drive(p_reg->PSEL_MOSI, false);
+    } else {
+        sim_gpio_periph_release(p_reg->PSEL_SCK);
+        sim_gpio_periph_release(p_reg->PSEL_MOSI);
+    }
+}
+
+static void sim_spim_end(struct k_timer* timer) {
+    NRF_SPIM_Type* p_reg = CONTAINER_OF(timer, NRF_SPIM_Type, end_timer);
+
+    memset(p_reg->rx_ptr, p_reg->ORC, p_reg->rx_len);
+    if (transfer_cb) {
+        transfer_cb(p_reg->tx_ptr, p_reg->tx_len, p_reg->rx_ptr, p_reg->rx_len, transfer_cb_user_data);
+    }
+    p_reg->TXD_AMOUNT = p_reg->tx_len;
+    p_reg->RXD_AMOUNT = p_reg->rx_len;
+    p_reg->busy = false;
+
+    sim_event_generate(&p_reg->periph, NRF_SPIM_EVENT_ENDTX, NRF_SPIM_INT_ENDTX_MASK);
+    sim_event_generate(&p_reg->periph, NRF_SPIM_EVENT_ENDRX, NRF_SPIM_INT_ENDRX_MASK);
+    sim_event_generate(&p_reg->periph, NRF_SPIM_EVENT_END, NRF_SPIM_INT_END_MASK);
+}
+
+static void sim_spim_task_handler(struct sim_periph* periph, uint32_t task) {
+    NRF_SPIM_Type* p_reg = (NRF_SPIM_Type*) periph;
+
+    if (task == NRF_SPIM_TASK_START && p_reg->ENABLE && !p_reg->busy) {
+        p_reg->busy = true;
+        p_reg->tx_ptr = p_reg->TXD_PTR;
+        p_reg->tx_len = p_reg->TXD_MAXCNT;
+        p_reg->rx_ptr = p_reg->RXD_PTR;
+        p_reg->rx_len = p_reg->RXD_MAXCNT;
+        sim_event_generate(periph, NRF_SPIM_EVENT_STARTED, NRF_SPIM_INT_STARTED_MASK);
+
+        uint64_t num_bits = 8 * (uint64_t) MAX(p_reg->tx_len, p_reg->rx_len);
+        uint64_t duration_us = DIV_ROUND_UP(num_bits * 1000000, p_reg->FREQUENCY);
+        k_timer_start(&p_reg->end_timer, K_USEC(MAX(duration_us, 1)), K_NO_WAIT);
+    } else if (task == NRF_SPIM_TASK_STOP) {
+        if (p_reg->busy) {
+            // the transfer is aborted, no data is exchanged
+            k_timer_stop(&p_reg->end_timer);
+            p_reg->busy = false;
+        }
+        sim_event_generate(periph, NRF_SPIM_EVENT_STOPPED, NRF_SPIM_INT_STOPPED_MASK);
+    }
+}
+
+static int sim_spim_init(const struct device* dev) {
+    ARG_UNUSED(dev);
+
+    k_timer_init(&sim_spim0.end_timer, sim_spim_end, NULL);
+    return 0;
+}
+
+SYS_INIT(sim_spim_init, PRE_KERNEL_1, 0);
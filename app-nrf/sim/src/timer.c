@@ -0,0 +1,122 @@
+#include <hal/nrf_timer.h>
+#include <zephyr/init.h>
+#include <zephyr/kernel.h>
+
+#include "sim/periph.h"
+
+static void sim_timer_task_handler(struct sim_periph* periph, uint32_t task);
+
+#define SIM_TIMER_INIT(irq) {.periph = SIM_PERIPH_INIT(NRF_TIMER_Type, sim_timer_task_handler, irq)}
+
+NRF_TIMER_Type sim_timers[5] = {
+    SIM_TIMER_INIT(8),
+    SIM_TIMER_INIT(9),
+    SIM_TIMER_INIT(10),
+    SIM_TIMER_INIT(26),
+    SIM_TIMER_INIT(27),
+};
+
+static uint32_t sim_timer_mask(const NRF_TIMER_Type* p_reg) {
+    static const uint8_t widths[] = {
+        [NRF_TIMER_BIT_WIDTH_16] = 16,
+        [NRF_TIMER_BIT_WIDTH_8] = 8,
+        [NRF_TIMER_BIT_WIDTH_24] = 24,
+        [NRF_TIMER_BIT_WIDTH_32] = 32,
+    };
+    uint8_t width = widths[p_reg->BITMODE & 3];
+    return width == 32 ? UINT32_MAX : (1u << width) - 1;
+}
+
+static uint32_t sim_timer_freq_hz(const NRF_TIMER_Type* p_reg) {
+    return 16000000u >> p_reg->PRESCALER;
+}
+
+static uint32_t sim_timer_count(const NRF_TIMER_Type* p_reg) {
+    uint64_t count = p_reg->base_count;
+    if (p_reg->running) {
+        count += (sim_clock_now_us() - p_reg->base_time_us) * sim_timer_freq_hz(p_reg) / 1000000;
+    }
+    return count & sim_timer_mask(p_reg);
+}
+
+static void sim_timer_set_count(NRF_TIMER_Type* p_reg, uint32_t count) {
+    p_reg->base_count = count;
+    p_reg->base_time_us = sim_clock_now_us();
+}
+
+void sim_timer_reschedule(NRF_TIMER_Type* p_reg) {
+    for (int ch = 0; ch < NRF_TIMER_CC_COUNT; ch++) {
+        if (!p_reg->running || !(p_reg->cc_used & (1u << ch))) {
+            k_timer_stop(&p_reg->compare_timers[ch]);
+            continue;
+        }
+
+        uint64_t ticks = (p_reg->CC[ch] - sim_timer_count(p_reg)) & sim_timer_mask(p_reg);
+        if (!ticks) {
+            // the counter is at CC right now, next match happens after overflow
+            ticks = (uint64_t) sim_timer_mask(p_reg) + 1;
+        }
+        uint64_t delay_us = DIV_ROUND_UP(ticks * 1000000, sim_timer_freq_hz(p_reg));
+        k_timer_start(&p_reg->compare_timers[ch], K_USEC(MAX(delay_us, 1)), K_NO_WAIT);
+    }
+}
+
+static void sim_timer_compare_expired(struct k_timer* timer) {
+    NRF_TIMER_Type* p_reg = k_timer_user_data_get(timer);
+    int ch = timer - p_reg->compare_timers;
+
+    sim_timer_set_count(p_reg, p_reg->CC[ch]);
+    sim_event_generate(&p_reg->periph, NRF_TIMER_EVENT_COMPARE0 + ch * sizeof(sim_reg_t), NRF_TIMER_INT_COMPARE0_MASK << ch);
+
+    if (p_reg->SHORTS & (NRF_TIMER_SHORT_COMPARE0_CLEAR_MASK << ch)) {
+        sim_timer_set_count(p_reg, 0);
+    }
+    if (p_reg->SHORTS & (NRF_TIMER_SHORT_COMPARE0_STOP_MASK << ch)) {
+        p_reg->running = false;
+    }
+    sim_timer_reschedule(p_reg);
+}
+
+static void sim_timer_task_handler(struct sim_periph* periph, uint32_t task) {
+    NRF_TIMER_Type* p_reg = (NRF_TIMER_Type*) periph;
+
+    switch (task) {
+        case NRF_TIMER_TASK_START:
+            if (!p_reg->running) {
+                sim_timer_set_count(p_reg, p_reg->base_count);
+                p_reg->running = true;
+            }
+            break;
+        case NRF_TIMER_TASK_STOP:
+            sim_timer_set_count(p_reg, sim_timer_count(p_reg));
+            p_reg->running = false;
+            break;
+        case NRF_TIMER_TASK_CLEAR:
+            sim_timer_set_count(p_reg, 0);
+            break;
+        case NRF_TIMER_TASK_SHUTDOWN:
+            sim_timer_set_count(p_reg, 0);
+            p_reg->running = false;
+            break;
+        default:
+            if (task >= NRF_TIMER_TASK_CAPTURE0 && task <= NRF_TIMER_TASK_CAPTURE5) {
+                p_reg->CC[(task - NRF_TIMER_TASK_CAPTURE0) / sizeof(sim_reg_t)] = sim_timer_count(p_reg);
+            }
+            break;
+    }
+    sim_timer_reschedule(p_reg);
+}
+
+static int sim_timer_init(const struct device* dev) {
+    ARG_UNUSED(dev);
+
+    for (int i = 0; i < ARRAY_SIZE(sim_timers); i++) {
+        for (int ch = 0; ch < NRF_TIMER_CC_COUNT; ch++) {
+            k_timer_init(&sim_timers[i].compare_timers[ch], sim_timer_compare_expired, NULL);
+            k_timer_user_data_set(&sim_timers[i].compare_timers[ch], &sim_timers[i]);
+        }
+    }
+    return 0;
+}
+
+SYS_INIT(sim_timer_init, PRE_KERNEL_1, 0);
@@ -9,6 +9,7 @@
 #include <zephyr/drivers/sensor.h>
 #include <zephyr/kernel.h>
 #include <zephyr/logging/log.h>
+#include <zephyr/pm/device.h>
 
 #include "platform/spi.h"
 
@@ -25,40 +26,31 @@ LOG_MODULE_REGISTER(adns7530);
 #define CS_PIN      (DT_INST_SPI_DEV_CS_GPIOS_PIN(0))
 #define CS_INACTIVE (DT_INST_SPI_DEV_CS_GPIOS_FLAGS(0) & 1)  // bit 1 determines inactive state value (see GPIO_ACTIVE_LOW)
 
+static struct spi_device_stats adns7530_spi_stats = {.name = "adns7530"};
+
 const static struct spi_configuration adns7530_spi_config = {
     .op_mode = ADNS7530_SPI_MODE,
     .bit_order = ADNS7530_SPI_BITORD,
     .freq = SPI_CONFIG_FREQUENCY(DT_INST_PROP(0, spi_max_frequency)),
+    .segment_gap_us = 4,  // t_{SRAD}
+    .cs_hold_us = 20,     // t_{SCLK-NCS} "for valid MOSI data transfer"
     .is_const = true,
+    .stats = &adns7530_spi_stats,
 };
 
-static struct {
-    int err;
-    int rx_len;
-    void* rx_buf;
-} adns7530_spi_cb_ctx;
-
-static void adns7530_spi_done_callback(void* arg) {
-    if (adns7530_spi_cb_ctx.rx_buf) {
-        // the SPI task/event latency is about 6 us in total, and rescheduling another transaction takes ~5us
-        // the total latency is more than required delay t_{SRAD} = 4us, so no additional delay needed
-        struct spi_transfer_spec rx_spec = {NULL, 0, adns7530_spi_cb_ctx.rx_buf, adns7530_spi_cb_ctx.rx_len};
-        adns7530_spi_cb_ctx.rx_buf = NULL;
-        adns7530_spi_cb_ctx.err = spi_transceive(&rx_spec, adns7530_spi_done_callback, arg);
-        if (!adns7530_spi_cb_ctx.err) {
-            return;  // wait for callback from second transaction
-        }
-    }
-    k_sem_give((struct k_sem*)arg);
-}
-
-static int adns7530_spi_transceive(void* tx_buf, uint32_t tx_len, void* rx_buf, uint32_t rx_len) {
-    struct spi_transfer_spec tx_spec = {tx_buf, tx_len, NULL, 0};
-    adns7530_spi_cb_ctx.err = -EIO;  // will remain unchanged if the callback is never called
-    adns7530_spi_cb_ctx.rx_len = rx_len;
-    adns7530_spi_cb_ctx.rx_buf = rx_buf;
-    int err = spi_transceive_managed(&adns7530_spi_config, CS_PIN, &tx_spec, adns7530_spi_done_callback, K_USEC(1000));
-    return err ? err : adns7530_spi_cb_ctx.err;
+static int adns7530_spi_transceive(const void* tx_buf, uint32_t tx_len, void* rx_buf, uint32_t rx_len) {
+    const struct spi_transfer_spec segments[] = {
+        {tx_buf, tx_len, NULL, 0},
+        {NULL, 0, rx_buf, rx_len},
+    };
+    struct spi_transaction transaction = {
+        .config = &adns7530_spi_config,
+        .cs_pin = CS_PIN,
+        .priority = SPI_PRIORITY_HIGH,
+        .segments = segments,
+        .num_segments = rx_len ? 2 : 1,
+    };
+    return spi_transact(&transaction, K_USEC(1000));
 }
 
 static inline int adns7530_reg_read(uint8_t reg, void* dst, uint32_t count) {
@@ -72,19 +64,54 @@ static inline int adns7530_reg_read(uint8_t reg, void* dst, uint32_t count) {
 }
 
 static inline int adns7530_reg_write(uint8_t reg, uint8_t value) {
-    static uint8_t tx_buf[2];
-    tx_buf[0] = 0x80 | (reg & 0x7f);
-    tx_buf[1] = value;
-
+    uint8_t tx_buf[2] = {0x80 | (reg & 0x7f), value};
     return adns7530_spi_transceive(tx_buf, 2, NULL, 0);
 }
 
+/**
+ * @brief Init sequence as specified in datasheet, meaning of all these registers is undocumented.
+ */
+static const struct adns7530_reg_value adns7530_init_seq[] = {
+    {0x3C, 0x27},
+    {0x22, 0x0A},
+    {0x21, 0x01},
+    {0x3C, 0x32},
+    {0x23, 0x20},
+    {0x3C, 0x05},
+    {0x37, 0xB9},
+};
+
+/**
+ * @brief Laser settings and sleep mode timings, resolution is written separately (see adns7530_write_cfg).
+ */
+static const struct adns7530_reg_value adns7530_settings_seq[] = {
+    {ADNS7530_REG_LASER_CTRL0, 0x00},
+    {ADNS7530_REG_LASER_CTRL1, 0xC0},
+    {ADNS7530_REG_LSRPWR_CFG0, 0xE0},
+    {ADNS7530_REG_LSRPWR_CFG1, 0x1F},
+    {ADNS7530_REG_REST2_DOWNSHIFT, 0x0A},
+    {ADNS7530_REG_REST3_RATE, 0x63},
+};
+
+static void adns7530_reg_write_seq(const struct adns7530_reg_value* seq, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        adns7530_reg_write(seq[i].reg, seq[i].value);
+    }
+}
+
+static int adns7530_write_cfg(const struct adns7530_data* data) {
+    return adns7530_reg_write(ADNS7530_REG_CFG, data->resolution | ADNS7530_REST_ENABLE | ADNS7530_RUN_RATE_4MS);
+}
+
 static int adns7530_init(const struct device *dev) {
+    struct adns7530_data* data = dev->data;
+    k_mutex_init(&data->lock);
+
     nrf_gpio_pin_write(CS_PIN, CS_INACTIVE);
     nrf_gpio_cfg_output(CS_PIN);
 
     adns7530_reg_write(ADNS7530_REG_POWER_UP_RESET, ADNS7530_RESET_VALUE);
-    k_msleep(10);
+    k_msleep(ADNS7530_RESET_TIME_MS);
     adns7530_reg_write(ADNS7530_REG_OBSERVATION, 0x00);
     k_msleep(10);
     uint8_t observation_val[ONE_BYTE_RX_BUF_SIZE] = {};
@@ -95,14 +122,7 @@ static int adns7530_init(const struct device *dev) {
     }
     adns7530_reg_read(ADNS7530_REG_MOTION_BURST, NULL, 4);
 
-    // Init sequence as specified in datasheet, meaning of all these registers is undocumented
-    adns7530_reg_write(0x3C, 0x27);
-    adns7530_reg_write(0x22, 0x0A);
-    adns7530_reg_write(0x21, 0x01);
-    adns7530_reg_write(0x3C, 0x32);
-    adns7530_reg_write(0x23, 0x20);
-    adns7530_reg_write(0x3C, 0x05);
-    adns7530_reg_write(0x37, 0xB9);
+    adns7530_reg_write_seq(adns7530_init_seq, ARRAY_SIZE(adns7530_init_seq));
 
     // Verify product ID
     uint8_t product_id[ONE_BYTE_RX_BUF_SIZE] = {};
@@ -112,20 +132,93 @@ static int adns7530_init(const struct device *dev) {
         return -ENODATA;
     }
 
-    // Settings
-    adns7530_reg_write(ADNS7530_REG_LASER_CTRL0, 0x00);
-    adns7530_reg_write(ADNS7530_REG_LASER_CTRL1, 0xC0);
-    adns7530_reg_write(ADNS7530_REG_LSRPWR_CFG0, 0xE0);
-    adns7530_reg_write(ADNS7530_REG_LSRPWR_CFG1, 0x1F);
+    adns7530_reg_write_seq(adns7530_settings_seq, ARRAY_SIZE(adns7530_settings_seq));
+    adns7530_write_cfg(data);
+
+    // Remember default downshift timings to restore them after the sensor lands
+    uint8_t downshift[ONE_BYTE_RX_BUF_SIZE] = {};
+    adns7530_reg_read(ADNS7530_REG_RUN_DOWNSHIFT, downshift, ONE_BYTE_RX_BUF_SIZE);
+    data->run_downshift = *downshift;
+    adns7530_reg_read(ADNS7530_REG_REST1_DOWNSHIFT, downshift, ONE_BYTE_RX_BUF_SIZE);
+    data->rest1_downshift = *downshift;
+
+    return 0;
+}
+
+#ifdef CONFIG_PM_DEVICE
+/**
+ * @brief Bring the sensor back from shutdown.
+ *
+ * Shutdown resets sensor registers, so they have to be written again. Unlike on init,
+ * the sensor is known to be working, so self-checks are skipped and the register values
+ * (including downshift timings read on init) are taken from RAM rather than read back.
+ */
+static int adns7530_resume(const struct device *dev) {
+    struct adns7530_data* data = dev->data;
+    uint32_t start = k_cycle_get_32();
+
+    k_mutex_lock(&data->lock, K_FOREVER);
+    adns7530_reg_write(ADNS7530_REG_POWER_UP_RESET, ADNS7530_RESET_VALUE);
+    k_msleep(ADNS7530_RESET_TIME_MS);
+    adns7530_reg_read(ADNS7530_REG_MOTION_BURST, NULL, 4);
+    adns7530_reg_write_seq(adns7530_init_seq, ARRAY_SIZE(adns7530_init_seq));
+    adns7530_reg_write_seq(adns7530_settings_seq, ARRAY_SIZE(adns7530_settings_seq));
+    adns7530_write_cfg(data);
+
+    // downshift registers are at their defaults after reset, which match the landed state
+    data->lifted = false;
+    data->land_time_ms = k_uptime_get();
+    data->suspended = false;
+    k_mutex_unlock(&data->lock);
 
-    // Resolution and sleep mode timings
-    adns7530_reg_write(ADNS7530_REG_CFG, ADNS7530_RESOLUTION_1200 | ADNS7530_REST_ENABLE | ADNS7530_RUN_RATE_4MS);
-    adns7530_reg_write(ADNS7530_REG_REST2_DOWNSHIFT, 0x0A);
-    adns7530_reg_write(ADNS7530_REG_REST3_RATE, 0x63);
+    data->resume_time_us = k_cyc_to_us_floor32(k_cycle_get_32() - start);
+    LOG_DBG("resumed in %u us", data->resume_time_us);
 
     return 0;
 }
 
+static int adns7530_pm_action(const struct device *dev, enum pm_device_action action) {
+    struct adns7530_data* data = dev->data;
+    int rv;
+
+    switch (action) {
+        case PM_DEVICE_ACTION_SUSPEND:
+            k_mutex_lock(&data->lock, K_FOREVER);
+            data->suspended = true;
+            rv = adns7530_reg_write(ADNS7530_REG_SHUTDOWN, ADNS7530_SHUTDOWN_VALUE);
+            k_mutex_unlock(&data->lock);
+            return rv;
+        case PM_DEVICE_ACTION_RESUME:
+            return adns7530_resume(dev);
+        default:
+            return -ENOTSUP;
+    }
+}
+#endif // CONFIG_PM_DEVICE
+
+/**
+ * @brief Update lift detection state based on the surface quality.
+ *
+ * Separate lift and land thresholds provide hysteresis, so that the state does not flip
+ * on every reading when the surface quality is close to a threshold. While lifted, the
+ * sensor is configured to downshift to rest modes as soon as possible to save power.
+ */
+static void adns7530_update_lift_state(struct adns7530_data* data, uint8_t surf_qual) {
+    if (data->lifted && surf_qual >= CONFIG_ADNS7530_SURF_QUAL_LAND_THRESHOLD) {
+        data->lifted = false;
+        data->land_time_ms = k_uptime_get();
+        adns7530_reg_write(ADNS7530_REG_RUN_DOWNSHIFT, data->run_downshift);
+        adns7530_reg_write(ADNS7530_REG_REST1_DOWNSHIFT, data->rest1_downshift);
+        LOG_DBG("landed, surface quality %u", surf_qual);
+    }
+    else if (!data->lifted && surf_qual < CONFIG_ADNS7530_SURF_QUAL_LIFT_THRESHOLD) {
+        data->lifted = true;
+        adns7530_reg_write(ADNS7530_REG_RUN_DOWNSHIFT, ADNS7530_LIFTED_DOWNSHIFT);
+        adns7530_reg_write(ADNS7530_REG_REST1_DOWNSHIFT, ADNS7530_LIFTED_DOWNSHIFT);
+        LOG_DBG("lifted, surface quality %u", surf_qual);
+    }
+}
+
 static int adns7530_sample_fetch(const struct device *dev, enum sensor_channel chan) {
     struct adns7530_data* data = dev->data;
     struct {
@@ -136,15 +229,28 @@ static int adns7530_sample_fetch(const struct device *dev, enum sensor_channel c
         uint8_t surf_qual;
     } motion_burst = {};
 
+    k_mutex_lock(&data->lock, K_FOREVER);
+
+    if (data->suspended) {
+        data->delta_x = data->delta_y = 0;
+        k_mutex_unlock(&data->lock);
+        return -EAGAIN;
+    }
+
     adns7530_reg_read(ADNS7530_REG_MOTION_BURST, &motion_burst, sizeof(motion_burst));
 
     if (motion_burst.motion & ADNS7530_LASER_FAULT_MASK || !(motion_burst.motion & ADNS7530_LASER_CFG_VALID_MASK)) {
+        k_mutex_unlock(&data->lock);
         LOG_ERR("laser fault or laser invalid cfg: %x", motion_burst.motion);
         return -ENODATA;
     }
 
+    adns7530_update_lift_state(data, motion_burst.surf_qual);
+    k_mutex_unlock(&data->lock);
+
     // ADNS7530_MOTION_FLAG probably means "data ready" rather than "motion detected"
-    if (!(motion_burst.motion & ADNS7530_MOTION_FLAG) || motion_burst.surf_qual < CONFIG_ADNS7530_SURF_QUAL_THRESHOLD) {
+    if (!(motion_burst.motion & ADNS7530_MOTION_FLAG) || data->lifted ||
+        k_uptime_get() - data->land_time_ms < CONFIG_ADNS7530_LAND_SETTLE_TIME) {
         data->delta_x = data->delta_y = 0;
         return 0;
     }
@@ -169,6 +275,9 @@ static int adns7530_channel_get(const struct device *dev, enum sensor_channel ch
         case SENSOR_CHAN_POS_DY:
             val->val1 = data->delta_y;
             break;
+        case ADNS7530_CHAN_LIFTED:
+            val->val1 = data->lifted;
+            break;
         default:
             return -ENOTSUP;
     }
@@ -176,17 +285,51 @@ static int adns7530_channel_get(const struct device *dev, enum sensor_channel ch
     return 0;
 }
 
-static struct adns7530_data adns7530_data = { };
+static int adns7530_attr_set(const struct device *dev,
+                             enum sensor_channel chan,
+                             enum sensor_attribute attr,
+                             const struct sensor_value *val) {
+    struct adns7530_data* data = dev->data;
+    uint8_t resolution;
+
+    if (attr != ADNS7530_ATTR_CPI) {
+        return -ENOTSUP;
+    }
+    switch (val->val1) {
+        case 400:  resolution = ADNS7530_RESOLUTION_400;  break;
+        case 800:  resolution = ADNS7530_RESOLUTION_800;  break;
+        case 1200: resolution = ADNS7530_RESOLUTION_1200; break;
+        case 1600: resolution = ADNS7530_RESOLUTION_1600; break;
+        default: return -EINVAL;
+    }
+
+    k_mutex_lock(&data->lock, K_FOREVER);
+    data->resolution = resolution;
+    // while suspended, the resolution is written on resume
+    int rv = data->suspended ? 0 : adns7530_write_cfg(data);
+    k_mutex_unlock(&data->lock);
+    return rv;
+}
+
+static struct adns7530_data adns7530_data = {
+    .land_time_ms = -CONFIG_ADNS7530_LAND_SETTLE_TIME,
+    .resolution = ADNS7530_RESOLUTION_1200,
+};
 
 static const struct sensor_driver_api adns7530_api_funcs = {
+    .attr_set = adns7530_attr_set,
     .sample_fetch = adns7530_sample_fetch,
     .channel_get = adns7530_channel_get,
 };
 
+#ifdef CONFIG_PM_DEVICE
+PM_DEVICE_DT_INST_DEFINE(0, adns7530_pm_action);
+#endif
+
 DEVICE_DT_INST_DEFINE(
     0,
     adns7530_init,
-    NULL,
+    PM_DEVICE_DT_INST_GET(0),
     &adns7530_data,
     NULL,
     POST_KERNEL,
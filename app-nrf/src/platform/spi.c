@@ -2,13 +2,21 @@
 
 #include <stdbool.h>
 #include <stdint.h>
+#include <string.h>
 
 #include <hal/nrf_gpio.h>
+#include <hal/nrf_gpiote.h>
+#include <hal/nrf_ppi.h>
 #include <hal/nrf_spim.h>
+#include <hal/nrf_timer.h>
+#include <nrfx.h>
 #include <zephyr/devicetree.h>
 #include <zephyr/init.h>
 #include <zephyr/kernel.h>
 #include <zephyr/logging/log.h>
+#include <zephyr/sys/slist.h>
+
+#include "platform/hw_resources.h"
 
 LOG_MODULE_REGISTER(spi);
 
@@ -28,6 +36,32 @@ static bool is_in_spi_isr = false;
 
 static const struct spi_configuration* prev_config = NULL;
 
+/* Transaction queues, one per priority. Transactions are appended by spi_submit and executed one after another,
+ * the next one is started directly from ISR once the previous one completes. Transactions are not preempted,
+ * a pending transaction of higher priority is started as soon as the active one completes.
+ * The queue is paused while a thread owns the bus via spi_lock.
+ *
+ * Timing of queued transactions is enforced by hardware: CS is driven by a GPIOTE task, SPIM END
+ * starts SPI_TIMER through PPI, and the timer compare either releases CS (after the last segment)
+ * or fires an interrupt which starts the next segment (after the gap between segments).
+ */
+static sys_slist_t spi_queues[SPI_NUM_PRIORITIES] = {
+    [SPI_PRIORITY_NORMAL] = SYS_SLIST_STATIC_INIT(&spi_queues[SPI_PRIORITY_NORMAL]),
+    [SPI_PRIORITY_HIGH] = SYS_SLIST_STATIC_INIT(&spi_queues[SPI_PRIORITY_HIGH]),
+};
+static struct spi_transaction* active_transaction = NULL;
+static bool is_queue_paused = false;
+K_SEM_DEFINE(spi_queue_idle_sem, 0, 1);
+
+static struct spi_queue_stats queue_stats = {};
+// device statistics registered upon first use, nodes are never removed
+static sys_slist_t device_stats_list = SYS_SLIST_STATIC_INIT(&device_stats_list);
+
+static inline void spi_stats_hist_add(uint32_t hist[SPI_STATS_HIST_NUM_BUCKETS], uint32_t value_us) {
+    uint32_t bucket = value_us ? 31 - __builtin_clz(value_us) : 0;
+    hist[MIN(bucket, SPI_STATS_HIST_NUM_BUCKETS - 1)]++;
+}
+
 // truth table:
 //   ISR  |  SPI ISR  |   owner   |  error
 //    y   |     y     |     -     |    n
@@ -37,81 +71,312 @@ static const struct spi_configuration* prev_config = NULL;
 
 #define CHECK_LOCK_OWNED() if (k_is_in_isr() ? !is_in_spi_isr : k_current_get() != spi_mutex.owner) return -EPERM
 
-#if CONFIG_SPI_DISABLE_CLK_DELAY > 0
 static inline bool is_sck_inactive_high(nrf_spim_mode_t mode) {
     return mode == NRF_SPIM_MODE_2 || mode == NRF_SPIM_MODE_3;
 }
 
+static inline bool is_queue_idle() {
+    for (int prio = 0; prio < SPI_NUM_PRIORITIES; prio++) {
+        if (!sys_slist_is_empty(&spi_queues[prio])) {
+            return false;
+        }
+    }
+    return !active_transaction;
+}
+
+#if CONFIG_SPI_DISABLE_CLK_DELAY > 0
 static void disable_sck(struct k_work *work) {
-    nrf_spim_configure(NRF_SPIM0, NRF_SPIM_MODE_0, NRF_SPIM_BIT_ORDER_MSB_FIRST);
-    prev_config = NULL;
+    unsigned key = irq_lock();
+    // the queue might have been resumed in the meantime
+    if (is_queue_idle() && !spi_mutex.owner) {
+        nrf_spim_configure(NRF_SPIM0, NRF_SPIM_MODE_0, NRF_SPIM_BIT_ORDER_MSB_FIRST);
+        if (prev_config && prev_config->stats) {
+            prev_config->stats->counters.clk_disables++;
+        }
+        prev_config = NULL;
+    }
+    irq_unlock(key);
 }
 
 K_WORK_DELAYABLE_DEFINE(disable_sck_work, disable_sck);
+
+static inline void schedule_disable_sck() {
+    if (prev_config && is_sck_inactive_high(prev_config->op_mode)) {
+        // if previous configuration has SCK inactive high, schedule disabling it after a period of inactivity
+        // this is needed to prevent AVR ghost powering via SCK line,
+        // queued transactions don't go through spi_lock, so the delay is restarted each time the queue drains
+        k_work_reschedule(&disable_sck_work, K_USEC(CONFIG_SPI_DISABLE_CLK_DELAY));
+    }
+}
+#else
+static inline void schedule_disable_sck() {}
 #endif // CONFIG_SPI_DISABLE_CLK_DELAY > 0
 
+/**
+ * @brief Apply SPI configuration to the peripheral, unless it's already applied.
+ *
+ * @return true if SCK was brought high and the caller has to wait for CONFIG_SPI_ENABLE_CLK_DELAY
+ */
+static bool spi_apply_config(const struct spi_configuration* config) {
+    if (config->is_const && config == prev_config) {
+        return false;
+    }
+
+    nrf_spim_configure(NRF_SPIM0, config->op_mode, config->bit_order);
+    nrf_spim_frequency_set(NRF_SPIM0, config->freq);
+
+    bool needs_clk_delay = CONFIG_SPI_ENABLE_CLK_DELAY > 0 &&
+        (!prev_config || !is_sck_inactive_high(prev_config->op_mode)) && is_sck_inactive_high(config->op_mode);
+
+    prev_config = config;
+
+    if (config->stats) {
+        config->stats->counters.reconfigurations++;
+        config->stats->counters.clk_enable_stalls += needs_clk_delay;
+    }
+
+    return needs_clk_delay;
+}
+
+/* SPIM DMA can only access RAM. TX data located elsewhere (e.g. const data in flash) is copied
+ * into the bounce buffer right before the transfer, in chunks if it doesn't fit. Only one transfer
+ * is in progress at a time, so a single buffer is enough.
+ */
+static uint8_t spi_bounce_buf[CONFIG_SPI_BOUNCE_BUF_SIZE];
+
+static inline bool is_spec_supported(const struct spi_transfer_spec* spec) {
+    return spec->rx_buf == NULL || nrfx_is_in_ram(spec->rx_buf);
+}
+
+static inline void spi_start_transfer(const struct spi_transfer_spec* spec) {
+    nrf_spim_tx_buffer_set(NRF_SPIM0, spec->tx_buf, spec->tx_len);
+    nrf_spim_rx_buffer_set(NRF_SPIM0, spec->rx_buf, spec->rx_len);
+    nrf_spim_event_clear(NRF_SPIM0, NRF_SPIM_EVENT_END);
+    nrf_spim_task_trigger(NRF_SPIM0, NRF_SPIM_TASK_START);
+}
+
+static inline uint32_t spi_segment_len(const struct spi_transfer_spec* spec) {
+    return MAX(spec->tx_len, spec->rx_len);
+}
+
+/**
+ * @brief Start transfer of the current segment from its current offset, i.e. the whole segment or its next chunk.
+ */
+static void spi_queue_start_chunk(struct spi_transaction* transaction) {
+    const struct spi_configuration* config = transaction->config;
+    const struct spi_transfer_spec* segment = &transaction->segments[transaction->current_segment];
+    uint32_t offset = transaction->segment_offset;
+
+    struct spi_transfer_spec chunk = {
+        .tx_buf = offset < segment->tx_len ? (const uint8_t*) segment->tx_buf + offset : NULL,
+        .tx_len = offset < segment->tx_len ? segment->tx_len - offset : 0,
+        .rx_buf = offset < segment->rx_len ? (uint8_t*) segment->rx_buf + offset : NULL,
+        .rx_len = offset < segment->rx_len ? segment->rx_len - offset : 0,
+    };
+    if (chunk.tx_buf && !nrfx_is_in_ram(chunk.tx_buf)) {
+        chunk.tx_len = MIN(chunk.tx_len, sizeof(spi_bounce_buf));
+        chunk.rx_len = MIN(chunk.rx_len, sizeof(spi_bounce_buf));
+        memcpy(spi_bounce_buf, chunk.tx_buf, chunk.tx_len);
+        chunk.tx_buf = spi_bounce_buf;
+    }
+    transaction->segment_offset += MAX(chunk.tx_len, chunk.rx_len);
+    if (config->stats) {
+        config->stats->counters.bytes += MAX(chunk.tx_len, chunk.rx_len);
+    }
+
+    bool is_segment_end = transaction->segment_offset >= spi_segment_len(segment);
+    bool is_last = is_segment_end && transaction->current_segment + 1 == transaction->num_segments;
+
+    // the timer is started by SPIM END, compare value can't be 0 as the timer is stopped on compare
+    uint32_t delay_us = is_last ? config->cs_hold_us : (is_segment_end ? config->segment_gap_us : 0);
+    nrf_timer_cc_set(SPI_TIMER, NRF_TIMER_CC_CHANNEL0, MAX(delay_us, 1));
+    if (is_last) {
+        nrf_ppi_channel_enable(NRF_PPI, SPI_CS_PPI_CH);
+    } else {
+        nrf_ppi_channel_disable(NRF_PPI, SPI_CS_PPI_CH);
+    }
+
+    spi_start_transfer(&chunk);
+}
+
+static void spi_queue_begin_active() {
+    struct spi_transaction* transaction = active_transaction;
+    transaction->start_cycles = k_cycle_get_32();
+    transaction->current_segment = 0;
+    transaction->segment_offset = 0;
+
+    // END interrupt is only used by spi_transceive, transaction segments are advanced from timer interrupt
+    nrf_spim_int_disable(NRF_SPIM0, NRF_SPIM_INT_END_MASK);
+
+    // CS is driven by GPIOTE while the transaction is active, once the task is disabled the pin is inactive again
+    nrf_gpio_pin_write(transaction->cs_pin, CS_INACT);
+    nrf_gpiote_task_configure(NRF_GPIOTE, SPI_CS_GPIOTE_CH_NUM, transaction->cs_pin,
+                              NRF_GPIOTE_POLARITY_LOTOHI, NRF_GPIOTE_INITIAL_VALUE_LOW);
+    nrf_gpiote_task_enable(NRF_GPIOTE, SPI_CS_GPIOTE_CH_NUM);
+    nrf_ppi_channel_enable(NRF_PPI, SPI_TIMER_START_PPI_CH);
+
+    spi_queue_start_chunk(transaction);
+}
+
+static void spi_clk_delay_expired(struct k_timer* timer) {
+    spi_queue_begin_active();
+}
+
+K_TIMER_DEFINE(spi_clk_delay_timer, spi_clk_delay_expired, NULL);
+
+/**
+ * @brief Start next queued transaction, if the bus is free. Must be called with interrupts locked or from ISR.
+ */
+static void spi_queue_start_next() {
+    if (active_transaction || is_queue_paused) {
+        return;
+    }
+
+    sys_snode_t* node = NULL;
+    for (int prio = SPI_NUM_PRIORITIES - 1; prio >= 0 && !node; prio--) {
+        node = sys_slist_get(&spi_queues[prio]);
+    }
+    if (!node) {
+        schedule_disable_sck();
+        return;
+    }
+
+    active_transaction = CONTAINER_OF(node, struct spi_transaction, node);
+    if (spi_apply_config(active_transaction->config)) {
+        // wait more time than normally so that AVR's capacitors can charge up from SCK,
+        // the transaction is started from the timer so that the ISR is not blocked
+        k_timer_start(&spi_clk_delay_timer, K_USEC(CONFIG_SPI_ENABLE_CLK_DELAY), K_NO_WAIT);
+    } else {
+        spi_queue_begin_active();
+    }
+}
+
+static void spi_queue_complete_active(int err) {
+    struct spi_transaction* transaction = active_transaction;
+
+    // CS has already been released by PPI, unless the transaction was aborted before the last segment
+    nrf_ppi_channel_disable(NRF_PPI, SPI_TIMER_START_PPI_CH);
+    nrf_ppi_channel_disable(NRF_PPI, SPI_CS_PPI_CH);
+    nrf_gpiote_task_trigger(NRF_GPIOTE, CONCAT(NRF_GPIOTE_TASK_SET_, SPI_CS_GPIOTE_CH_NUM));
+    nrf_gpiote_task_disable(NRF_GPIOTE, SPI_CS_GPIOTE_CH_NUM);
+
+    nrf_spim_event_clear(NRF_SPIM0, NRF_SPIM_EVENT_END);
+    nrf_spim_int_enable(NRF_SPIM0, NRF_SPIM_INT_END_MASK);
+
+    uint32_t now = k_cycle_get_32();
+    uint32_t latency_us = k_cyc_to_us_floor32(now - transaction->submit_cycles);
+    uint32_t wait_us = k_cyc_to_us_floor32(transaction->start_cycles - transaction->submit_cycles);
+    if (wait_us > queue_stats.wait_max_us[transaction->priority]) {
+        queue_stats.wait_max_us[transaction->priority] = wait_us;
+    }
+    queue_stats.num_transactions++;
+    queue_stats.busy_us += k_cyc_to_us_floor32(now - transaction->start_cycles);
+    queue_stats.latency_sum_us += latency_us;
+    if (latency_us > queue_stats.latency_max_us) {
+        queue_stats.latency_max_us = latency_us;
+    }
+
+    struct spi_device_stats* device_stats = transaction->config->stats;
+    if (device_stats) {
+        device_stats->counters.num_transactions++;
+        device_stats->counters.errors += err != 0;
+        device_stats->counters.wait_max_us = MAX(device_stats->counters.wait_max_us, wait_us);
+        spi_stats_hist_add(device_stats->counters.wait_hist, wait_us);
+        spi_stats_hist_add(device_stats->counters.transfer_hist, k_cyc_to_us_floor32(now - transaction->start_cycles));
+    }
+
+    active_transaction = NULL;
+    if (transaction->callback) {
+        transaction->callback(transaction, err);
+    }
+
+    if (is_queue_paused) {
+        // a thread is waiting in spi_lock for the active transaction to complete
+        k_sem_give(&spi_queue_idle_sem);
+    } else {
+        spi_queue_start_next();
+    }
+}
+
 int spi_lock(k_timeout_t timeout) {
 #if CONFIG_SPI_DISABLE_CLK_DELAY > 0
     k_work_cancel_delayable(&disable_sck_work);
 #endif
-    return k_mutex_lock(&spi_mutex, timeout);
+    uint32_t lock_start_cycles = k_cycle_get_32();
+    int err = k_mutex_lock(&spi_mutex, timeout);
+    if (err) {
+        return err;
+    }
+
+    // pause the queue and wait for the active transaction (if any) to complete
+    unsigned key = irq_lock();
+    is_queue_paused = true;
+    k_sem_reset(&spi_queue_idle_sem);
+    bool is_busy = active_transaction != NULL;
+    irq_unlock(key);
+
+    if (is_busy) {
+        k_sem_take(&spi_queue_idle_sem, K_FOREVER);
+    }
+
+    uint32_t lock_wait_us = k_cyc_to_us_floor32(k_cycle_get_32() - lock_start_cycles);
+    key = irq_lock();
+    queue_stats.num_locks++;
+    queue_stats.lock_wait_sum_us += lock_wait_us;
+    queue_stats.lock_wait_max_us = MAX(queue_stats.lock_wait_max_us, lock_wait_us);
+    irq_unlock(key);
+
+    return 0;
 }
 
 int spi_unlock() {
     // k_mutex_unlock returns an error if the lock is not owned by this thread, no need to CHECK_LOCK_OWNED
     int err = k_mutex_unlock(&spi_mutex);
-#if CONFIG_SPI_DISABLE_CLK_DELAY > 0
-    if (likely(!err) && prev_config && is_sck_inactive_high(prev_config->op_mode)) {
-        // if previous configuration has SCK inactive high, schedule disabling it after a period of inactivity
-        // this is needed to prevent AVR ghost powering via SCK line
-        k_work_schedule(&disable_sck_work, K_USEC(CONFIG_SPI_DISABLE_CLK_DELAY));
+    if (likely(!err)) {
+        unsigned key = irq_lock();
+        if (!spi_mutex.owner) {
+            // the lock is fully released and not handed over to another thread, resume the queue
+            is_queue_paused = false;
+            spi_queue_start_next();
+        }
+        irq_unlock(key);
     }
-#endif
     return err;
 }
 
 int spi_configure(const struct spi_configuration* config) {
     CHECK_LOCK_OWNED();
 
-    if (config->is_const && config == prev_config) {
-        return 0;
-    }
-
-    nrf_spim_configure(NRF_SPIM0, config->op_mode, config->bit_order);
-    nrf_spim_frequency_set(NRF_SPIM0, config->freq);
-
-#if CONFIG_SPI_ENABLE_CLK_DELAY > 0
-    if ((!prev_config || !is_sck_inactive_high(prev_config->op_mode)) && is_sck_inactive_high(config->op_mode)) {
+    if (spi_apply_config(config)) {
         // wait more time than normally so that AVR's capacitors can charge up from SCK
         k_usleep(CONFIG_SPI_ENABLE_CLK_DELAY);
     }
-#endif
-
-    prev_config = config;
 
     return 0;
 }
 
-static inline bool is_addr_in_ram(const void* ptr)
-{
-    return ((((uint32_t)ptr) & 0xE0000000u) == 0x20000000u);
-}
-
 int spi_transceive(const struct spi_transfer_spec* spec, void (*callback)(void*), void* arg) {
     CHECK_LOCK_OWNED();
 
-    if ((spec->tx_buf != NULL && !is_addr_in_ram(spec->tx_buf)) || (spec->rx_buf != NULL && !is_addr_in_ram(spec->rx_buf))) {
-        LOG_ERR("buf not in ram");
+    struct spi_transfer_spec bounced_spec = *spec;
+    if (spec->tx_buf && !nrfx_is_in_ram(spec->tx_buf)) {
+        // low-level transfers are not chunked, the data has to fit into the bounce buffer
+        if (spec->tx_len > sizeof(spi_bounce_buf)) {
+            LOG_ERR("tx buf not in ram and exceeds bounce buf");
+            return -EINVAL;
+        }
+        memcpy(spi_bounce_buf, spec->tx_buf, spec->tx_len);
+        bounced_spec.tx_buf = spi_bounce_buf;
+    }
+    if (!is_spec_supported(spec)) {
+        LOG_ERR("rx buf not in ram");
         return -EINVAL;
     }
 
     spi_isr_ctx.callback = callback;
     spi_isr_ctx.arg = arg;
 
-    nrf_spim_tx_buffer_set(NRF_SPIM0, spec->tx_buf, spec->tx_len);
-    nrf_spim_rx_buffer_set(NRF_SPIM0, spec->rx_buf, spec->rx_len);
-    nrf_spim_event_clear(NRF_SPIM0, NRF_SPIM_EVENT_END);
-    nrf_spim_task_trigger(NRF_SPIM0, NRF_SPIM_TASK_START);
+    spi_start_transfer(&bounced_spec);
 
     return 0;
 }
@@ -130,50 +395,105 @@ int spi_transceive_sync(struct spi_transfer_spec* spec) {
     return k_sem_take(&spi_sync_sem, K_FOREVER);
 }
 
-int spi_transceive_managed(const struct spi_configuration* config, const uint32_t cs_pin,
-                           const struct spi_transfer_spec* spec, void (*callback)(void*),
-                           const k_timeout_t timeout) {
-    int err;
-
-    err = spi_lock(K_MSEC(100));
-    if (unlikely(err)) {
-        LOG_ERR("can't obtain spi lock: error %d", err);
-        goto exit;
+int spi_submit(struct spi_transaction* transaction) {
+    if (!transaction->num_segments || transaction->priority >= SPI_NUM_PRIORITIES) {
+        return -EINVAL;
+    }
+    for (uint32_t i = 0; i < transaction->num_segments; i++) {
+        if (!is_spec_supported(&transaction->segments[i])) {
+            LOG_ERR("rx buf not in ram");
+            return -EINVAL;
+        }
     }
 
-    err = spi_configure(config);
-    if (unlikely(err)) {
-        LOG_ERR("can't configure spi: error %d", err);
-        goto exit;
+    transaction->submit_cycles = k_cycle_get_32();
+
+    unsigned key = irq_lock();
+    struct spi_device_stats* device_stats = transaction->config->stats;
+    if (device_stats && !device_stats->is_registered) {
+        device_stats->is_registered = true;
+        sys_slist_append(&device_stats_list, &device_stats->node);
     }
+    sys_slist_append(&spi_queues[transaction->priority], &transaction->node);
+    spi_queue_start_next();
+    irq_unlock(key);
 
-    nrf_gpio_pin_write(cs_pin, !CS_INACT);
+    return 0;
+}
 
-    err = spi_transceive(spec, callback, &spi_sync_sem);
+/**
+ * @brief Remove a transaction from the queue if it has not been started yet.
+ *
+ * @return 0 if the transaction was removed, -EBUSY if it is being executed or already completed
+ */
+static int spi_cancel(struct spi_transaction* transaction) {
+    unsigned key = irq_lock();
+    bool removed = sys_slist_find_and_remove(&spi_queues[transaction->priority], &transaction->node);
+    irq_unlock(key);
+    return removed ? 0 : -EBUSY;
+}
+
+struct spi_transact_ctx {
+    struct k_sem sem;
+    int err;
+};
+
+static void spi_transact_callback(struct spi_transaction* transaction, int err) {
+    struct spi_transact_ctx* ctx = transaction->user_data;
+    ctx->err = err;
+    k_sem_give(&ctx->sem);
+}
+
+int spi_transact(struct spi_transaction* transaction, k_timeout_t timeout) {
+    struct spi_transact_ctx ctx;
+    k_sem_init(&ctx.sem, 0, 1);
+    ctx.err = -EIO;
+
+    transaction->callback = spi_transact_callback;
+    transaction->user_data = &ctx;
+
+    int err = spi_submit(transaction);
     if (unlikely(err)) {
-        LOG_ERR("can't start spi %cx transfer: error %d", 't', err);
-        goto exit;
+        return err;
     }
 
-    err = k_sem_take(&spi_sync_sem, timeout);
+    err = k_sem_take(&ctx.sem, timeout);
     if (unlikely(err)) {
-        if (err == -EAGAIN) {
-            LOG_ERR("timed out waiting for spi transaction to end");
-        } else {
-            LOG_ERR("got error %d while waiting for spi transaction to end", err);
+        LOG_ERR("timed out waiting for spi transaction to end");
+        if (spi_cancel(transaction)) {
+            // the transaction is in progress, it's bound to complete soon (and it must, as ctx is on stack)
+            k_sem_take(&ctx.sem, K_FOREVER);
         }
-        goto exit;
+        return err;
     }
 
-    // if everything went fine, wait for a bit before restoring CS back to high
-    // e.g. the optical sensor needs t_{SCLK-NCS} = 20us "for valid MOSI data transfer"
-    // note that there's also SPI task/event latency + thread resuming which take about 14us
-    k_usleep(10);
+    return ctx.err;
+}
 
-exit:
-    nrf_gpio_pin_write(cs_pin, CS_INACT);
-    spi_unlock();
-    return err;
+void spi_queue_stats_get(struct spi_queue_stats* stats) {
+    unsigned key = irq_lock();
+    *stats = queue_stats;
+    irq_unlock(key);
+}
+
+void spi_queue_stats_reset() {
+    unsigned key = irq_lock();
+    queue_stats = (struct spi_queue_stats) {.since_ms = k_uptime_get()};
+    struct spi_device_stats* device_stats;
+    SYS_SLIST_FOR_EACH_CONTAINER(&device_stats_list, device_stats, node) {
+        device_stats->counters = (struct spi_device_counters) {};
+    }
+    irq_unlock(key);
+}
+
+void spi_device_stats_foreach(spi_device_stats_cb callback, void* user_data) {
+    struct spi_device_stats* device_stats;
+    SYS_SLIST_FOR_EACH_CONTAINER(&device_stats_list, device_stats, node) {
+        unsigned key = irq_lock();
+        struct spi_device_counters counters = device_stats->counters;
+        irq_unlock(key);
+        callback(device_stats->name, &counters, user_data);
+    }
 }
 
 static void spi_irq_handler() {
@@ -186,6 +506,57 @@ static void spi_irq_handler() {
     }
 }
 
+static void spi_timer_irq_handler() {
+    // irq is called on COMPARE0 event only, i.e. CS hold time or gap between segments has passed
+    nrf_timer_event_clear(SPI_TIMER, NRF_TIMER_EVENT_COMPARE0);
+
+    struct spi_transaction* transaction = active_transaction;
+    if (!transaction) {
+        return;
+    }
+
+    if (transaction->segment_offset < spi_segment_len(&transaction->segments[transaction->current_segment])) {
+        // the segment is transferred in chunks, continue with the next one
+        spi_queue_start_chunk(transaction);
+        return;
+    }
+
+    int err = transaction->segment_done ? transaction->segment_done(transaction, transaction->current_segment) : 0;
+    if (!err && ++transaction->current_segment < transaction->num_segments) {
+        transaction->segment_offset = 0;
+        spi_queue_start_chunk(transaction);
+        return;
+    }
+
+    spi_queue_complete_active(err);
+}
+
+static void spi_timer_init() {
+    nrf_timer_task_trigger(SPI_TIMER, NRF_TIMER_TASK_STOP);
+    nrf_timer_task_trigger(SPI_TIMER, NRF_TIMER_TASK_CLEAR);
+    nrf_timer_event_clear(SPI_TIMER, NRF_TIMER_EVENT_COMPARE0);
+
+    nrf_timer_mode_set(SPI_TIMER, NRF_TIMER_MODE_TIMER);
+    nrf_timer_bit_width_set(SPI_TIMER, NRF_TIMER_BIT_WIDTH_16);
+    nrf_timer_frequency_set(SPI_TIMER, NRF_TIMER_FREQ_1MHz);
+    nrf_timer_shorts_set(SPI_TIMER, NRF_TIMER_SHORT_COMPARE0_STOP_MASK | NRF_TIMER_SHORT_COMPARE0_CLEAR_MASK);
+
+    nrf_ppi_channel_endpoint_setup(
+        NRF_PPI, SPI_TIMER_START_PPI_CH,
+        nrf_spim_event_address_get(NRF_SPIM0, NRF_SPIM_EVENT_END),
+        nrf_timer_task_address_get(SPI_TIMER, NRF_TIMER_TASK_START)
+    );
+    nrf_ppi_channel_endpoint_setup(
+        NRF_PPI, SPI_CS_PPI_CH,
+        nrf_timer_event_address_get(SPI_TIMER, NRF_TIMER_EVENT_COMPARE0),
+        nrf_gpiote_task_address_get(NRF_GPIOTE, CONCAT(NRF_GPIOTE_TASK_SET_, SPI_CS_GPIOTE_CH_NUM))
+    );
+
+    nrf_timer_int_enable(SPI_TIMER, NRF_TIMER_INT_COMPARE0_MASK);
+    IRQ_CONNECT(DT_IRQN(SPI_TIMER_DT_NODE), DT_IRQ(SPIM_NODE, priority), spi_timer_irq_handler, NULL, 0);
+    irq_enable(DT_IRQN(SPI_TIMER_DT_NODE));
+}
+
 static int spi_init(const struct device* dev) {
     ARG_UNUSED(dev);
 
@@ -205,6 +576,8 @@ static int spi_init(const struct device* dev) {
     IRQ_CONNECT(DT_IRQN(SPIM_NODE), DT_IRQ(SPIM_NODE, priority), spi_irq_handler, NULL, 0);
     irq_enable(DT_IRQN(SPIM_NODE));
 
+    spi_timer_init();
+
     return 0;
 }
 
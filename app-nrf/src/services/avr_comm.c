@@ -2,6 +2,7 @@
 #include <stdint.h>
 
 #include <errno.h>
+#include <string.h>
 #include <hal/nrf_gpio.h>
 #include <zephyr/device.h>
 #include <zephyr/devicetree.h>
@@ -9,10 +10,12 @@
 #include <zephyr/kernel.h>
 #include <zephyr/logging/log.h>
 
+#include "avr_link.h"
 #include "hid_report_map.h"
 #include "hid_report_struct.h"
 #include "platform/gpio.h"
 #include "platform/spi.h"
+#include "services/avr_comm.h"
 
 LOG_MODULE_REGISTER(avr);
 
@@ -58,11 +61,16 @@ static bool did_avr_appear() {
     return false;
 }
 
+static struct spi_device_stats avr_spi_stats = {.name = "avr"};
+
 const static struct spi_configuration avr_spi_config = {
     .op_mode = NRF_SPIM_MODE_3,  // same as optical sensor
     .bit_order = NRF_SPIM_BIT_ORDER_MSB_FIRST,
     .freq = SPI_CONFIG_FREQUENCY(DT_INST_PROP(0, spi_max_frequency)),
+    .segment_gap_us = 5,  // gives the AVR some slack after the handshake
+    .cs_hold_us = 10,
     .is_const = true,
+    .stats = &avr_spi_stats,
 };
 
 static void avr_init_gpios() {
@@ -75,147 +83,558 @@ static void avr_init_gpios() {
     nrf_gpio_cfg_input(IRQ_PIN, NRF_GPIO_PIN_NOPULL);
 }
 
-/**
- * @brief Update CRC value with the new data byte
- *
- * Adapted from C implementation of @c _crc_ibutton_update from avr-gcc.
- */
-static uint8_t update_crc(uint8_t crc, uint8_t data) {
-    crc = crc ^ data;
-    for (int i = 0; i < 8; i++) {
-        if (crc & 0x01)
-            crc = (crc >> 1) ^ 0x8C;
-        else
-            crc >>= 1;
+// the AVR does not serve SPI while it's busy (e.g. waiting for USB control data or writing EEPROM),
+// so it's only considered gone once exchanges keep failing for this long
+#define AVR_TIMEOUT_MS 1000
+// delay before retrying a failed exchange, doubled with each failure in a row
+#define RETRY_DELAY_MIN_MS 1
+#define RETRY_DELAY_MAX_MS 64
+// AVR presence is checked with this period while it has nothing to say
+#define PRESENCE_CHECK_PERIOD_MS 500
+// how long a report which can't be merged waits for the pending one to be sent
+#define SUBMIT_TIMEOUT_MS 20
+// AVR processes the frame after CS goes high, in its main loop
+#define FRAME_PROCESSING_TIME_US 150
+// number of replies to the host buffered here, in addition to the AVR queue
+#define REPLY_QUEUE_SIZE 8
+
+static const uint8_t avr_device_id[] = {0x1E, 0x93, 0x89};
+
+static uint8_t avr_status = 0;
+static avr_comm_usb_ready_cb usb_ready_cb = NULL;
+static avr_comm_message_cb message_cb = NULL;
+static avr_comm_dfu_chunk_cb dfu_chunk_cb = NULL;
+static avr_comm_link_up_cb link_up_cb = NULL;
+
+static struct avr_link_dfu_status dfu_status;
+static bool is_dfu_status_pending = false;
+
+static struct hid_report pending_report;
+static bool is_report_pending = false;
+
+// remote wakeup is requested once per suspend, by the first report submitted
+static bool is_wakeup_requested = false;
+static bool is_wakeup_pending = false;
+
+K_MUTEX_DEFINE(report_mutex);
+K_CONDVAR_DEFINE(report_sent_condvar);
+
+struct app_reply {
+    uint8_t size;
+    uint8_t data[AVR_LINK_APP_MESSAGE_MAX_SIZE];
+};
+
+K_MSGQ_DEFINE(reply_msgq, sizeof(struct app_reply), REPLY_QUEUE_SIZE, 1);
+
+// given when there is a report to send or when AVR asserts IRQ
+K_SEM_DEFINE(wakeup_sem, 0, 1);
+
+bool avr_comm_usb_ready() {
+    return avr_status & AVR_LINK_STATUS_USB_CONFIGURED;
+}
+
+static bool is_usb_suspended() {
+    return avr_status & AVR_LINK_STATUS_USB_SUSPENDED;
+}
+
+void avr_comm_set_usb_ready_cb(avr_comm_usb_ready_cb callback) {
+    usb_ready_cb = callback;
+}
+
+void avr_comm_set_message_cb(avr_comm_message_cb callback) {
+    message_cb = callback;
+}
+
+void avr_comm_set_dfu_chunk_cb(avr_comm_dfu_chunk_cb callback) {
+    dfu_chunk_cb = callback;
+}
+
+void avr_comm_set_link_up_cb(avr_comm_link_up_cb callback) {
+    link_up_cb = callback;
+}
+
+static void set_avr_status(uint8_t status) {
+    bool was_usb_ready = avr_comm_usb_ready();
+
+    k_mutex_lock(&report_mutex, K_FOREVER);
+    avr_status = status;
+    if (!avr_comm_usb_ready() || is_usb_suspended()) {
+        is_report_pending = false;
+        k_condvar_broadcast(&report_sent_condvar);
+    }
+    if (!is_usb_suspended()) {
+        is_wakeup_requested = false;
+    }
+    k_mutex_unlock(&report_mutex);
+
+    if (!avr_comm_usb_ready()) {
+        k_msgq_purge(&reply_msgq);
+    }
+
+    if (usb_ready_cb && avr_comm_usb_ready() != was_usb_ready) {
+        usb_ready_cb(avr_comm_usb_ready());
     }
-    return crc;
 }
 
-#define HANDSHAKE_NUM_BYTES 2  // having 2-byte handshake rather than 1-byte also addresses PAN 58
-#define HANDSHAKE_TX_VALUE  0x42
-#define HANDSHAKE_RX_VALUE  0x43
+int avr_comm_submit_report(const struct hid_report* report) {
+    int err = 0;
 
-static struct {
-    int err;
-    uint8_t handshake_rx_buf[HANDSHAKE_NUM_BYTES];
-    const struct spi_transfer_spec* spec;
-} avr_spi_cb_ctx;
-
-static void avr_spi_done_callback(void* arg) {
-    if (avr_spi_cb_ctx.spec) {
-        if (avr_spi_cb_ctx.handshake_rx_buf[0] != HANDSHAKE_RX_VALUE) {
-            // AVR didn't respond to handshake, abort the transaction
-            avr_spi_cb_ctx.err = -EBUSY;
+    k_mutex_lock(&report_mutex, K_FOREVER);
+    if (is_usb_suspended()) {
+        // the host does not poll until it resumes, so the report only serves to wake it up
+        if (!is_wakeup_requested && (avr_status & AVR_LINK_STATUS_REMOTE_WAKEUP)) {
+            is_wakeup_requested = true;
+            is_wakeup_pending = true;
+            k_sem_give(&wakeup_sem);
+        }
+        k_mutex_unlock(&report_mutex);
+        return 0;
+    }
+    // merging a button change would lose the click, so let the pending report go first
+    while (avr_comm_usb_ready() && is_report_pending && !can_merge_hid_reports_losslessly(&pending_report, report)) {
+        if (k_condvar_wait(&report_sent_condvar, &report_mutex, K_MSEC(SUBMIT_TIMEOUT_MS))) {
+            err = -EAGAIN;
+            break;
+        }
+    }
+    if (!avr_comm_usb_ready()) {
+        err = -ENOTCONN;
+    } else if (!err) {
+        if (is_report_pending) {
+            merge_hid_reports(&pending_report, report);
         } else {
-            avr_spi_cb_ctx.err = spi_transceive(avr_spi_cb_ctx.spec, avr_spi_done_callback, arg);
-            if (!avr_spi_cb_ctx.err) {
-                avr_spi_cb_ctx.spec = NULL;
-                return;  // wait for callback from second transaction
+            pending_report = *report;
+            is_report_pending = true;
+        }
+        k_sem_give(&wakeup_sem);
+    }
+    k_mutex_unlock(&report_mutex);
+    return err;
+}
+
+int avr_comm_send_reply(const uint8_t* data, uint8_t size, k_timeout_t timeout) {
+    if (!size || size > AVR_LINK_APP_MESSAGE_MAX_SIZE) {
+        return -EINVAL;
+    }
+    if (!avr_comm_usb_ready()) {
+        return -ENOTCONN;
+    }
+
+    struct app_reply reply = {.size = size};
+    memcpy(reply.data, data, size);
+    if (k_msgq_put(&reply_msgq, &reply, timeout)) {
+        return -EAGAIN;
+    }
+    k_sem_give(&wakeup_sem);
+    return 0;
+}
+
+static bool is_irq_asserted() {
+    return nrf_gpio_pin_read(IRQ_PIN) == 0;
+}
+
+static void avr_irq_cb(uint32_t pin, bool new_level) {
+    k_sem_give(&wakeup_sem);
+}
+
+static int avr_check_handshake(struct spi_transaction* transaction, uint32_t segment_idx) {
+    const uint8_t* handshake_rx_buf = transaction->segments[0].rx_buf;
+    if (segment_idx == 0 && handshake_rx_buf[0] != AVR_LINK_HANDSHAKE_RX) {
+        // AVR didn't respond to handshake, abort the transaction
+        return -EBUSY;
+    }
+    return 0;
+}
+
+static struct avr_link_report_stats report_stats;
+
+static void update_report_stats(const struct avr_link_report_stats* stats) {
+    if (stats->overflows != report_stats.overflows) {
+        LOG_WRN("avr report queue overflowed %u times", (uint16_t) (stats->overflows - report_stats.overflows));
+    }
+    LOG_DBG("avr report stats: busy %u, overflows %u", stats->busy, stats->overflows);
+    report_stats = *stats;
+}
+
+static struct avr_link_tx_window tx_window;  // frames sent to the AVR, kept until it acknowledges them
+static uint8_t rx_seq = 0;       // sequence number of the last valid frame received from AVR
+static bool is_seq_synced = false;  // cleared when AVR (re)connects, its counters are not known then
+static bool is_reply_unconfirmed = false;  // reply sent in the last frame is not reflected in AVR status yet
+static bool is_avr_id_received = false;
+static bool is_avr_descriptor_hash_received = false;
+static uint16_t avr_descriptor_hash;
+static int64_t next_exchange_ticks = 0;
+
+static void frame_start(uint8_t* frame) {
+    // sequence number and ack are filled in each time the frame is (re)sent
+    avr_link_frame_init(frame, 0, 0);
+}
+
+static void process_avr_frame(const uint8_t* frame) {
+    uint8_t seq = avr_link_frame_seq(frame);
+    if (is_seq_synced && seq != (uint8_t) (rx_seq + 1)) {
+        LOG_WRN("avr frame lost (seq %u, expected %u)", seq, (uint8_t) (rx_seq + 1));
+    }
+    // AVR prepares its frame before our frame is clocked in, so it acknowledges the one before it,
+    // a frame lost before that one is resent along with the following ones (which the AVR has discarded)
+    if (avr_link_tx_window_ack(&tx_window, avr_link_frame_ack(frame)) && is_seq_synced) {
+        LOG_WRN("frame lost (ack %u), resending", avr_link_frame_ack(frame));
+    }
+    is_seq_synced = true;
+    rx_seq = seq;
+
+    uint8_t offset = 0, type, size;
+    const uint8_t* data;
+    while (avr_link_frame_next(frame, &offset, &type, &data, &size)) {
+        if (type == AVR_LINK_MSG_STATUS && size == 1) {
+            set_avr_status(data[0]);
+        } else if (type == AVR_LINK_MSG_DEVICE_ID) {
+            is_avr_id_received = size == sizeof(avr_device_id) && !memcmp(data, avr_device_id, size);
+            if (!is_avr_id_received) {
+                LOG_HEXDUMP_ERR(data, size, "invalid device id");
             }
+        } else if (type == AVR_LINK_MSG_DESCRIPTOR_HASH && size == sizeof(avr_descriptor_hash)) {
+            memcpy(&avr_descriptor_hash, data, size);
+            is_avr_descriptor_hash_received = true;
+        } else if (type == AVR_LINK_MSG_APP) {
+            if (message_cb) {
+                message_cb(data, size);
+            } else {
+                LOG_HEXDUMP_WRN(data, size, "unhandled message");
+            }
+        } else if (type == AVR_LINK_MSG_REPORT_STATS && size == sizeof(struct avr_link_report_stats)) {
+            update_report_stats((const struct avr_link_report_stats*) data);
+        } else if (type == AVR_LINK_MSG_DFU_CHUNK && size == sizeof(struct avr_link_dfu_chunk)) {
+            if (dfu_chunk_cb) {
+                dfu_chunk_cb((const struct avr_link_dfu_chunk*) data, &dfu_status);
+                is_dfu_status_pending = true;
+            } else {
+                LOG_WRN("unhandled dfu chunk");
+            }
+        }
+    }
+}
+
+static bool has_reply(const uint8_t* frame) {
+    uint8_t offset = 0, type, size;
+    const uint8_t* data;
+    while (avr_link_frame_next(frame, &offset, &type, &data, &size)) {
+        if (type == AVR_LINK_MSG_APP_REPLY) {
+            return true;
         }
     }
-    k_sem_give((struct k_sem*)arg);
+    return false;
 }
 
 /**
- * @brief Perform SPI transfer and validate CRC of received data.
+ * @brief Send the next pending frame of the window to the AVR and process the frame received from it.
+ *
+ * Waits until the AVR has had time to process the previous frame. While IRQ is asserted, the AVR may have
+ * a longer frame to send, so a full-sized frame is clocked, otherwise only enough bytes for the status.
  */
-static int avr_transceive(uint8_t command_id, const struct spi_transfer_spec* data_spec) {
-    uint8_t handshake_tx_buf[HANDSHAKE_NUM_BYTES] = {HANDSHAKE_TX_VALUE, command_id};
-    struct spi_transfer_spec handshake = {
-        handshake_tx_buf, HANDSHAKE_NUM_BYTES,
-        avr_spi_cb_ctx.handshake_rx_buf, HANDSHAKE_NUM_BYTES,
-    };
+static int avr_exchange() {
+    uint8_t handshake_tx_buf[AVR_LINK_HANDSHAKE_SIZE] = {AVR_LINK_HANDSHAKE_TX, AVR_LINK_VERSION};
+    uint8_t handshake_rx_buf[AVR_LINK_HANDSHAKE_SIZE] = {};
+    uint8_t rx_frame[AVR_LINK_FRAME_MAX_SIZE];
+    uint8_t tx_size;
+    const uint8_t* tx_frame = avr_link_tx_window_next(&tx_window, rx_seq, &tx_size);
 
-    avr_spi_cb_ctx.err = -EIO;  // will remain unchanged if the callback is never called
-    avr_spi_cb_ctx.spec = data_spec;
-    avr_spi_cb_ctx.handshake_rx_buf[0] = 0;
+    // only wait for the remainder of the processing time, if any
+    // (IRQ is sampled afterwards, as the AVR updates it when it's done with the previous frame)
+    k_sleep(K_TIMEOUT_ABS_TICKS(next_exchange_ticks));
 
-    int err = spi_transceive_managed(&avr_spi_config, CS_PIN, &handshake, avr_spi_done_callback, K_USEC(2000));
+    uint8_t rx_size = MAX(tx_size, is_irq_asserted() ? AVR_LINK_FRAME_MAX_SIZE : AVR_LINK_STATUS_FRAME_SIZE);
+    const struct spi_transfer_spec segments[] = {
+        {handshake_tx_buf, AVR_LINK_HANDSHAKE_SIZE, handshake_rx_buf, AVR_LINK_HANDSHAKE_SIZE},
+        {tx_frame, tx_size, rx_frame, rx_size},
+    };
+    struct spi_transaction transaction = {
+        .config = &avr_spi_config,
+        .cs_pin = CS_PIN,
+        .segments = segments,
+        .num_segments = ARRAY_SIZE(segments),
+        .segment_done = avr_check_handshake,
+    };
+    int err = spi_transact(&transaction, K_USEC(2000));
+    next_exchange_ticks = k_uptime_ticks() + k_us_to_ticks_ceil64(FRAME_PROCESSING_TIME_US);
     if (err) {
-        LOG_ERR("failed to transceive %s: %d", "handshake", err);
-        return err;
-    }
-    if (avr_spi_cb_ctx.err) {
-        if (avr_spi_cb_ctx.err == -EBUSY) {
+        if (err == -EBUSY) {
             LOG_WRN("handshake failed");
         } else {
-            LOG_ERR("failed to transceive %s: %d", "data", avr_spi_cb_ctx.err);
+            LOG_ERR("failed to transceive: %d", err);
         }
-        return avr_spi_cb_ctx.err;
+        return err;
     }
+    // AVR has got our frame (or lost it, which it reports with the ack of the next frame)
+    avr_link_tx_window_sent(&tx_window);
+    is_reply_unconfirmed = has_reply(tx_frame);
 
-    if (data_spec->rx_len) {
-        uint8_t i = 0, crc = 0;
-        uint8_t* rx_buf = data_spec->rx_buf;
-        for (; i < data_spec->rx_len - 1; i++) {
-            crc = update_crc(crc, rx_buf[i]);
+    if (!avr_link_frame_check(rx_frame, rx_size)) {
+        LOG_ERR("invalid frame from avr (clocked %u bytes)", rx_size);
+        return -EIO;
+    }
+    process_avr_frame(rx_frame);
+    return 0;
+}
+
+static int64_t failing_since_ms = -1;  // uptime of the first failed exchange in a row, -1 if the last one succeeded
+static uint32_t retry_delay_ms = RETRY_DELAY_MIN_MS;
+
+/**
+ * @brief Account for the result of an exchange, return true if the AVR is considered gone.
+ *
+ * After a failure, waits before the next exchange, so that a busy AVR is not flooded with handshakes.
+ */
+static bool is_avr_gone(int err) {
+    if (!err) {
+        failing_since_ms = -1;
+        retry_delay_ms = RETRY_DELAY_MIN_MS;
+        return false;
+    }
+    int64_t now = k_uptime_get();
+    if (failing_since_ms < 0) {
+        failing_since_ms = now;
+    } else if (now - failing_since_ms >= AVR_TIMEOUT_MS) {
+        return true;
+    }
+    k_msleep(retry_delay_ms);
+    retry_delay_ms = MIN(2 * retry_delay_ms, RETRY_DELAY_MAX_MS);
+    return false;
+}
+
+static void push_status_frame() {
+    uint8_t frame[AVR_LINK_FRAME_MAX_SIZE];
+    frame_start(frame);
+    avr_link_tx_window_push(&tx_window, frame);
+}
+
+/**
+ * @brief Send the next pending frame, retrying until the AVR responds or is considered gone.
+ *
+ * When the AVR responds with an invalid frame, ours has been clocked out, and only the ack in the next AVR
+ * frame tells whether it was received. So the next frame is sent instead, a frame with no messages if there
+ * is none.
+ */
+static int exchange_next() {
+    int err;
+    while ((err = avr_exchange()) && !is_avr_gone(err)) {
+        if (!avr_link_tx_window_pending(&tx_window)) {
+            push_status_frame();
         }
-        if (crc != rx_buf[i]) {
-            LOG_ERR("expected crc 0x%x, got 0x%x (payload size %u)", crc, rx_buf[i], data_spec->rx_len);
-            return -EIO;
+    }
+    return err;
+}
+
+/**
+ * @brief Send frames waiting to be resent (if any), then the frame.
+ */
+static int send_frame(const uint8_t* frame) {
+    while (avr_link_tx_window_pending(&tx_window)) {
+        int err = exchange_next();
+        if (err) {
+            return err;
         }
     }
-    return 0;
+    avr_link_tx_window_push(&tx_window, frame);
+    return exchange_next();
+}
+
+/**
+ * @brief Exchange a frame with no messages, to get AVR status.
+ */
+static int exchange_status() {
+    uint8_t frame[AVR_LINK_FRAME_MAX_SIZE];
+    frame_start(frame);
+    return send_frame(frame);
 }
 
 /**
- * @brief Verify AVR ID via command @c 0x06.
+ * @brief Verify AVR ID, which the AVR sends in the first frame after (re)connection.
  *
  * Returns negative error code on error, 0 if AVR responds with expected ID and 1 if the ID is incorrect.
  */
-static int verify_avr_id(bool log_err) {
-    uint8_t response[4];
-    struct spi_transfer_spec spec = {NULL, 0, response, sizeof(response)};
-    int err = avr_transceive(0x06, &spec);
+static int verify_avr_id() {
+    is_avr_id_received = false;
+    is_avr_descriptor_hash_received = false;
+    is_seq_synced = false;
+    is_reply_unconfirmed = false;
+    avr_link_tx_window_init(&tx_window);
+    failing_since_ms = -1;
+    retry_delay_ms = RETRY_DELAY_MIN_MS;
+    report_stats = (struct avr_link_report_stats) {};
+    // the AVR may have been reset, let it know how far an update has got
+    is_dfu_status_pending = true;
+    int err = exchange_status();
     if (err) {
         return err;
     }
-    if (response[0] != 0x1E || response[1] != 0x93 || response[2] != 0x89) {
-        if (log_err) {
-            LOG_ERR("invalid response id: %x %x %x", response[0], response[1], response[2]);
-        }
-        return 1;
-    }
-    return 0;
+    return is_avr_id_received ? 0 : 1;
 }
 
-static int send_report_descriptor() {
-    // the buffer has to be in RAM for DMA to work, so we need to copy descriptor onto stack
-    uint8_t report_descriptor[HID_REPORT_MAP_SIZE];
-    memcpy(report_descriptor, hid_report_map, HID_REPORT_MAP_SIZE);
-    struct spi_transfer_spec spec = {report_descriptor, HID_REPORT_MAP_SIZE, NULL, 0};
-    return avr_transceive(0x08, &spec);
+// the descriptor is sent in chunks so that sensor transactions can be scheduled in between
+#define REPORT_DESCRIPTOR_CHUNK_SIZE 16
+
+/**
+ * @brief Check if the AVR already uses our report descriptor (e.g. cached from a previous upload).
+ *
+ * The AVR has USB enabled in this case.
+ */
+static bool is_avr_descriptor_current() {
+    return is_avr_descriptor_hash_received &&
+           avr_descriptor_hash == avr_link_crc16(hid_report_map, HID_REPORT_MAP_SIZE);
 }
 
-static int enable_usb() {
-    uint8_t payload = 0x01;
-    struct spi_transfer_spec spec = {&payload, sizeof(payload), NULL, 0};
-    return avr_transceive(0x09, &spec);
+/**
+ * @brief Upload report descriptor and enable USB, the latter is batched with the last chunk.
+ */
+static int send_report_descriptor_and_enable_usb() {
+    for (uint32_t offset = 0; offset < HID_REPORT_MAP_SIZE; offset += REPORT_DESCRIPTOR_CHUNK_SIZE) {
+        uint8_t frame[AVR_LINK_FRAME_MAX_SIZE];
+        struct {
+            uint8_t offset;
+            uint8_t data[REPORT_DESCRIPTOR_CHUNK_SIZE];
+        } chunk = {.offset = offset};
+        uint32_t chunk_size = MIN(REPORT_DESCRIPTOR_CHUNK_SIZE, HID_REPORT_MAP_SIZE - offset);
+        memcpy(chunk.data, hid_report_map + offset, chunk_size);
+
+        frame_start(frame);
+        avr_link_frame_add(frame, AVR_LINK_MSG_DESCRIPTOR, &chunk, 1 + chunk_size);
+        if (offset + chunk_size == HID_REPORT_MAP_SIZE) {
+            uint8_t enable = 1;
+            avr_link_frame_add(frame, AVR_LINK_MSG_ENABLE_USB, &enable, sizeof(enable));
+        }
+        // chunks are delivered in order, a lost one is resent along with the following ones
+        int err = send_frame(frame);
+        if (err) {
+            return err;
+        }
+    }
+    return 0;
 }
 
-static int send_report() {
+/**
+ * @brief Add pending report to the frame if the AVR can accept it, return true if added.
+ */
+static bool add_pending_report(uint8_t* frame) {
     struct {
         uint8_t report_id;
         struct hid_report report;
     } payload = {
         .report_id = HID_REPORT_ID,
-        .report = {.x_delta = 1}
     };
-    struct spi_transfer_spec spec = {&payload, sizeof(payload), NULL, 0};
-    return avr_transceive(0x0A, &spec);
+
+    // when the AVR queue fills up, reports are merged here instead, where button changes are kept apart
+    if (!(avr_status & AVR_LINK_STATUS_REPORT_QUEUE_READY)) {
+        return false;
+    }
+
+    k_mutex_lock(&report_mutex, K_FOREVER);
+    bool is_added = is_report_pending;
+    if (is_added) {
+        payload.report = pending_report;
+        is_report_pending = false;
+        k_condvar_broadcast(&report_sent_condvar);
+        avr_link_frame_add(frame, AVR_LINK_MSG_REPORT, &payload, sizeof(payload));
+    }
+    k_mutex_unlock(&report_mutex);
+    return is_added;
+}
+
+/**
+ * @brief Add DFU status to the frame if it was updated since last sent, return true if added.
+ */
+static bool add_dfu_status(uint8_t* frame) {
+    if (!is_dfu_status_pending) {
+        return false;
+    }
+    is_dfu_status_pending = false;
+    return avr_link_frame_add(frame, AVR_LINK_MSG_DFU_STATUS, &dfu_status, sizeof(dfu_status));
+}
+
+/**
+ * @brief Add remote wakeup request to the frame if a report was submitted while USB is suspended.
+ */
+static bool add_wakeup(uint8_t* frame) {
+    k_mutex_lock(&report_mutex, K_FOREVER);
+    bool is_added = is_wakeup_pending && avr_link_frame_add(frame, AVR_LINK_MSG_WAKEUP, NULL, 0);
+    is_wakeup_pending = false;
+    k_mutex_unlock(&report_mutex);
+    return is_added;
+}
+
+/**
+ * @brief Add the oldest queued reply to the frame if the AVR has a free slot for it, return true if added.
+ *
+ * The AVR status lags one frame behind, so if a reply was sent in the previous frame, it still occupies
+ * one of the slots reported free.
+ */
+static bool add_reply(uint8_t* frame, bool was_reply_sent) {
+    uint8_t free_slots = (avr_status & AVR_LINK_STATUS_REPLY_SLOTS_MASK) >> AVR_LINK_STATUS_REPLY_SLOTS_SHIFT;
+    struct app_reply reply;
+    if (free_slots <= was_reply_sent || k_msgq_peek(&reply_msgq, &reply)) {
+        return false;
+    }
+    // a reply that does not fit along with other messages waits for the next frame
+    if (!avr_link_frame_add(frame, AVR_LINK_MSG_APP_REPLY, reply.data, reply.size)) {
+        return false;
+    }
+    k_msgq_get(&reply_msgq, &reply, K_NO_WAIT);
+    return true;
 }
 
+/**
+ * @brief Serve the AVR until it's gone.
+ *
+ * The AVR asserts IRQ when its status changes (e.g. the report queue fills up or drains,
+ * or it has a message), in which case frames are exchanged to get the new status. Reports are sent
+ * as soon as they are submitted while the AVR queue has space, the AVR writes them to the endpoint
+ * as the host polls it. Firmware update chunks arrive the same way, and the status of each one is sent back
+ * in the next frame. Application replies are sent one per frame while the AVR has free slots for them.
+ * While the host has suspended USB, reports are not forwarded, the first one requests remote wakeup instead.
+ */
 static void avr_comm_loop() {
-    k_usleep(150);
-    send_report_descriptor();
-    k_usleep(150);
-    enable_usb();
-    do {
-        k_usleep(150);
-        send_report();
-        k_msleep(10);
-    } while (verify_avr_id(false) != 1);
+    if (is_avr_descriptor_current()) {
+        LOG_DBG("avr has current report descriptor");
+    } else if (send_report_descriptor_and_enable_usb()) {
+        return;
+    }
+
+    while (true) {
+        if (avr_link_tx_window_pending(&tx_window)) {
+            // frames lost on the way go first, so that messages keep their order
+            if (exchange_next()) {
+                break;
+            }
+            continue;
+        }
+
+        uint8_t frame[AVR_LINK_FRAME_MAX_SIZE];
+        frame_start(frame);
+
+        bool is_wakeup_added = add_wakeup(frame);
+        bool is_report_added = add_pending_report(frame);
+        bool is_dfu_status_added = add_dfu_status(frame);
+        bool is_reply_added = add_reply(frame, is_reply_unconfirmed);
+        // when more replies are queued, the status is refreshed even if it did not change to assert IRQ
+        bool is_status_needed = is_reply_unconfirmed && k_msgq_num_used_get(&reply_msgq);
+        if (!is_wakeup_added && !is_report_added && !is_dfu_status_added && !is_reply_added && !is_status_needed &&
+            !is_irq_asserted()) {
+            // sense mechanism is level-based, so the callback fires right away if IRQ is already asserted
+            gpio_set_edge_cb(IRQ_PIN, 1, avr_irq_cb);
+            if (k_sem_take(&wakeup_sem, K_MSEC(PRESENCE_CHECK_PERIOD_MS)) == 0) {
+                continue;
+            }
+        }
+        // items taken into the frame are kept in the window until the AVR acknowledges it,
+        // the exchange only fails when the AVR is gone (it loses power, handshake fails or frames are invalid)
+        avr_link_tx_window_push(&tx_window, frame);
+        if (exchange_next()) {
+            break;
+        }
+    }
+
+    gpio_unset_edge_cb(IRQ_PIN);
+    set_avr_status(0);
 }
 
 static int avr_communication_thread(void* p1, void* p2, void* p3) {
@@ -227,7 +646,7 @@ static int avr_communication_thread(void* p1, void* p2, void* p3) {
         }
         LOG_INF("detected avr");
         k_msleep(1);
-        if (verify_avr_id(true)) {
+        if (verify_avr_id()) {
             LOG_ERR("failed to verify device ID");
             // In this case we can't really set CS low, because this might trigger something in AVR
             // while talking to optical sensor. Best thing we can do is to wait until it releases IRQ,
@@ -236,6 +655,9 @@ static int avr_communication_thread(void* p1, void* p2, void* p3) {
                 k_msleep(100);
             }
         } else {
+            if (link_up_cb) {
+                link_up_cb();
+            }
             avr_comm_loop();
         }
         LOG_INF("avr gone");
@@ -0,0 +1,123 @@
+#include <stddef.h>
+#include <stdint.h>
+
+#include <zephyr/dfu/flash_img.h>
+#include <zephyr/dfu/mcuboot.h>
+#include <zephyr/init.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/reboot.h>
+
+#include "avr_link.h"
+#include "services/avr_comm.h"
+
+LOG_MODULE_REGISTER(dfu);
+
+// time for the final status to reach the host before rebooting into MCUboot
+#define REBOOT_DELAY_MS 500
+
+static struct flash_img_context flash_img;
+static struct avr_link_dfu_status status = {.state = AVR_LINK_DFU_IDLE};
+
+static void reboot_work_handler(struct k_work* work) {
+    sys_reboot(SYS_REBOOT_COLD);
+}
+
+K_WORK_DELAYABLE_DEFINE(reboot_work, reboot_work_handler);
+
+/**
+ * @brief Flush the image and request MCUboot to test it on next boot.
+ *
+ * The last chunk is padded by the host, so the image ends within it.
+ */
+static int finish_image(uint32_t image_size) {
+    if (!image_size || image_size > status.offset || status.offset - image_size >= AVR_LINK_DFU_CHUNK_DATA_SIZE) {
+        LOG_ERR("image size %u does not match %u bytes received", image_size, status.offset);
+        return -EINVAL;
+    }
+    int err = flash_img_buffered_write(&flash_img, NULL, 0, true);
+    if (err) {
+        LOG_ERR("failed to flush image: %d", err);
+        return err;
+    }
+    err = boot_request_upgrade(BOOT_UPGRADE_TEST);
+    if (err) {
+        LOG_ERR("failed to request upgrade: %d", err);
+    }
+    return err;
+}
+
+/**
+ * @brief Write a chunk to the secondary slot.
+ *
+ * Chunks are only accepted in order, so that the offset in status tells the host where to resume.
+ */
+static void process_dfu_chunk(const struct avr_link_dfu_chunk* chunk, struct avr_link_dfu_status* status_out) {
+    int err;
+
+    if (avr_link_crc16((const uint8_t*) chunk, offsetof(struct avr_link_dfu_chunk, crc)) != chunk->crc) {
+        LOG_WRN("invalid crc of chunk at %u", chunk->offset);
+    } else if (chunk->offset == 0) {
+        err = flash_img_init(&flash_img);
+        if (err) {
+            LOG_ERR("failed to open secondary slot: %d", err);
+        } else {
+            LOG_INF("update started");
+        }
+        status.state = err ? AVR_LINK_DFU_ERROR : AVR_LINK_DFU_RECEIVING;
+        status.offset = 0;
+    }
+
+    if (status.state == AVR_LINK_DFU_RECEIVING && chunk->offset == AVR_LINK_DFU_OFFSET_FINISH) {
+        err = finish_image(sys_get_le32(chunk->data));
+        status.state = err ? AVR_LINK_DFU_ERROR : AVR_LINK_DFU_DONE;
+        if (!err) {
+            LOG_INF("update received, rebooting");
+            k_work_schedule(&reboot_work, K_MSEC(REBOOT_DELAY_MS));
+        }
+    } else if (status.state == AVR_LINK_DFU_RECEIVING && chunk->offset == status.offset) {
+        // duplicates and chunks following a lost one are ignored, the host resends from the offset reported
+        err = flash_img_buffered_write(&flash_img, chunk->data, sizeof(chunk->data), false);
+        if (err) {
+            LOG_ERR("failed to write chunk at %u: %d", chunk->offset, err);
+            status.state = AVR_LINK_DFU_ERROR;
+        } else {
+            status.offset += sizeof(chunk->data);
+        }
+    }
+
+    *status_out = status;
+}
+
+/**
+ * @brief Keep the image being tested after an update, once it has proven it can be updated again.
+ *
+ * The AVR link is the only update path, an image that can't talk to the AVR is left unconfirmed,
+ * so that MCUboot reverts it on next reset.
+ */
+static void link_up_cb() {
+    if (boot_is_img_confirmed()) {
+        return;
+    }
+    int err = boot_write_img_confirmed();
+    if (err) {
+        LOG_ERR("failed to confirm image: %d", err);
+    } else {
+        LOG_INF("updated image confirmed");
+    }
+}
+
+static int dfu_init(const struct device* dev) {
+    ARG_UNUSED(dev);
+
+    if (!boot_is_img_confirmed()) {
+        LOG_INF("testing updated image, it's confirmed once the avr link is up");
+    }
+
+    avr_comm_set_dfu_chunk_cb(process_dfu_chunk);
+    avr_comm_set_link_up_cb(link_up_cb);
+    return 0;
+}
+
+SYS_INIT(dfu_init, APPLICATION, CONFIG_APP_DFU_INIT_PRIORITY);
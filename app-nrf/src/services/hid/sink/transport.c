@@ -3,18 +3,30 @@
 
 #include "hid_report_struct.h"
 #include "transport/bt/transport.h"
+#include "transport/usb/transport.h"
 
 LOG_MODULE_REGISTER(hid_sink_transport);
 
 void hid_sink_impl(struct hid_report* report) {
+    int err;
+
+    // wired connection takes precedence, it is paced by the host polling rate
+    if (usb_transport.available()) {
+        err = usb_transport.send(report);
+        if (err) {
+            LOG_WRN("usb send returned %d", err);
+        }
+        return;
+    }
+
     if (!bt_transport.available()) {
         // todo: block collector when the sink (transport)
         // is unavailable and reset sources when it becomes available
         return;
     }
-    int err = bt_transport.send(report);
+    // blocks while all notification buffers are in flight, so that motion accumulates in the sensor meanwhile
+    err = bt_transport.send(report);
     if (err) {
         LOG_WRN("send returned %d", err);
     }
-    k_sleep(K_MSEC(10));
 }
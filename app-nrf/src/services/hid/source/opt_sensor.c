@@ -8,6 +8,7 @@
 #include <zephyr/init.h>
 #include <zephyr/kernel.h>
 
+#include "drivers/adns7530.h"
 #include "platform/gpio.h"
 #include "services/hid/collector.h"
 #include "services/hid/source.h"
@@ -17,6 +18,28 @@
 static void hid_src_opt_sensor_report_filler(struct hid_report* report);
 HID_SOURCE_REGISTER(hid_src_opt_sensor, hid_src_opt_sensor_report_filler, APP_HID_SOURCE_OPT_SENSOR_PRIORITY);
 
+static bool sensor_lifted = false;
+
+static void hid_src_opt_sensor_lifted_poll(struct k_timer* timer) {
+    hid_collector_notify_data_available(hid_src_opt_sensor);
+}
+
+K_TIMER_DEFINE(lifted_poll_timer, hid_src_opt_sensor_lifted_poll, NULL);
+
+/**
+ * @brief Request sensor data to be fetched.
+ *
+ * While the sensor is lifted, MOT is mostly triggered by noise and would cause a stream of wakeups.
+ * In this case the request is delayed (and merged with other requests) until the poll timer expires.
+ */
+static void hid_src_opt_sensor_request_fetch() {
+    if (!sensor_lifted) {
+        hid_collector_notify_data_available(hid_src_opt_sensor);
+    } else if (!k_timer_remaining_get(&lifted_poll_timer)) {
+        k_timer_start(&lifted_poll_timer, K_MSEC(CONFIG_APP_HID_SOURCE_OPT_SENSOR_LIFTED_POLL_PERIOD), K_NO_WAIT);
+    }
+}
+
 static void hid_src_opt_sensor_report_filler(struct hid_report* report) {
     const struct device* sensor = DEVICE_DT_GET(DT_NODELABEL(optical_sensor));
     struct sensor_value value;
@@ -26,19 +49,21 @@ static void hid_src_opt_sensor_report_filler(struct hid_report* report) {
     report->x_delta = value.val1;
     sensor_channel_get(sensor, SENSOR_CHAN_POS_DY, &value);
     report->y_delta = -value.val1;
+    sensor_channel_get(sensor, ADNS7530_CHAN_LIFTED, &value);
+    sensor_lifted = value.val1;
 
     // normally motion detect pin is put high (inactive) in the middle of SPI transaction,
     // to be exact after reading the first bit of the second byte from motion burst register
     // sometimes however it is still held low after transaction, so request another one
     if (!nrf_gpio_pin_read(MOT_PIN)) {
-        hid_collector_notify_data_available(hid_src_opt_sensor);
+        hid_src_opt_sensor_request_fetch();
     }
 }
 
 static void hid_src_opt_sensor_gpio_cb(uint32_t pin, bool new_value) {
     // motion detect pin is active low
     if (!new_value) {
-        hid_collector_notify_data_available(hid_src_opt_sensor);
+        hid_src_opt_sensor_request_fetch();
     }
     gpio_set_edge_cb(pin, new_value, hid_src_opt_sensor_gpio_cb);
 }
@@ -0,0 +1,82 @@
+/* Optical sensor power management service. Keeps the sensor in shutdown while there is no
+ * host to send the reports to (neither via BT nor via USB), and brings it back when the host connects.
+ *
+ * Availability changes are reported from BT stack and AVR communication thread contexts,
+ * while suspending and resuming involves SPI transfers and sleeps, so the actual transition
+ * is done in a work item. Resume waits for the sensor reset to complete, so the work runs in
+ * a dedicated queue rather than blocking the system work queue (and BT host work in it).
+ */
+
+#include <stdbool.h>
+
+#include <zephyr/device.h>
+#include <zephyr/devicetree.h>
+#include <zephyr/init.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/pm/device.h>
+
+#include "services/hid/collector.h"
+#include "transport/bt/conn.h"
+#include "transport/usb/transport.h"
+
+LOG_MODULE_REGISTER(sensor_power);
+
+extern const struct hid_source* hid_src_opt_sensor;
+
+static bool sensor_active = true;
+
+K_THREAD_STACK_DEFINE(sensor_power_stack, CONFIG_APP_SENSOR_POWER_STACK_SIZE);
+static struct k_work_q sensor_power_work_q;
+
+static void sensor_power_update(struct k_work* work) {
+    const struct device* sensor = DEVICE_DT_GET(DT_NODELABEL(optical_sensor));
+    bool should_be_active = transport_bt_available() || transport_usb_available();
+    int err;
+
+    if (should_be_active == sensor_active) {
+        return;
+    }
+
+    if (should_be_active) {
+        err = pm_device_action_run(sensor, PM_DEVICE_ACTION_RESUME);
+        if (!err) {
+            hid_collector_set_source_enabled(hid_src_opt_sensor, true);
+        }
+    } else {
+        // disable the source first so that the collector does not fetch samples from a sensor in shutdown
+        hid_collector_set_source_enabled(hid_src_opt_sensor, false);
+        err = pm_device_action_run(sensor, PM_DEVICE_ACTION_SUSPEND);
+    }
+
+    if (err) {
+        LOG_ERR("failed to %s sensor: %d", should_be_active ? "resume" : "suspend", err);
+        return;
+    }
+
+    sensor_active = should_be_active;
+    LOG_INF("sensor %s", sensor_active ? "resumed" : "suspended");
+}
+
+K_WORK_DEFINE(sensor_power_work, sensor_power_update);
+
+static void sensor_power_availability_cb(bool available) {
+    k_work_submit_to_queue(&sensor_power_work_q, &sensor_power_work);
+}
+
+static int sensor_power_init(const struct device* dev) {
+    ARG_UNUSED(dev);
+
+    const struct k_work_queue_config work_q_cfg = {.name = "sensor_power"};
+    k_work_queue_start(&sensor_power_work_q, sensor_power_stack, K_THREAD_STACK_SIZEOF(sensor_power_stack),
+                       CONFIG_APP_SENSOR_POWER_PRIORITY, &work_q_cfg);
+
+    transport_bt_set_availability_cb(sensor_power_availability_cb);
+    transport_usb_set_availability_cb(sensor_power_availability_cb);
+    // there is no host connected right after boot, suspend the sensor until it connects
+    k_work_submit_to_queue(&sensor_power_work_q, &sensor_power_work);
+
+    return 0;
+}
+
+SYS_INIT(sensor_power_init, APPLICATION, CONFIG_APP_SENSOR_POWER_INIT_PRIORITY);
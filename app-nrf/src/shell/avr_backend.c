@@ -0,0 +1,131 @@
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <zephyr/init.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/shell/shell.h>
+#include <zephyr/sys/ring_buffer.h>
+
+#include "avr_link.h"
+#include "services/avr_comm.h"
+
+LOG_MODULE_REGISTER(shell_avr);
+
+// Shell backend tunneled through the application channel of the AVR. Commands written by USB host arrive
+// as AVR messages, the output is sent back as replies. This gives access to settings, statistics and logs
+// without RTT (see hidcli shell).
+
+// printed when a command is complete, the host tool reads the output up to it
+#define PROMPT "usb:~$ "
+// size of the buffer for commands written by the host
+#define RX_BUFFER_SIZE 64
+// how long the output waits for the host to read previous replies
+#define WRITE_TIMEOUT_MS 100
+#define LOG_QUEUE_SIZE 512
+#define LOG_QUEUE_TIMEOUT_MS 100
+
+struct shell_avr {
+    shell_transport_handler_t handler;
+    void* context;
+};
+
+static struct shell_avr shell_avr_ctx;
+
+RING_BUF_DECLARE(rx_ringbuf, RX_BUFFER_SIZE);
+static struct k_spinlock rx_lock;
+
+// cleared when the output times out, so that it's dropped right away until the host reads again
+static bool is_host_reading = true;
+
+static void message_cb(const uint8_t* data, uint8_t size) {
+    k_spinlock_key_t key = k_spin_lock(&rx_lock);
+    uint32_t num_put = ring_buf_put(&rx_ringbuf, data, size);
+    k_spin_unlock(&rx_lock, key);
+
+    if (num_put < size) {
+        LOG_WRN("dropped %u bytes of input", size - num_put);
+    }
+    is_host_reading = true;
+    if (shell_avr_ctx.handler) {
+        shell_avr_ctx.handler(SHELL_TRANSPORT_EVT_RX_RDY, shell_avr_ctx.context);
+    }
+}
+
+static int transport_init(const struct shell_transport* transport,
+                          const void* config,
+                          shell_transport_handler_t evt_handler,
+                          void* context) {
+    struct shell_avr* ctx = transport->ctx;
+    ctx->handler = evt_handler;
+    ctx->context = context;
+    avr_comm_set_message_cb(message_cb);
+    return 0;
+}
+
+static int transport_uninit(const struct shell_transport* transport) {
+    avr_comm_set_message_cb(NULL);
+    return 0;
+}
+
+static int transport_enable(const struct shell_transport* transport, bool blocking_tx) {
+    return 0;
+}
+
+/**
+ * @brief Send output to the host in replies.
+ *
+ * The output is dropped while the host does not read it (e.g. no USB or no host tool running),
+ * so that the shell and logging are not stalled.
+ */
+static int transport_write(const struct shell_transport* transport, const void* data, size_t length, size_t* cnt) {
+    struct shell_avr* ctx = transport->ctx;
+    const uint8_t* bytes = data;
+
+    for (size_t offset = 0; offset < length && is_host_reading; offset += AVR_LINK_APP_MESSAGE_MAX_SIZE) {
+        uint8_t size = MIN(length - offset, AVR_LINK_APP_MESSAGE_MAX_SIZE);
+        if (avr_comm_send_reply(bytes + offset, size, K_MSEC(WRITE_TIMEOUT_MS))) {
+            is_host_reading = false;
+        }
+    }
+
+    *cnt = length;
+    ctx->handler(SHELL_TRANSPORT_EVT_TX_RDY, ctx->context);
+    return 0;
+}
+
+static int transport_read(const struct shell_transport* transport, void* data, size_t length, size_t* cnt) {
+    k_spinlock_key_t key = k_spin_lock(&rx_lock);
+    *cnt = ring_buf_get(&rx_ringbuf, data, length);
+    k_spin_unlock(&rx_lock, key);
+    return 0;
+}
+
+static const struct shell_transport_api shell_avr_transport_api = {
+    .init = transport_init,
+    .uninit = transport_uninit,
+    .enable = transport_enable,
+    .write = transport_write,
+    .read = transport_read,
+};
+
+static struct shell_transport shell_avr_transport = {
+    .api = &shell_avr_transport_api,
+    .ctx = &shell_avr_ctx,
+};
+
+SHELL_DEFINE(shell_avr, PROMPT, &shell_avr_transport, LOG_QUEUE_SIZE, LOG_QUEUE_TIMEOUT_MS, SHELL_FLAG_OLF_CRLF);
+
+static int shell_avr_init(const struct device* dev) {
+    ARG_UNUSED(dev);
+
+    // the output is parsed by the host tool, so leave out terminal features
+    struct shell_backend_config_flags cfg_flags = SHELL_DEFAULT_BACKEND_CONFIG_FLAGS;
+    cfg_flags.echo = 0;
+    cfg_flags.use_colors = 0;
+    cfg_flags.use_vt100 = 0;
+
+    return shell_init(&shell_avr, NULL, cfg_flags, true, CONFIG_APP_SHELL_BACKEND_AVR_LOG_LEVEL);
+}
+
+SYS_INIT(shell_avr_init, APPLICATION, CONFIG_APP_SHELL_BACKEND_AVR_INIT_PRIORITY);
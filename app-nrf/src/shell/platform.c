@@ -7,6 +7,7 @@
 #include "platform/clock_suppl.h"
 #include "platform/pwm.h"
 #include "platform/shutdown.h"
+#include "platform/spi.h"
 
 static int cmd_shutdown(const struct shell *shell, size_t argc, char **argv) {
     shutdown();
@@ -56,6 +57,59 @@ static int cmd_adc(const struct shell *shell, size_t argc, char **argv) {
     return 0;
 }
 
+static void print_spi_hist(const struct shell *shell, const char* name, const uint32_t hist[SPI_STATS_HIST_NUM_BUCKETS]) {
+    shell_fprintf(shell, SHELL_NORMAL, "  %s hist (2^i us):", name);
+    for (int i = 0; i < SPI_STATS_HIST_NUM_BUCKETS; i++) {
+        shell_fprintf(shell, SHELL_NORMAL, " %u", hist[i]);
+    }
+    shell_fprintf(shell, SHELL_NORMAL, "\n");
+}
+
+static void print_spi_device_stats(const char* name, const struct spi_device_counters* counters, void* user_data) {
+    const struct shell *shell = user_data;
+    shell_print(shell, "%s:", name);
+    shell_print(shell, "  transactions: %u, errors: %u, bytes: %u",
+        counters->num_transactions, counters->errors, counters->bytes);
+    shell_print(shell, "  reconfigurations: %u, clk enable stalls: %u, clk disables: %u",
+        counters->reconfigurations, counters->clk_enable_stalls, counters->clk_disables);
+    shell_print(shell, "  max wait: %u us", counters->wait_max_us);
+    print_spi_hist(shell, "wait", counters->wait_hist);
+    print_spi_hist(shell, "transfer", counters->transfer_hist);
+}
+
+static int cmd_spi_stats(const struct shell *shell, size_t argc, char **argv) {
+    struct spi_queue_stats stats;
+    spi_queue_stats_get(&stats);
+
+    int64_t period_us = (k_uptime_get() - stats.since_ms) * 1000;
+    shell_print(shell, "transactions: %u", stats.num_transactions);
+    shell_print(shell, "utilisation: %u.%02u%%",
+        (uint32_t) (stats.busy_us * 100 / MAX(period_us, 1)),
+        (uint32_t) (stats.busy_us * 10000 / MAX(period_us, 1) % 100));
+    shell_print(shell, "latency avg: %u us, max: %u us",
+        (uint32_t) (stats.latency_sum_us / MAX(stats.num_transactions, 1)), stats.latency_max_us);
+    shell_print(shell, "max wait normal: %u us, high: %u us",
+        stats.wait_max_us[SPI_PRIORITY_NORMAL], stats.wait_max_us[SPI_PRIORITY_HIGH]);
+    shell_print(shell, "locks: %u, wait avg: %u us, max: %u us", stats.num_locks,
+        (uint32_t) (stats.lock_wait_sum_us / MAX(stats.num_locks, 1)), stats.lock_wait_max_us);
+
+    spi_device_stats_foreach(print_spi_device_stats, (void*) shell);
+
+    return 0;
+}
+
+static int cmd_spi_reset(const struct shell *shell, size_t argc, char **argv) {
+    spi_queue_stats_reset();
+
+    return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(platform_cmdset_spi,
+    SHELL_CMD(stats, NULL, "print SPI statistics", cmd_spi_stats),
+    SHELL_CMD(reset, NULL, "reset SPI statistics", cmd_spi_reset),
+    SHELL_SUBCMD_SET_END
+);
+
 SHELL_STATIC_SUBCMD_SET_CREATE(platform_cmdset_pwm,
     SHELL_CMD_ARG(sched, NULL, "pwm red green time_ms, duty cycle 0-99", cmd_pwm_sched, 4, 0),
     SHELL_CMD(done, NULL, "check whether sequence is done playing", cmd_pwm_done),
@@ -67,6 +121,7 @@ SHELL_STATIC_SUBCMD_SET_CREATE(platform_cmdset,
     SHELL_CMD_ARG(clock_suppl, NULL, "Enable/disable AVR clock supply", cmd_clock_suppl, 2, 0),
     SHELL_CMD(pwm, &platform_cmdset_pwm, "pwm commands", NULL),
     SHELL_CMD(adc, NULL, "Perform ADC measurement", cmd_adc),
+    SHELL_CMD(spi, &platform_cmdset_spi, "spi commands", NULL),
     SHELL_SUBCMD_SET_END
 );
 
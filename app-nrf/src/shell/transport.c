@@ -0,0 +1,165 @@
+#include <stdlib.h>
+
+#include <zephyr/bluetooth/addr.h>
+#include <zephyr/bluetooth/conn.h>
+#include <zephyr/bluetooth/gap.h>
+#include <zephyr/shell/shell.h>
+
+#include "hid_report_struct.h"
+#include "transport/bt/airtime.h"
+#include "transport/bt/conn.h"
+#include "transport/bt/hids.h"
+#include "transport/bt/hosts.h"
+#include "transport/bt/reconnect.h"
+
+static int cmd_bt_stats(const struct shell *shell, size_t argc, char **argv) {
+    struct transport_bt_send_stats stats;
+    transport_bt_send_stats_get(&stats);
+
+    shell_print(shell, "notifications sent: %u, completed: %u", stats.sent, stats.completed);
+    shell_print(shell, "in flight: %u (max %u, limit %u)",
+        stats.in_flight, stats.max_in_flight, CONFIG_APP_BT_HIDS_MAX_IN_FLIGHT);
+    shell_print(shell, "reports coalesced: %u, dropped: %u, pending: %s",
+        stats.coalesced, stats.drops, stats.is_report_pending ? "yes" : "no");
+
+    return 0;
+}
+
+static int cmd_bt_reset(const struct shell *shell, size_t argc, char **argv) {
+    transport_bt_send_stats_reset();
+
+    return 0;
+}
+
+static void print_airtime(const struct shell *shell, uint8_t phy, uint32_t interval_us, bool is_current) {
+    uint8_t payload_size = AIRTIME_NOTIFICATION_OVERHEAD + sizeof(struct hid_report);
+    uint32_t event_len_us = interval_us - AIRTIME_T_IFS_US;
+#ifdef CONFIG_BT_CTLR_SDC_MAX_CONN_EVENT_LEN_DEFAULT
+    event_len_us = MIN(event_len_us, CONFIG_BT_CTLR_SDC_MAX_CONN_EVENT_LEN_DEFAULT);
+#endif
+
+    shell_print(shell, "%s PHY%s: %u us per report, %u us for two, up to %u reports per interval",
+        phy == BT_GAP_LE_PHY_2M ? "2M" : "1M", is_current ? " (in use)" : "",
+        airtime_event_us(phy, payload_size, 1), airtime_event_us(phy, payload_size, 2),
+        airtime_pdus_per_event(phy, payload_size, event_len_us));
+}
+
+static int cmd_bt_airtime(const struct shell *shell, size_t argc, char **argv) {
+    uint16_t interval = CONFIG_APP_BT_CONN_ACTIVE_INT_MIN;
+    uint8_t phy = 0;
+
+    struct bt_conn_info info;
+    if (current_client && !bt_conn_get_info(current_client, &info)) {
+        interval = info.le.interval;
+        phy = info.le.phy->tx_phy;
+    }
+
+    shell_print(shell, "radio-on time estimate, connection interval %u us:", interval * 1250);
+    print_airtime(shell, BT_GAP_LE_PHY_1M, interval * 1250, phy == BT_GAP_LE_PHY_1M);
+    print_airtime(shell, BT_GAP_LE_PHY_2M, interval * 1250, phy == BT_GAP_LE_PHY_2M);
+
+    return 0;
+}
+
+static int cmd_bt_reconnect(const struct shell *shell, size_t argc, char **argv) {
+    static const char* step_names[TRANSPORT_BT_RECONNECT_NUM_STEPS] = {
+        [TRANSPORT_BT_RECONNECT_ENABLED] = "enabled",
+        [TRANSPORT_BT_RECONNECT_DISCONNECTED] = "disconnected",
+        [TRANSPORT_BT_RECONNECT_ADVERTISING] = "advertising",
+        [TRANSPORT_BT_RECONNECT_CONNECTED] = "connected",
+        [TRANSPORT_BT_RECONNECT_SECURED] = "secured",
+        [TRANSPORT_BT_RECONNECT_FIRST_REPORT] = "first report",
+    };
+
+    static const char* cause_names[] = {
+        [TRANSPORT_BT_RECONNECT_BOOT] = "boot",
+        [TRANSPORT_BT_RECONNECT_DISCONNECTION] = "disconnection",
+        [TRANSPORT_BT_RECONNECT_SWITCH] = "host switch",
+    };
+
+    struct transport_bt_reconnect_stats stats;
+    transport_bt_reconnect_stats_get(&stats);
+
+    shell_print(shell, "since %s at %lld ms:", cause_names[stats.cause], stats.start_ms);
+    for (int i = 0; i < TRANSPORT_BT_RECONNECT_NUM_STEPS; i++) {
+        // these steps only apply to boot and switch respectively
+        bool is_applicable =
+            (i != TRANSPORT_BT_RECONNECT_ENABLED || stats.cause == TRANSPORT_BT_RECONNECT_BOOT) &&
+            (i != TRANSPORT_BT_RECONNECT_DISCONNECTED || stats.cause == TRANSPORT_BT_RECONNECT_SWITCH);
+        if (stats.step_ms[i] != -1) {
+            shell_print(shell, "  %s: %lld ms", step_names[i], stats.step_ms[i]);
+        } else if (is_applicable) {
+            shell_print(shell, "  %s: -", step_names[i]);
+        }
+    }
+
+    return 0;
+}
+
+static int cmd_bt_hosts_list(const struct shell *shell, size_t argc, char **argv) {
+    for (uint8_t slot = 0; slot < TRANSPORT_BT_HOSTS_NUM; slot++) {
+        struct transport_bt_host host;
+        transport_bt_hosts_get(slot, &host);
+
+        char addr_str[BT_ADDR_LE_STR_LEN] = "none";
+        if (bt_addr_le_cmp(&host.addr, BT_ADDR_LE_ANY)) {
+            bt_addr_le_to_str(&host.addr, addr_str, sizeof(addr_str));
+        }
+        shell_print(shell, "%c %u: %s, %u cpi, active interval %u-%u (x1.25 ms)",
+            slot == transport_bt_hosts_current() ? '*' : ' ', slot, addr_str,
+            host.cpi, host.active_interval_min, host.active_interval_max);
+    }
+
+    return 0;
+}
+
+static int print_hosts_result(const struct shell *shell, int rv) {
+    if (rv) {
+        shell_error(shell, "invalid arguments");
+        return -ENOEXEC;
+    }
+    return 0;
+}
+
+static int cmd_bt_hosts_select(const struct shell *shell, size_t argc, char **argv) {
+    return print_hosts_result(shell, transport_bt_hosts_select(strtol(argv[1], NULL, 0)));
+}
+
+static int cmd_bt_hosts_cpi(const struct shell *shell, size_t argc, char **argv) {
+    return print_hosts_result(shell, transport_bt_hosts_set_cpi(strtol(argv[1], NULL, 0), strtol(argv[2], NULL, 0)));
+}
+
+static int cmd_bt_hosts_interval(const struct shell *shell, size_t argc, char **argv) {
+    return print_hosts_result(shell, transport_bt_hosts_set_active_interval(
+        strtol(argv[1], NULL, 0), strtol(argv[2], NULL, 0), strtol(argv[3], NULL, 0)));
+}
+
+static int cmd_bt_hosts_forget(const struct shell *shell, size_t argc, char **argv) {
+    return print_hosts_result(shell, transport_bt_hosts_forget(strtol(argv[1], NULL, 0)));
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(transport_cmdset_bt_hosts,
+    SHELL_CMD(list, NULL, "list host slots", cmd_bt_hosts_list),
+    SHELL_CMD_ARG(select, NULL, "switch to slot N", cmd_bt_hosts_select, 2, 0),
+    SHELL_CMD_ARG(cpi, NULL, "set sensor resolution of slot N: 400, 800, 1200 or 1600", cmd_bt_hosts_cpi, 3, 0),
+    SHELL_CMD_ARG(interval, NULL, "set active connection interval of slot N: MIN MAX (x1.25 ms)",
+        cmd_bt_hosts_interval, 4, 0),
+    SHELL_CMD_ARG(forget, NULL, "remove host of slot N and its bond", cmd_bt_hosts_forget, 2, 0),
+    SHELL_SUBCMD_SET_END
+);
+
+SHELL_STATIC_SUBCMD_SET_CREATE(transport_cmdset_bt,
+    SHELL_CMD(stats, NULL, "print notification statistics", cmd_bt_stats),
+    SHELL_CMD(reset, NULL, "reset notification statistics", cmd_bt_reset),
+    SHELL_CMD(airtime, NULL, "print radio-on time per report", cmd_bt_airtime),
+    SHELL_CMD(reconnect, NULL, "print time taken by the last reconnection", cmd_bt_reconnect),
+    SHELL_CMD(hosts, &transport_cmdset_bt_hosts, "host slots", NULL),
+    SHELL_SUBCMD_SET_END
+);
+
+SHELL_STATIC_SUBCMD_SET_CREATE(transport_cmdset,
+    SHELL_CMD(bt, &transport_cmdset_bt, "bt commands", NULL),
+    SHELL_SUBCMD_SET_END
+);
+
+SHELL_CMD_REGISTER(transport, &transport_cmdset, "Transport information", NULL);
@@ -10,6 +10,9 @@
 #include <zephyr/bluetooth/services/hrs.h>
 #include <bluetooth/services/nus.h>
 
+#include "transport/bt/hosts.h"
+#include "transport/bt/reconnect.h"
+
 LOG_MODULE_DECLARE(transport_bt);
 
 static bool public_adv_requested = false;
@@ -38,33 +41,22 @@ static const struct bt_data scan_data[] = {
  */
 K_MSGQ_DEFINE(bonds_queue, sizeof(bt_addr_le_t), CONFIG_BT_MAX_PAIRED, 4);
 
-/**
- * @brief Puts bond (bound device) address to the DAAQ.
- */
-static void put_bond_to_queue(const struct bt_bond_info *info, void *user_data) {
-    ARG_UNUSED(user_data);
-
-    // Do not put address of the already connected client
-    // Only makes sense when multiple devices can be connected simultaneously,
-    // because otherwise advertising will not be started when client is connected.
-    // if (current_client) {
-    //     if (!bt_addr_le_cmp(&info->addr, bt_conn_get_dst(current_client))) {
-    //         return;
-    //     }
-    // }
-
-    k_msgq_put(&bonds_queue, &info->addr, K_NO_WAIT);
-}
-
 void transport_bt_adv_init(bool public_adv) {
+    bt_addr_le_t addr;
+
     public_adv_requested = public_adv;
     k_msgq_purge(&bonds_queue);
     if (public_adv) {
         LOG_INF("init undir adv");
         k_msgq_put(&bonds_queue, BT_ADDR_LE_ANY, K_NO_WAIT);
-    } else {
+    } else if (transport_bt_hosts_current_addr(&addr)) {
+        // only the host of the current slot, other hosts are selected by switching slots
         LOG_INF("init dir adv");
-        bt_foreach_bond(BT_ID_DEFAULT, put_bond_to_queue, NULL);
+        k_msgq_put(&bonds_queue, &addr, K_NO_WAIT);
+    } else {
+        // let a new host pair into the empty slot
+        LOG_INF("init undir adv, slot %u is empty", transport_bt_hosts_current());
+        k_msgq_put(&bonds_queue, BT_ADDR_LE_ANY, K_NO_WAIT);
     }
 }
 
@@ -82,6 +74,7 @@ static void advertising_run(struct k_work *work) {
     char addr_str[BT_ADDR_LE_STR_LEN];
     bt_addr_le_t addr;
     struct bt_le_adv_param adv_param;
+    int rv;
 
     if (k_msgq_get(&bonds_queue, &addr, K_NO_WAIT)) {
         // the queue is empty, nothing to do
@@ -92,13 +85,20 @@ static void advertising_run(struct k_work *work) {
         // not a BT_ADDR_LE_ANY, start directed advertising
         bt_addr_le_to_str(&addr, addr_str, sizeof(addr_str));
         LOG_INF("run dir adv to %s", addr_str);
+        // high duty cycle, so that the host reconnects as fast as it scans
         adv_param = *BT_LE_ADV_CONN_DIR(&addr);
-        bt_le_adv_start(&adv_param, NULL, 0, NULL, 0);
+        rv = bt_le_adv_start(&adv_param, NULL, 0, NULL, 0);
     } else {
         LOG_INF("run undir adv");
         adv_param = *BT_LE_ADV_CONN;
         adv_param.options |= BT_LE_ADV_OPT_ONE_TIME;
-        bt_le_adv_start(&adv_param, adv_data, ARRAY_SIZE(adv_data), scan_data, ARRAY_SIZE(scan_data));
+        rv = bt_le_adv_start(&adv_param, adv_data, ARRAY_SIZE(adv_data), scan_data, ARRAY_SIZE(scan_data));
+    }
+
+    if (rv) {
+        LOG_WRN("failed to start advertising: %d", rv);
+    } else {
+        transport_bt_reconnect_mark(TRANSPORT_BT_RECONNECT_ADVERTISING);
     }
 }
 
@@ -0,0 +1,30 @@
+#include "transport/bt/airtime.h"
+
+#include <zephyr/bluetooth/gap.h>
+
+// access address, LL header and CRC, preamble is PHY-dependent
+#define PDU_OVERHEAD (4 + 2 + 3)
+#define MIC_SIZE     4
+
+uint32_t airtime_pdu_us(uint8_t phy, uint8_t payload_size, bool encrypted) {
+    uint32_t size = PDU_OVERHEAD + payload_size + (encrypted && payload_size ? MIC_SIZE : 0);
+    // 1 byte preamble at 8 us per byte, or 2 bytes at 4 us per byte
+    return phy == BT_GAP_LE_PHY_2M ? (size + 2) * 4 : (size + 1) * 8;
+}
+
+uint32_t airtime_event_us(uint8_t phy, uint8_t payload_size, uint8_t num_pdus) {
+    if (!num_pdus) {
+        return 0;
+    }
+    // each data PDU is preceded by a central packet, all separated by T_IFS
+    uint32_t exchange_us = airtime_pdu_us(phy, 0, true) + AIRTIME_T_IFS_US + airtime_pdu_us(phy, payload_size, true);
+    return num_pdus * exchange_us + (num_pdus - 1) * AIRTIME_T_IFS_US;
+}
+
+uint32_t airtime_pdus_per_event(uint8_t phy, uint8_t payload_size, uint32_t event_len_us) {
+    uint32_t exchange_us = airtime_event_us(phy, payload_size, 1);
+    if (event_len_us < exchange_us) {
+        return 0;
+    }
+    return 1 + (event_len_us - exchange_us) / (exchange_us + AIRTIME_T_IFS_US);
+}
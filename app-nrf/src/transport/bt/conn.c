@@ -6,13 +6,18 @@
 #include <zephyr/logging/log.h>
 
 #include "transport/bt/adv.h"
+#include "transport/bt/conn_params.h"
 #include "transport/bt/hids.h"
+#include "transport/bt/hosts.h"
+#include "transport/bt/reconnect.h"
 
 LOG_MODULE_DECLARE(transport_bt);
 
 struct bt_conn *current_client = NULL;
 bt_security_t security_level = BT_SECURITY_L1;
 
+static transport_bt_availability_cb availability_cb = NULL;
+
 int transport_bt_available() {
     return current_client != NULL && (
         security_level == BT_SECURITY_L2 ||
@@ -20,6 +25,17 @@ int transport_bt_available() {
         security_level == BT_SECURITY_L4);
 }
 
+void transport_bt_set_availability_cb(transport_bt_availability_cb callback) {
+    availability_cb = callback;
+}
+
+static inline void notify_availability_change(bool was_available) {
+    bool available = transport_bt_available();
+    if (availability_cb && available != was_available) {
+        availability_cb(available);
+    }
+}
+
 static void bt_connected_callback(struct bt_conn *conn, uint8_t err) {
     if (err) {
         if (err == BT_HCI_ERR_ADV_TIMEOUT) {
@@ -31,21 +47,41 @@ static void bt_connected_callback(struct bt_conn *conn, uint8_t err) {
         return;
     }
 
+    if (!transport_bt_hosts_accepts(bt_conn_get_dst(conn))) {
+        LOG_INF("host of another slot connected, disconnecting");
+        bt_conn_disconnect(conn, BT_HCI_ERR_REMOTE_USER_TERM_CONN);
+        return;
+    }
+
     if (!(current_client = bt_conn_ref(conn))) {
         return;
     }
+    transport_bt_reconnect_mark(TRANSPORT_BT_RECONNECT_CONNECTED);
 
     transport_bt_hids_connected(conn);
+    transport_bt_conn_params_connected(conn);
+
+    // a report takes about 30% less radio-on time on 2M PHY (see airtime.h),
+    // the controllers stay on 1M if the central does not support it
+    int rv = bt_conn_le_phy_update(conn, BT_CONN_LE_PHY_PARAM_2M);
+    if (rv) {
+        LOG_WRN("failed to request 2M PHY: %d", rv);
+    }
 }
 
 static void bt_disconnected_callback(struct bt_conn *conn, uint8_t reason) {
     if (conn != current_client) {
-        // does it mean advertising should be restarted?
-        LOG_WRN("unknown client disconnected, reason %d", reason);
+        // e.g. a host of another slot rejected on connection, advertising has to be restarted
+        LOG_INF("unknown client disconnected, reason %d", reason);
+        transport_bt_adv_init(transport_bt_adv_was_public_adv_requested());
+        transport_bt_adv_next();
         return;
     }
 
+    bool was_available = transport_bt_available();
+    transport_bt_reconnect_start(TRANSPORT_BT_RECONNECT_DISCONNECTION);
     transport_bt_hids_disconnected(conn);
+    transport_bt_conn_params_disconnected(conn);
 
     // if public advertising was previously requested, but current connection
     // did not reach to meet "transport available" condition, restart public advertising
@@ -55,6 +91,8 @@ static void bt_disconnected_callback(struct bt_conn *conn, uint8_t reason) {
     bt_conn_unref(current_client);
     current_client = NULL;
     security_level = BT_SECURITY_L1;
+
+    notify_availability_change(was_available);
 }
 
 static void bt_identity_resolved_callback(struct bt_conn *conn, const bt_addr_le_t *rpa, const bt_addr_le_t *identity) {
@@ -70,8 +108,23 @@ static void bt_security_changed_callback(struct bt_conn *conn, bt_security_t lev
         return;
     }
 
+    bool was_available = transport_bt_available();
     security_level = level;
     LOG_INF("security changed: level %d, err %d", level, err);
+    if (transport_bt_available()) {
+        transport_bt_hosts_secured(conn);
+        transport_bt_reconnect_mark(TRANSPORT_BT_RECONNECT_SECURED);
+    }
+
+    notify_availability_change(was_available);
+}
+
+static void bt_le_param_updated_callback(struct bt_conn *conn, uint16_t interval, uint16_t latency, uint16_t timeout) {
+    transport_bt_conn_params_updated(conn, interval, latency, timeout);
+}
+
+static void bt_le_phy_updated_callback(struct bt_conn *conn, struct bt_conn_le_phy_info *param) {
+    LOG_INF("PHY updated: tx %u, rx %u", param->tx_phy, param->rx_phy);
 }
 
 static struct bt_conn_cb conn_callbacks = {
@@ -79,6 +132,8 @@ static struct bt_conn_cb conn_callbacks = {
     .disconnected = bt_disconnected_callback,
     .identity_resolved = bt_identity_resolved_callback,
     .security_changed = bt_security_changed_callback,
+    .le_param_updated = bt_le_param_updated_callback,
+    .le_phy_updated = bt_le_phy_updated_callback,
 };
 
 int transport_bt_conn_init() {
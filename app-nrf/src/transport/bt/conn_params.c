@@ -0,0 +1,113 @@
+#include "transport/bt/conn_params.h"
+
+#include <errno.h>
+
+#include <zephyr/bluetooth/conn.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_DECLARE(transport_bt);
+
+static struct bt_conn* conn_params_conn = NULL;
+static struct conn_params_policy policy;
+static struct k_spinlock policy_lock;
+
+static const char* profile_name(enum conn_params_profile profile) {
+    switch (profile) {
+        case CONN_PARAMS_ACTIVE: return "active";
+        case CONN_PARAMS_IDLE: return "idle";
+        default: return "none";
+    }
+}
+
+static void evaluate_work_handler(struct k_work* work);
+
+K_WORK_DELAYABLE_DEFINE(evaluate_work, evaluate_work_handler);
+
+static void evaluate_work_handler(struct k_work* work) {
+    int64_t now_ms = k_uptime_get();
+    int64_t next_eval_ms;
+
+    struct bt_le_conn_param param;
+
+    k_spinlock_key_t key = k_spin_lock(&policy_lock);
+    struct bt_conn* conn = conn_params_conn;
+    enum conn_params_profile profile = conn ? conn_params_policy_evaluate(&policy, now_ms, &next_eval_ms)
+                                            : CONN_PARAMS_NONE;
+    if (profile != CONN_PARAMS_NONE) {
+        param = *conn_params_profile_get(profile);
+    }
+    k_spin_unlock(&policy_lock, key);
+
+    if (!conn) {
+        return;
+    }
+    if (profile != CONN_PARAMS_NONE) {
+        LOG_INF("requesting %s parameters: interval %u-%u, latency %u",
+                profile_name(profile), param.interval_min, param.interval_max, param.latency);
+        int err = bt_conn_le_param_update(conn, &param);
+        if (err && err != -EALREADY) {
+            LOG_WRN("failed to request parameters: %d", err);
+        }
+    }
+    if (next_eval_ms != CONN_PARAMS_NEVER) {
+        k_work_reschedule(&evaluate_work, K_MSEC(MAX(next_eval_ms - now_ms, 0)));
+    }
+}
+
+void transport_bt_conn_params_connected(struct bt_conn* conn) {
+    struct bt_conn_info info;
+    bt_conn_get_info(conn, &info);
+
+    k_spinlock_key_t key = k_spin_lock(&policy_lock);
+    conn_params_conn = conn;
+    conn_params_policy_init(&policy, k_uptime_get());
+    conn_params_policy_granted(&policy, info.le.interval, info.le.latency);
+    k_spin_unlock(&policy_lock, key);
+
+    LOG_INF("connected with interval %u (x1.25 ms), latency %u, timeout %u (x10 ms)",
+            info.le.interval, info.le.latency, info.le.timeout);
+    k_work_reschedule(&evaluate_work, K_NO_WAIT);
+}
+
+void transport_bt_conn_params_disconnected(struct bt_conn* conn) {
+    k_spinlock_key_t key = k_spin_lock(&policy_lock);
+    if (conn == conn_params_conn) {
+        conn_params_conn = NULL;
+    }
+    k_spin_unlock(&policy_lock, key);
+    k_work_cancel_delayable(&evaluate_work);
+}
+
+void transport_bt_conn_params_updated(struct bt_conn* conn, uint16_t interval, uint16_t latency, uint16_t timeout) {
+    k_spinlock_key_t key = k_spin_lock(&policy_lock);
+    if (conn != conn_params_conn) {
+        k_spin_unlock(&policy_lock, key);
+        return;
+    }
+    conn_params_policy_granted(&policy, interval, latency);
+    enum conn_params_profile requested = policy.requested;
+    enum conn_params_profile granted = policy.granted;
+    k_spin_unlock(&policy_lock, key);
+
+    // the central may pick other values than requested, e.g. longer interval or no latency
+    LOG_INF("granted interval %u (x1.25 ms), latency %u, timeout %u (x10 ms): %s profile (requested %s)",
+            interval, latency, timeout, profile_name(granted), profile_name(requested));
+    k_work_reschedule(&evaluate_work, K_NO_WAIT);
+}
+
+void transport_bt_conn_params_set_active_interval(uint16_t interval_min, uint16_t interval_max) {
+    k_spinlock_key_t key = k_spin_lock(&policy_lock);
+    conn_params_profile_set_interval(CONN_PARAMS_ACTIVE, interval_min, interval_max);
+    k_spin_unlock(&policy_lock, key);
+}
+
+void transport_bt_conn_params_activity() {
+    k_spinlock_key_t key = k_spin_lock(&policy_lock);
+    bool is_eval_needed = conn_params_conn && conn_params_policy_activity(&policy, k_uptime_get());
+    k_spin_unlock(&policy_lock, key);
+
+    if (is_eval_needed) {
+        k_work_reschedule(&evaluate_work, K_NO_WAIT);
+    }
+}
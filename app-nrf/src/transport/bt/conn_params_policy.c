@@ -0,0 +1,91 @@
+#include "transport/bt/conn_params.h"
+
+#include <stddef.h>
+
+#include <zephyr/sys/util.h>
+
+// policy has no dependencies on the BT stack, see conn_params.h
+
+static struct bt_le_conn_param profiles[] = {
+    [CONN_PARAMS_ACTIVE] = {
+        .interval_min = CONFIG_APP_BT_CONN_ACTIVE_INT_MIN,
+        .interval_max = CONFIG_APP_BT_CONN_ACTIVE_INT_MAX,
+        .latency = 0,
+        .timeout = CONFIG_APP_BT_CONN_TIMEOUT,
+    },
+    [CONN_PARAMS_IDLE] = {
+        .interval_min = CONFIG_APP_BT_CONN_IDLE_INT_MIN,
+        .interval_max = CONFIG_APP_BT_CONN_IDLE_INT_MAX,
+        .latency = CONFIG_APP_BT_CONN_IDLE_LATENCY,
+        .timeout = CONFIG_APP_BT_CONN_TIMEOUT,
+    },
+};
+
+// the link must survive the peripheral skipping events, see Core spec Vol 6, Part B, 4.5.2
+// (timeout is in 10 ms units, interval in 1.25 ms units)
+BUILD_ASSERT(CONFIG_APP_BT_CONN_TIMEOUT * 8 >
+             (1 + CONFIG_APP_BT_CONN_IDLE_LATENCY) * CONFIG_APP_BT_CONN_IDLE_INT_MAX * 2,
+             "supervision timeout is too short for idle latency");
+
+const struct bt_le_conn_param* conn_params_profile_get(enum conn_params_profile profile) {
+    return profile == CONN_PARAMS_NONE ? NULL : &profiles[profile];
+}
+
+void conn_params_profile_set_interval(enum conn_params_profile profile, uint16_t interval_min, uint16_t interval_max) {
+    if (profile != CONN_PARAMS_NONE) {
+        profiles[profile].interval_min = interval_min;
+        profiles[profile].interval_max = interval_max;
+    }
+}
+
+void conn_params_policy_init(struct conn_params_policy* policy, int64_t now_ms) {
+    *policy = (struct conn_params_policy) {
+        .last_activity_ms = now_ms,
+        .hold_until_ms = now_ms + CONN_PARAMS_CONNECT_DELAY_MS,
+        .requested = CONN_PARAMS_NONE,
+        .granted = CONN_PARAMS_NONE,
+    };
+}
+
+bool conn_params_policy_activity(struct conn_params_policy* policy, int64_t now_ms) {
+    policy->last_activity_ms = now_ms;
+    return policy->granted != CONN_PARAMS_ACTIVE && policy->requested != CONN_PARAMS_ACTIVE;
+}
+
+void conn_params_policy_granted(struct conn_params_policy* policy, uint16_t interval, uint16_t latency) {
+    // the central picks an interval within the range requested, and may grant less latency
+    policy->granted = CONN_PARAMS_NONE;
+    for (size_t i = CONN_PARAMS_ACTIVE; i < ARRAY_SIZE(profiles); i++) {
+        if (interval >= profiles[i].interval_min && interval <= profiles[i].interval_max &&
+            latency <= profiles[i].latency) {
+            policy->granted = i;
+            break;
+        }
+    }
+}
+
+enum conn_params_profile conn_params_policy_evaluate(struct conn_params_policy* policy,
+                                                     int64_t now_ms,
+                                                     int64_t* next_eval_ms) {
+    int64_t idle_at_ms = policy->last_activity_ms + CONFIG_APP_BT_CONN_IDLE_DELAY_MS;
+    enum conn_params_profile desired = now_ms < idle_at_ms ? CONN_PARAMS_ACTIVE : CONN_PARAMS_IDLE;
+    *next_eval_ms = desired == CONN_PARAMS_ACTIVE ? idle_at_ms : CONN_PARAMS_NEVER;
+
+    if (desired == policy->granted) {
+        return CONN_PARAMS_NONE;
+    }
+    // the central may still be busy with the connection setup, or may have rejected the same request
+    int64_t allowed_at_ms = policy->hold_until_ms;
+    if (desired == policy->requested) {
+        allowed_at_ms = MAX(allowed_at_ms, policy->requested_ms + CONN_PARAMS_RETRY_MS);
+    }
+    if (now_ms < allowed_at_ms) {
+        *next_eval_ms = MIN(*next_eval_ms, allowed_at_ms);
+        return CONN_PARAMS_NONE;
+    }
+
+    policy->requested = desired;
+    policy->requested_ms = now_ms;
+    *next_eval_ms = MIN(*next_eval_ms, now_ms + CONN_PARAMS_RETRY_MS);
+    return desired;
+}
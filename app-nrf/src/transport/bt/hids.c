@@ -1,9 +1,14 @@
 #include "transport/bt/hids.h"
 
 #include "transport/bt/conn.h"
+#include "transport/bt/conn_params.h"
+#include "transport/bt/reconnect.h"
+
+#include <errno.h>
 
 #include <bluetooth/services/hids.h>
 
+#include <zephyr/kernel.h>
 #include <zephyr/logging/log.h>
 
 #include "hid_report_map.h"
@@ -12,6 +17,10 @@
 LOG_MODULE_DECLARE(transport_bt);
 
 #define BASE_USB_HID_SPEC_VERSION 0x0101
+// how long a report which can't be merged waits for the pending one to be sent
+#define SUBMIT_TIMEOUT_MS 20
+// how long the sender waits for a buffer to free, a few connection intervals with latency
+#define PACE_TIMEOUT_MS 100
 
 BT_HIDS_DEF(hids_obj, sizeof(struct hid_report));
 
@@ -65,11 +74,44 @@ int transport_bt_hids_init() {
     return bt_hids_init(&hids_obj, &hids_init_param);
 }
 
+/* Notifications are sent with a completion callback, so that the number of notifications queued in the stack
+ * is known. It is kept below the number of ACL buffers, so that sending never waits for a buffer and the
+ * queue does not add latency. Meanwhile, reports are merged into a pending one, which is sent as soon as
+ * a notification is transmitted. A report with different button state can't be merged, it waits for
+ * the pending one to be sent. The sender is blocked while all buffers are in flight, so that motion keeps
+ * accumulating in the sensor and the next report is read right before a buffer frees.
+ */
+
+BUILD_ASSERT(CONFIG_APP_BT_HIDS_MAX_IN_FLIGHT < CONFIG_BT_BUF_ACL_TX_COUNT,
+             "one ACL buffer must be left for other traffic");
+
+static struct k_spinlock send_lock;
+// connection the notifications are sent to, notifications of a previous one may still complete
+static struct bt_conn* send_conn = NULL;
+static struct hid_report pending_report;
+static bool is_report_pending = false;
+static uint8_t num_in_flight = 0;
+static struct transport_bt_send_stats send_stats;
+
+// given when the pending report is taken to be sent
+K_SEM_DEFINE(report_taken_sem, 0, 1);
+
+static void reset_send_state(struct bt_conn* conn) {
+    k_spinlock_key_t key = k_spin_lock(&send_lock);
+    send_conn = conn;
+    is_report_pending = false;
+    num_in_flight = 0;
+    k_spin_unlock(&send_lock, key);
+}
+
 int transport_bt_hids_connected(struct bt_conn *conn) {
+    reset_send_state(conn);
     return bt_hids_connected(&hids_obj, conn);
 }
 
 int transport_bt_hids_disconnected(struct bt_conn *conn) {
+    reset_send_state(NULL);
+    k_sem_give(&report_taken_sem);
     return bt_hids_disconnected(&hids_obj, conn);
 }
 
@@ -77,12 +119,142 @@ int transport_bt_hids_disconnected(struct bt_conn *conn) {
 //     return bt_hids_uninit(&hids_obj);
 // }
 
-int transport_bt_send(struct hid_report* report) {
-    return bt_hids_inp_rep_send(
+static void flush_work_handler(struct k_work* work);
+
+K_WORK_DEFINE(flush_work, flush_work_handler);
+
+static void report_sent_cb(struct bt_conn *conn, void *user_data) {
+    k_spinlock_key_t key = k_spin_lock(&send_lock);
+    // notifications of a previous connection complete (or are dropped) after the state was reset, they are
+    // not counted in num_in_flight. The stack releases the connection object only after that, so a new
+    // connection can't reuse it meanwhile.
+    bool is_current = conn == send_conn;
+    if (is_current) {
+        num_in_flight--;
+        send_stats.completed++;
+    }
+    bool is_flush_needed = is_current && is_report_pending;
+    k_spin_unlock(&send_lock, key);
+
+    if (is_flush_needed) {
+        k_work_submit(&flush_work);
+    }
+}
+
+/**
+ * @brief Send the pending report if a buffer is free.
+ */
+static void flush_pending_report() {
+    struct hid_report report;
+
+    k_spinlock_key_t key = k_spin_lock(&send_lock);
+    struct bt_conn* conn = send_conn;
+    bool is_taken = conn && is_report_pending && num_in_flight < CONFIG_APP_BT_HIDS_MAX_IN_FLIGHT;
+    if (is_taken) {
+        report = pending_report;
+        is_report_pending = false;
+        num_in_flight++;
+        send_stats.max_in_flight = MAX(send_stats.max_in_flight, num_in_flight);
+    }
+    k_spin_unlock(&send_lock, key);
+
+    if (!is_taken) {
+        return;
+    }
+    k_sem_give(&report_taken_sem);
+
+    int err = bt_hids_inp_rep_send(
         &hids_obj,
-        current_client,
+        conn,
         0, // currently there's only one report defined
-        (uint8_t*) report,
+        (uint8_t*) &report,
         sizeof(struct hid_report),
-        NULL);
+        report_sent_cb);
+
+    key = k_spin_lock(&send_lock);
+    if (!err) {
+        send_stats.sent++;
+    } else if (conn != send_conn) {
+        // disconnected meanwhile, the state has been reset
+        send_stats.drops++;
+    } else {
+        num_in_flight--;
+        // the buffer may have been taken by other traffic, then the report is sent along with the next one
+        if (err == -ENOMEM && (!is_report_pending || can_merge_hid_reports_losslessly(&report, &pending_report))) {
+            if (is_report_pending) {
+                merge_hid_reports(&report, &pending_report);
+            }
+            pending_report = report;
+            is_report_pending = true;
+        } else {
+            send_stats.drops++;
+        }
+    }
+    k_spin_unlock(&send_lock, key);
+
+    if (err) {
+        LOG_DBG("notification failed: %d", err);
+    } else {
+        transport_bt_reconnect_mark(TRANSPORT_BT_RECONNECT_FIRST_REPORT);
+    }
+}
+
+static void flush_work_handler(struct k_work* work) {
+    flush_pending_report();
+}
+
+int transport_bt_send(struct hid_report* report) {
+    int err = 0;
+
+    transport_bt_conn_params_activity();
+
+    k_spinlock_key_t key = k_spin_lock(&send_lock);
+    // merging a button change would lose the click, so let the pending report go first
+    while (is_report_pending && !can_merge_hid_reports_losslessly(&pending_report, report)) {
+        k_spin_unlock(&send_lock, key);
+        flush_pending_report();
+        err = k_sem_take(&report_taken_sem, K_MSEC(SUBMIT_TIMEOUT_MS));
+        key = k_spin_lock(&send_lock);
+        if (err) {
+            break;
+        }
+    }
+    if (err) {
+        send_stats.drops++;
+        err = -EAGAIN;
+    } else if (is_report_pending) {
+        merge_hid_reports(&pending_report, report);
+        send_stats.coalesced++;
+    } else {
+        pending_report = *report;
+        is_report_pending = true;
+    }
+    k_spin_unlock(&send_lock, key);
+
+    // given by the flush below or on completion, if the pending report is taken
+    k_sem_reset(&report_taken_sem);
+    flush_pending_report();
+
+    key = k_spin_lock(&send_lock);
+    bool is_paced = send_conn && is_report_pending && num_in_flight >= CONFIG_APP_BT_HIDS_MAX_IN_FLIGHT;
+    k_spin_unlock(&send_lock, key);
+    if (is_paced) {
+        // on timeout the report stays pending, it's merged with the next one
+        k_sem_take(&report_taken_sem, K_MSEC(PACE_TIMEOUT_MS));
+    }
+    return err;
+}
+
+void transport_bt_send_stats_get(struct transport_bt_send_stats* stats) {
+    k_spinlock_key_t key = k_spin_lock(&send_lock);
+    *stats = send_stats;
+    stats->in_flight = num_in_flight;
+    stats->is_report_pending = is_report_pending;
+    k_spin_unlock(&send_lock, key);
+}
+
+void transport_bt_send_stats_reset() {
+    k_spinlock_key_t key = k_spin_lock(&send_lock);
+    send_stats = (struct transport_bt_send_stats) {};
+    k_spin_unlock(&send_lock, key);
 }
@@ -0,0 +1,345 @@
+#include "transport/bt/hosts.h"
+
+#include <errno.h>
+#include <stdlib.h>
+
+#include <hal/nrf_gpio.h>
+#include <zephyr/bluetooth/bluetooth.h>
+#include <zephyr/bluetooth/hci.h>
+#include <zephyr/device.h>
+#include <zephyr/drivers/sensor.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/settings/settings.h>
+#include <zephyr/sys/atomic.h>
+
+#include "drivers/adns7530.h"
+#include "platform/gpio.h"
+#include "services/debounce.h"
+#include "transport/bt/adv.h"
+#include "transport/bt/conn.h"
+#include "transport/bt/conn_params.h"
+#include "transport/bt/reconnect.h"
+
+LOG_MODULE_DECLARE(transport_bt);
+
+// a new host pairs before the previous host of its slot is removed, so one more bond is needed
+BUILD_ASSERT(CONFIG_BT_MAX_PAIRED > TRANSPORT_BT_HOSTS_NUM, "BT_MAX_PAIRED must exceed the number of host slots");
+
+#define DEFAULT_CPI 1200
+
+static struct transport_bt_host hosts[TRANSPORT_BT_HOSTS_NUM];
+// slots found in settings, others get defaults on init
+static uint32_t loaded_slots = 0;
+static uint8_t current_slot = 0;
+// slot to switch to, differs from current_slot until the switch work runs. It's atomic rather than guarded
+// by hosts_mutex, because it's set from button ISRs.
+static atomic_t requested_slot = ATOMIC_INIT(0);
+
+K_MUTEX_DEFINE(hosts_mutex);
+
+static int hosts_settings_set(const char* name, size_t len, settings_read_cb read_cb, void* cb_arg) {
+    const char* next;
+
+    if (settings_name_steq(name, "current", &next) && !next) {
+        uint8_t slot;
+        if (len != sizeof(slot) || read_cb(cb_arg, &slot, sizeof(slot)) != sizeof(slot) ||
+            slot >= TRANSPORT_BT_HOSTS_NUM) {
+            return -EINVAL;
+        }
+        current_slot = slot;
+        return 0;
+    }
+
+    char* end;
+    unsigned long slot = strtoul(name, &end, 10);
+    if (end == name || *end || slot >= TRANSPORT_BT_HOSTS_NUM) {
+        return -ENOENT;
+    }
+    struct transport_bt_host host;
+    if (len != sizeof(host) || read_cb(cb_arg, &host, sizeof(host)) != sizeof(host)) {
+        return -EINVAL;
+    }
+    hosts[slot] = host;
+    loaded_slots |= BIT(slot);
+    return 0;
+}
+
+SETTINGS_STATIC_HANDLER_DEFINE(hosts, "hosts", NULL, hosts_settings_set, NULL, NULL);
+
+static void save_host(uint8_t slot) {
+    char name[16];
+    snprintk(name, sizeof(name), "hosts/%u", slot);
+    int rv = settings_save_one(name, &hosts[slot], sizeof(hosts[slot]));
+    if (rv) {
+        LOG_WRN("failed to save %s: %d", name, rv);
+    }
+}
+
+static void save_current_slot() {
+    int rv = settings_save_one("hosts/current", &current_slot, sizeof(current_slot));
+    if (rv) {
+        LOG_WRN("failed to save current slot: %d", rv);
+    }
+}
+
+static bool has_host(const struct transport_bt_host* host) {
+    return bt_addr_le_cmp(&host->addr, BT_ADDR_LE_ANY) != 0;
+}
+
+static int find_slot(const bt_addr_le_t* addr) {
+    for (int i = 0; i < TRANSPORT_BT_HOSTS_NUM; i++) {
+        if (!bt_addr_le_cmp(&hosts[i].addr, addr)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Apply settings of a slot: sensor resolution and connection interval.
+ */
+static void apply_slot(const struct transport_bt_host* host) {
+    const struct device* sensor = DEVICE_DT_GET(DT_NODELABEL(optical_sensor));
+    struct sensor_value value = {.val1 = host->cpi};
+
+    int rv = device_is_ready(sensor) ? sensor_attr_set(sensor, SENSOR_CHAN_ALL, ADNS7530_ATTR_CPI, &value) : -ENODEV;
+    if (rv) {
+        LOG_WRN("failed to set %u cpi: %d", host->cpi, rv);
+    }
+    transport_bt_conn_params_set_active_interval(host->active_interval_min, host->active_interval_max);
+}
+
+struct bond_lookup {
+    const bt_addr_le_t* addr;
+    bool is_found;
+};
+
+static void find_bond(const struct bt_bond_info* info, void* user_data) {
+    struct bond_lookup* lookup = user_data;
+    lookup->is_found |= !bt_addr_le_cmp(&info->addr, lookup->addr);
+}
+
+static void assign_bond(const struct bt_bond_info* info, void* user_data) {
+    if (find_slot(&info->addr) >= 0) {
+        return;
+    }
+    int slot = find_slot(BT_ADDR_LE_ANY);
+    char addr_str[BT_ADDR_LE_STR_LEN];
+    bt_addr_le_to_str(&info->addr, addr_str, sizeof(addr_str));
+    if (slot < 0) {
+        LOG_WRN("no free slot for host %s", addr_str);
+        return;
+    }
+    LOG_INF("host %s assigned to slot %d", addr_str, slot);
+    hosts[slot].addr = info->addr;
+    save_host(slot);
+}
+
+/**
+ * @brief Drop hosts whose bonds are gone (e.g. overwritten), then put bonds not in any slot into free slots.
+ */
+static void sync_bonds() {
+    for (int i = 0; i < TRANSPORT_BT_HOSTS_NUM; i++) {
+        struct bond_lookup lookup = {.addr = &hosts[i].addr};
+        if (has_host(&hosts[i])) {
+            bt_foreach_bond(BT_ID_DEFAULT, find_bond, &lookup);
+            if (!lookup.is_found) {
+                hosts[i].addr = *BT_ADDR_LE_ANY;
+                save_host(i);
+            }
+        }
+    }
+    bt_foreach_bond(BT_ID_DEFAULT, assign_bond, NULL);
+}
+
+static void switch_work_handler(struct k_work* work) {
+    k_mutex_lock(&hosts_mutex, K_FOREVER);
+    uint8_t slot = atomic_get(&requested_slot);
+    bool is_changed = slot != current_slot;
+    current_slot = slot;
+    struct transport_bt_host host = hosts[slot];
+    k_mutex_unlock(&hosts_mutex);
+
+    if (!is_changed) {
+        return;
+    }
+
+    char addr_str[BT_ADDR_LE_STR_LEN];
+    bt_addr_le_to_str(&host.addr, addr_str, sizeof(addr_str));
+    LOG_INF("switching to slot %u, host %s", slot, has_host(&host) ? addr_str : "none");
+    transport_bt_reconnect_start(TRANSPORT_BT_RECONNECT_SWITCH);
+    apply_slot(&host);
+
+    if (current_client) {
+        // advertising to the new host is started on disconnection
+        bt_conn_disconnect(current_client, BT_HCI_ERR_REMOTE_USER_TERM_CONN);
+    } else {
+        bt_le_adv_stop();
+        transport_bt_adv_init(false);
+        transport_bt_adv_next();
+    }
+
+    // writing flash takes a while, so it's left until the new host is being reconnected
+    k_mutex_lock(&hosts_mutex, K_FOREVER);
+    save_current_slot();
+    k_mutex_unlock(&hosts_mutex);
+}
+
+K_WORK_DEFINE(switch_work, switch_work_handler);
+
+static void chord_button_cb(uint32_t pin, bool new_level) {
+    // buttons are active low, act on press while the special button is held
+    if (new_level || nrf_gpio_pin_read(PINOF(button_spec))) {
+        return;
+    }
+    uint8_t step = pin == PINOF(button_fwd) ? 1 : TRANSPORT_BT_HOSTS_NUM - 1;
+    atomic_val_t slot;
+    do {
+        slot = atomic_get(&requested_slot);
+    } while (!atomic_cas(&requested_slot, slot, (slot + step) % TRANSPORT_BT_HOSTS_NUM));
+    k_work_submit(&switch_work);
+}
+
+int transport_bt_hosts_init() {
+    k_mutex_lock(&hosts_mutex, K_FOREVER);
+    for (int i = 0; i < TRANSPORT_BT_HOSTS_NUM; i++) {
+        if (loaded_slots & BIT(i)) {
+            continue;
+        }
+        hosts[i] = (struct transport_bt_host) {
+            .addr = *BT_ADDR_LE_ANY,
+            .cpi = DEFAULT_CPI,
+            .active_interval_min = CONFIG_APP_BT_CONN_ACTIVE_INT_MIN,
+            .active_interval_max = CONFIG_APP_BT_CONN_ACTIVE_INT_MAX,
+        };
+    }
+    sync_bonds();
+    atomic_set(&requested_slot, current_slot);
+    struct transport_bt_host host = hosts[current_slot];
+    k_mutex_unlock(&hosts_mutex);
+
+    LOG_INF("host slot %u", current_slot);
+    apply_slot(&host);
+
+    debounce_set_edge_cb(PINOF(button_fwd), chord_button_cb);
+    debounce_set_edge_cb(PINOF(button_bwd), chord_button_cb);
+    return 0;
+}
+
+uint8_t transport_bt_hosts_current() {
+    return current_slot;
+}
+
+int transport_bt_hosts_get(uint8_t slot, struct transport_bt_host* host) {
+    if (slot >= TRANSPORT_BT_HOSTS_NUM) {
+        return -EINVAL;
+    }
+    k_mutex_lock(&hosts_mutex, K_FOREVER);
+    *host = hosts[slot];
+    k_mutex_unlock(&hosts_mutex);
+    return 0;
+}
+
+bool transport_bt_hosts_current_addr(bt_addr_le_t* addr) {
+    k_mutex_lock(&hosts_mutex, K_FOREVER);
+    *addr = hosts[current_slot].addr;
+    bool is_assigned = has_host(&hosts[current_slot]);
+    k_mutex_unlock(&hosts_mutex);
+    return is_assigned;
+}
+
+bool transport_bt_hosts_accepts(const bt_addr_le_t* peer) {
+    k_mutex_lock(&hosts_mutex, K_FOREVER);
+    int slot = find_slot(peer);
+    bool is_accepted = slot < 0 || slot == current_slot;
+    k_mutex_unlock(&hosts_mutex);
+    return is_accepted;
+}
+
+void transport_bt_hosts_secured(struct bt_conn* conn) {
+    const bt_addr_le_t* peer = bt_conn_get_dst(conn);
+
+    k_mutex_lock(&hosts_mutex, K_FOREVER);
+    uint8_t slot = current_slot;
+    bt_addr_le_t previous = hosts[slot].addr;
+    bool is_new = bt_addr_le_cmp(&previous, peer) != 0;
+    if (is_new) {
+        hosts[slot].addr = *peer;
+        save_host(slot);
+    }
+    k_mutex_unlock(&hosts_mutex);
+
+    if (!is_new) {
+        return;
+    }
+    char addr_str[BT_ADDR_LE_STR_LEN];
+    bt_addr_le_to_str(peer, addr_str, sizeof(addr_str));
+    LOG_INF("host %s assigned to slot %u", addr_str, slot);
+    if (bt_addr_le_cmp(&previous, BT_ADDR_LE_ANY)) {
+        bt_unpair(BT_ID_DEFAULT, &previous);
+    }
+}
+
+int transport_bt_hosts_select(uint8_t slot) {
+    if (slot >= TRANSPORT_BT_HOSTS_NUM) {
+        return -EINVAL;
+    }
+    atomic_set(&requested_slot, slot);
+    k_work_submit(&switch_work);
+    return 0;
+}
+
+int transport_bt_hosts_set_cpi(uint8_t slot, uint16_t cpi) {
+    if (slot >= TRANSPORT_BT_HOSTS_NUM || (cpi != 400 && cpi != 800 && cpi != 1200 && cpi != 1600)) {
+        return -EINVAL;
+    }
+    k_mutex_lock(&hosts_mutex, K_FOREVER);
+    hosts[slot].cpi = cpi;
+    save_host(slot);
+    bool is_current = slot == current_slot;
+    struct transport_bt_host host = hosts[slot];
+    k_mutex_unlock(&hosts_mutex);
+
+    if (is_current) {
+        apply_slot(&host);
+    }
+    return 0;
+}
+
+int transport_bt_hosts_set_active_interval(uint8_t slot, uint16_t interval_min, uint16_t interval_max) {
+    // valid range of connection interval, Core spec Vol 4, Part E, 7.8.18
+    if (slot >= TRANSPORT_BT_HOSTS_NUM || interval_min < 6 || interval_min > interval_max || interval_max > 3200) {
+        return -EINVAL;
+    }
+    k_mutex_lock(&hosts_mutex, K_FOREVER);
+    hosts[slot].active_interval_min = interval_min;
+    hosts[slot].active_interval_max = interval_max;
+    save_host(slot);
+    bool is_current = slot == current_slot;
+    struct transport_bt_host host = hosts[slot];
+    k_mutex_unlock(&hosts_mutex);
+
+    // takes effect with the next request of active parameters
+    if (is_current) {
+        apply_slot(&host);
+    }
+    return 0;
+}
+
+int transport_bt_hosts_forget(uint8_t slot) {
+    if (slot >= TRANSPORT_BT_HOSTS_NUM) {
+        return -EINVAL;
+    }
+    k_mutex_lock(&hosts_mutex, K_FOREVER);
+    bt_addr_le_t previous = hosts[slot].addr;
+    hosts[slot].addr = *BT_ADDR_LE_ANY;
+    save_host(slot);
+    k_mutex_unlock(&hosts_mutex);
+
+    // disconnects the host if it's connected, then it's advertised for pairing
+    if (bt_addr_le_cmp(&previous, BT_ADDR_LE_ANY)) {
+        return bt_unpair(BT_ID_DEFAULT, &previous);
+    }
+    return 0;
+}
@@ -0,0 +1,61 @@
+#include "transport/bt/reconnect.h"
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_DECLARE(transport_bt);
+
+static struct k_spinlock reconnect_lock;
+static struct transport_bt_reconnect_stats reconnect_stats = {
+    .start_ms = 0,
+    .cause = TRANSPORT_BT_RECONNECT_BOOT,
+    .step_ms = {-1, -1, -1, -1, -1, -1},
+};
+
+BUILD_ASSERT(TRANSPORT_BT_RECONNECT_NUM_STEPS == 6, "update step_ms initializer");
+
+static const char* cause_name(enum transport_bt_reconnect_cause cause) {
+    switch (cause) {
+        case TRANSPORT_BT_RECONNECT_BOOT: return "boot";
+        case TRANSPORT_BT_RECONNECT_SWITCH: return "host switch";
+        default: return "disconnection";
+    }
+}
+
+void transport_bt_reconnect_start(enum transport_bt_reconnect_cause cause) {
+    k_spinlock_key_t key = k_spin_lock(&reconnect_lock);
+    bool is_switching = reconnect_stats.cause == TRANSPORT_BT_RECONNECT_SWITCH &&
+                        reconnect_stats.step_ms[TRANSPORT_BT_RECONNECT_CONNECTED] == -1;
+    if (cause == TRANSPORT_BT_RECONNECT_DISCONNECTION && is_switching) {
+        k_spin_unlock(&reconnect_lock, key);
+        transport_bt_reconnect_mark(TRANSPORT_BT_RECONNECT_DISCONNECTED);
+        return;
+    }
+    reconnect_stats.start_ms = k_uptime_get();
+    reconnect_stats.cause = cause;
+    for (int i = 0; i < TRANSPORT_BT_RECONNECT_NUM_STEPS; i++) {
+        reconnect_stats.step_ms[i] = -1;
+    }
+    k_spin_unlock(&reconnect_lock, key);
+}
+
+void transport_bt_reconnect_mark(enum transport_bt_reconnect_step step) {
+    k_spinlock_key_t key = k_spin_lock(&reconnect_lock);
+    bool is_first = reconnect_stats.step_ms[step] == -1;
+    if (is_first) {
+        reconnect_stats.step_ms[step] = k_uptime_get() - reconnect_stats.start_ms;
+    }
+    int64_t step_ms = reconnect_stats.step_ms[step];
+    enum transport_bt_reconnect_cause cause = reconnect_stats.cause;
+    k_spin_unlock(&reconnect_lock, key);
+
+    if (is_first && step == TRANSPORT_BT_RECONNECT_FIRST_REPORT) {
+        LOG_INF("first report %lld ms after %s", step_ms, cause_name(cause));
+    }
+}
+
+void transport_bt_reconnect_stats_get(struct transport_bt_reconnect_stats* stats) {
+    k_spinlock_key_t key = k_spin_lock(&reconnect_lock);
+    *stats = reconnect_stats;
+    k_spin_unlock(&reconnect_lock, key);
+}
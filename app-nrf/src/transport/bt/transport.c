@@ -10,6 +10,8 @@
 #include "transport/bt/adv.h"
 #include "transport/bt/conn.h"
 #include "transport/bt/hids.h"
+#include "transport/bt/hosts.h"
+#include "transport/bt/reconnect.h"
 #include "transport/transport.h"
 
 LOG_MODULE_REGISTER(transport_bt);
@@ -31,6 +33,13 @@ static int transport_bt_init(const struct device *dev) {
     if (rv) {
         return rv;
     }
+    transport_bt_reconnect_mark(TRANSPORT_BT_RECONNECT_ENABLED);
+
+    // the current slot decides which host is advertised to
+    rv = transport_bt_hosts_init();
+    if (rv) {
+        return rv;
+    }
 
     transport_bt_hids_init();
 
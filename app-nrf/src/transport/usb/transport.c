@@ -0,0 +1,31 @@
+#include "transport/usb/transport.h"
+
+#include <errno.h>
+
+#include "services/avr_comm.h"
+#include "transport/transport.h"
+
+/* USB transport: reports are forwarded to the host by the AVR USB bridge. */
+
+int transport_usb_available() {
+    return avr_comm_usb_ready();
+}
+
+void transport_usb_set_availability_cb(transport_usb_availability_cb callback) {
+    avr_comm_set_usb_ready_cb(callback);
+}
+
+int transport_usb_send(struct hid_report* report) {
+    return avr_comm_submit_report(report);
+}
+
+int transport_usb_upd_bat_lvl(int level) {
+    // the device is powered from USB, battery level is not reported
+    return -ENOTSUP;
+}
+
+struct transport usb_transport = {
+    .available   = transport_usb_available,
+    .send        = transport_usb_send,
+    .upd_bat_lvl = transport_usb_upd_bat_lvl,
+};
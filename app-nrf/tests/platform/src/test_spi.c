@@ -0,0 +1,368 @@
+/* Tests of the SPI transaction queue on top of simulated SPIM, TIMER, PPI and GPIOTE (see sim/).
+ *
+ * The bus runs at 1 MHz, so a byte takes 8 us of simulated time. Every simulated timer (SPIM transfer,
+ * TIMER compare) expires one tick late, which is why measured delays are allowed a few us of slack.
+ */
+
+#include <string.h>
+
+#include <hal/nrf_gpio.h>
+#include <zephyr/devicetree.h>
+#include <zephyr/kernel.h>
+#include <zephyr/ztest.h>
+
+#include "platform/spi.h"
+#include "sim/gpio.h"
+#include "sim/periph.h"
+#include "sim/spim.h"
+
+#define SPIM_NODE DT_NODELABEL(spi0)
+#define SCK_PIN   DT_PROP(SPIM_NODE, sck_pin)
+#define CS_PIN_A  DT_GPIO_PIN_BY_IDX(SPIM_NODE, cs_gpios, 0)
+#define CS_PIN_B  DT_GPIO_PIN_BY_IDX(SPIM_NODE, cs_gpios, 1)
+
+#define BYTE_US       8
+#define SLACK_US      4
+#define MAX_RECORDS   16
+#define MAX_TX_RECORD 64
+
+BUILD_ASSERT(CONFIG_SPI_BOUNCE_BUF_SIZE <= MAX_TX_RECORD);
+
+struct transfer_record {
+    uint64_t end_us;
+    uint8_t tx[MAX_TX_RECORD];
+    size_t tx_len;
+    size_t rx_len;
+    bool is_cs_a_low;
+    bool is_cs_b_low;
+};
+
+struct completion_record {
+    struct spi_transaction* transaction;
+    int err;
+    uint64_t time_us;
+    bool is_cs_released;
+};
+
+// written from ISR, read by the test thread once all expected completions are signalled
+static struct transfer_record transfers[MAX_RECORDS];
+static int num_transfers;
+static struct completion_record completions[MAX_RECORDS];
+static int num_completions;
+static bool is_cs_low_at_segment_done[MAX_RECORDS];
+static int num_segments_done;
+K_SEM_DEFINE(completion_sem, 0, MAX_RECORDS);
+
+static struct spi_device_stats device_stats = {.name = "test"};
+
+static const struct spi_configuration config_mode0 = {
+    .op_mode = NRF_SPIM_MODE_0,
+    .bit_order = NRF_SPIM_BIT_ORDER_MSB_FIRST,
+    .freq = NRF_SPIM_FREQ_1M,
+    .is_const = true,
+    .stats = &device_stats,
+};
+
+static const struct spi_configuration config_timed = {
+    .op_mode = NRF_SPIM_MODE_0,
+    .bit_order = NRF_SPIM_BIT_ORDER_MSB_FIRST,
+    .freq = NRF_SPIM_FREQ_1M,
+    .segment_gap_us = 50,
+    .cs_hold_us = 30,
+    .is_const = true,
+};
+
+// SCK inactive high, like the AVR link
+static const struct spi_configuration config_mode3 = {
+    .op_mode = NRF_SPIM_MODE_3,
+    .bit_order = NRF_SPIM_BIT_ORDER_MSB_FIRST,
+    .freq = NRF_SPIM_FREQ_1M,
+    .is_const = true,
+    .stats = &device_stats,
+};
+
+/**
+ * @brief Device model: records the transfer and answers with inverted TX data.
+ */
+static void device_transfer(const uint8_t* tx, size_t tx_len, uint8_t* rx, size_t rx_len, void* user_data) {
+    for (size_t i = 0; i < MIN(tx_len, rx_len); i++) {
+        rx[i] = ~tx[i];
+    }
+    if (num_transfers == MAX_RECORDS) {
+        return;
+    }
+
+    struct transfer_record* record = &transfers[num_transfers++];
+    record->end_us = sim_clock_now_us();
+    memcpy(record->tx, tx, MIN(tx_len, MAX_TX_RECORD));
+    record->tx_len = tx_len;
+    record->rx_len = rx_len;
+    record->is_cs_a_low = !sim_gpio_level_get(CS_PIN_A);
+    record->is_cs_b_low = !sim_gpio_level_get(CS_PIN_B);
+}
+
+static int segment_done(struct spi_transaction* transaction, uint32_t segment_idx) {
+    if (num_segments_done < MAX_RECORDS) {
+        is_cs_low_at_segment_done[num_segments_done++] = !sim_gpio_level_get(transaction->cs_pin);
+    }
+    return 0;
+}
+
+static void transaction_done(struct spi_transaction* transaction, int err) {
+    if (num_completions < MAX_RECORDS) {
+        completions[num_completions++] = (struct completion_record) {
+            .transaction = transaction,
+            .err = err,
+            .time_us = sim_clock_now_us(),
+            .is_cs_released = sim_gpio_level_get(transaction->cs_pin),
+        };
+    }
+    k_sem_give(&completion_sem);
+}
+
+static void transaction_init(struct spi_transaction* transaction, const struct spi_configuration* config,
+                             uint32_t cs_pin, enum spi_priority priority,
+                             const struct spi_transfer_spec* segments, uint32_t num_segments) {
+    *transaction = (struct spi_transaction) {
+        .config = config,
+        .cs_pin = cs_pin,
+        .priority = priority,
+        .segments = segments,
+        .num_segments = num_segments,
+        .segment_done = segment_done,
+        .callback = transaction_done,
+    };
+}
+
+static void wait_completions(int count) {
+    for (int i = 0; i < count; i++) {
+        zassert_ok(k_sem_take(&completion_sem, K_MSEC(100)), "transaction %d not completed", i);
+    }
+    zassert_equal(num_completions, count);
+    for (int i = 0; i < count; i++) {
+        zassert_ok(completions[i].err);
+    }
+}
+
+static void* suite_setup(void) {
+    sim_spim_transfer_cb_set(device_transfer, NULL);
+    // CS pins are configured by device drivers, which are not part of the test
+    nrf_gpio_pin_set(CS_PIN_A);
+    nrf_gpio_pin_set(CS_PIN_B);
+    nrf_gpio_cfg_output(CS_PIN_A);
+    nrf_gpio_cfg_output(CS_PIN_B);
+    return NULL;
+}
+
+static void before(void* fixture) {
+    ARG_UNUSED(fixture);
+
+    num_transfers = 0;
+    num_completions = 0;
+    num_segments_done = 0;
+    k_sem_reset(&completion_sem);
+    spi_queue_stats_reset();
+}
+
+ZTEST_SUITE(spi_queue, NULL, suite_setup, before, NULL, NULL);
+
+ZTEST(spi_queue, test_priority_order_after_unlock) {
+    static uint8_t ids[] = {1, 2, 3};
+    struct spi_transfer_spec segments[ARRAY_SIZE(ids)];
+    struct spi_transaction transactions[ARRAY_SIZE(ids)];
+    static const enum spi_priority priorities[] = {SPI_PRIORITY_NORMAL, SPI_PRIORITY_NORMAL, SPI_PRIORITY_HIGH};
+    for (int i = 0; i < ARRAY_SIZE(ids); i++) {
+        segments[i] = (struct spi_transfer_spec) {.tx_buf = &ids[i], .tx_len = 1};
+        transaction_init(&transactions[i], &config_mode0, CS_PIN_A, priorities[i], &segments[i], 1);
+    }
+
+    // the queue is paused while the bus is locked
+    zassert_ok(spi_lock(K_FOREVER));
+    for (int i = 0; i < ARRAY_SIZE(ids); i++) {
+        zassert_ok(spi_submit(&transactions[i]));
+    }
+    k_sleep(K_USEC(100));
+    zassert_equal(num_transfers, 0);
+    zassert_ok(spi_unlock());
+
+    wait_completions(3);
+    zassert_equal(num_transfers, 3);
+    zassert_equal(transfers[0].tx[0], 3);
+    zassert_equal(transfers[1].tx[0], 1);
+    zassert_equal(transfers[2].tx[0], 2);
+    zassert_equal_ptr(completions[0].transaction, &transactions[2]);
+}
+
+ZTEST(spi_queue, test_priority_order_no_preemption) {
+    static uint8_t ids[] = {1, 2, 3};
+    struct spi_transfer_spec segments[ARRAY_SIZE(ids)];
+    struct spi_transaction transactions[ARRAY_SIZE(ids)];
+    static const enum spi_priority priorities[] = {SPI_PRIORITY_NORMAL, SPI_PRIORITY_NORMAL, SPI_PRIORITY_HIGH};
+    for (int i = 0; i < ARRAY_SIZE(ids); i++) {
+        segments[i] = (struct spi_transfer_spec) {.tx_buf = &ids[i], .tx_len = 1};
+        transaction_init(&transactions[i], &config_mode0, CS_PIN_A, priorities[i], &segments[i], 1);
+    }
+
+    // the first transaction starts right away, the high priority one overtakes the second one
+    for (int i = 0; i < ARRAY_SIZE(ids); i++) {
+        zassert_ok(spi_submit(&transactions[i]));
+    }
+
+    wait_completions(3);
+    zassert_equal(num_transfers, 3);
+    zassert_equal(transfers[0].tx[0], 1);
+    zassert_equal(transfers[1].tx[0], 3);
+    zassert_equal(transfers[2].tx[0], 2);
+
+    struct spi_queue_stats stats;
+    spi_queue_stats_get(&stats);
+    zassert_equal(stats.num_transactions, 3);
+    zassert_equal(device_stats.counters.num_transactions, 3);
+}
+
+ZTEST(spi_queue, test_cs_hold_and_segment_gap) {
+    static uint8_t tx[4] = {0x10, 0x11, 0x12, 0x13};
+    static const struct spi_transfer_spec segments[] = {
+        {.tx_buf = tx, .tx_len = 2},
+        {.tx_buf = tx, .tx_len = 4},
+        {.tx_buf = tx, .tx_len = 1},
+    };
+    struct spi_transaction transaction;
+    transaction_init(&transaction, &config_timed, CS_PIN_B, SPI_PRIORITY_NORMAL, segments, ARRAY_SIZE(segments));
+
+    uint64_t submit_us = sim_clock_now_us();
+    zassert_ok(spi_submit(&transaction));
+    wait_completions(1);
+
+    zassert_equal(num_transfers, 3);
+    // no configuration change which brings SCK high, the transaction starts right away
+    zassert_between_inclusive(transfers[0].end_us - submit_us, 2 * BYTE_US, 2 * BYTE_US + SLACK_US);
+    for (int i = 0; i < num_transfers; i++) {
+        zassert_true(transfers[i].is_cs_b_low, "CS released during segment %d", i);
+        zassert_false(transfers[i].is_cs_a_low);
+        zassert_equal(transfers[i].tx_len, segments[i].tx_len);
+    }
+
+    // the gap is measured from the end of a segment to the start of the next one
+    for (int i = 1; i < num_transfers; i++) {
+        uint64_t expected_us = config_timed.segment_gap_us + segments[i].tx_len * BYTE_US;
+        zassert_between_inclusive(transfers[i].end_us - transfers[i - 1].end_us,
+                                  expected_us, expected_us + SLACK_US, "gap before segment %d", i);
+    }
+
+    // CS is held during gaps, and released by PPI exactly cs_hold_us after the last segment
+    zassert_equal(num_segments_done, 3);
+    zassert_true(is_cs_low_at_segment_done[0]);
+    zassert_true(is_cs_low_at_segment_done[1]);
+    zassert_true(completions[0].is_cs_released);
+    zassert_between_inclusive(completions[0].time_us - transfers[2].end_us,
+                              config_timed.cs_hold_us, config_timed.cs_hold_us + SLACK_US);
+}
+
+#define FLASH_DATA_LEN (2 * CONFIG_SPI_BOUNCE_BUF_SIZE + 5)
+
+// marks the first and the last byte of each chunk, the rest is zero
+static const uint8_t flash_data[FLASH_DATA_LEN] = {
+    [0] = 0xa0,
+    [CONFIG_SPI_BOUNCE_BUF_SIZE - 1] = 0xa1,
+    [CONFIG_SPI_BOUNCE_BUF_SIZE] = 0xb0,
+    [2 * CONFIG_SPI_BOUNCE_BUF_SIZE - 1] = 0xb1,
+    [2 * CONFIG_SPI_BOUNCE_BUF_SIZE] = 0xc0,
+    [FLASH_DATA_LEN - 1] = 0xc1,
+};
+
+ZTEST(spi_queue, test_bounce_buffer_chunks) {
+    zassert_false(sim_is_in_ram(flash_data), "const data expected in read-only memory");
+
+    static uint8_t rx[FLASH_DATA_LEN];
+    memset(rx, 0, sizeof(rx));
+    const struct spi_transfer_spec segment = {
+        .tx_buf = flash_data,
+        .tx_len = FLASH_DATA_LEN,
+        .rx_buf = rx,
+        .rx_len = FLASH_DATA_LEN,
+    };
+    struct spi_transaction transaction;
+    transaction_init(&transaction, &config_mode0, CS_PIN_A, SPI_PRIORITY_NORMAL, &segment, 1);
+
+    zassert_ok(spi_submit(&transaction));
+    wait_completions(1);
+
+    // TX data not in RAM is sent through the bounce buffer, in chunks which keep CS low
+    static const size_t chunk_lens[] = {CONFIG_SPI_BOUNCE_BUF_SIZE, CONFIG_SPI_BOUNCE_BUF_SIZE, 5};
+    zassert_equal(num_transfers, ARRAY_SIZE(chunk_lens));
+    size_t offset = 0;
+    for (int i = 0; i < num_transfers; i++) {
+        zassert_equal(transfers[i].tx_len, chunk_lens[i], "chunk %d", i);
+        zassert_equal(transfers[i].rx_len, chunk_lens[i], "chunk %d", i);
+        zassert_mem_equal(transfers[i].tx, flash_data + offset, chunk_lens[i], "chunk %d", i);
+        zassert_true(transfers[i].is_cs_a_low, "CS released during chunk %d", i);
+        if (i > 0) {
+            // chunks follow each other without a gap
+            uint64_t expected_us = chunk_lens[i] * BYTE_US;
+            zassert_between_inclusive(transfers[i].end_us - transfers[i - 1].end_us,
+                                      expected_us, expected_us + SLACK_US, "chunk %d", i);
+        }
+        offset += chunk_lens[i];
+    }
+
+    // RX is received directly into the buffer of the segment
+    for (size_t i = 0; i < FLASH_DATA_LEN; i++) {
+        zassert_equal(rx[i], (uint8_t) ~flash_data[i], "rx byte %zu", i);
+    }
+    // segment_done is called once per segment, not per chunk
+    zassert_equal(num_segments_done, 1);
+    zassert_equal(device_stats.counters.bytes, FLASH_DATA_LEN);
+}
+
+ZTEST(spi_queue, test_transceive_rejects_long_data_not_in_ram) {
+    // low-level transfers are not chunked
+    struct spi_transfer_spec spec = {.tx_buf = flash_data, .tx_len = FLASH_DATA_LEN};
+
+    zassert_ok(spi_lock(K_FOREVER));
+    zassert_ok(spi_configure(&config_mode0));
+    zassert_equal(spi_transceive_sync(&spec), -EINVAL);
+    spec.tx_len = CONFIG_SPI_BOUNCE_BUF_SIZE;
+    zassert_ok(spi_transceive_sync(&spec));
+    zassert_ok(spi_unlock());
+
+    zassert_equal(num_transfers, 1);
+    zassert_mem_equal(transfers[0].tx, flash_data, CONFIG_SPI_BOUNCE_BUF_SIZE);
+}
+
+ZTEST(spi_queue, test_disable_sck_after_inactivity) {
+    static uint8_t tx[1] = {0x42};
+    static const struct spi_transfer_spec segment = {.tx_buf = tx, .tx_len = 1};
+    struct spi_transaction transactions[2];
+    transaction_init(&transactions[0], &config_mode3, CS_PIN_B, SPI_PRIORITY_NORMAL, &segment, 1);
+    transaction_init(&transactions[1], &config_mode3, CS_PIN_B, SPI_PRIORITY_NORMAL, &segment, 1);
+    zassert_false(sim_gpio_level_get(SCK_PIN));
+
+    // bringing SCK high stalls the transaction for CONFIG_SPI_ENABLE_CLK_DELAY
+    uint64_t submit_us = sim_clock_now_us();
+    zassert_ok(spi_submit(&transactions[0]));
+    wait_completions(1);
+    zassert_true(transfers[0].end_us - submit_us >= CONFIG_SPI_ENABLE_CLK_DELAY + BYTE_US);
+    zassert_true(sim_gpio_level_get(SCK_PIN));
+    zassert_equal(device_stats.counters.clk_enable_stalls, 1);
+
+    // another transaction in the middle of the delay restarts it
+    uint64_t idle_us = completions[0].time_us;
+    k_sleep(K_TIMEOUT_ABS_US(idle_us + CONFIG_SPI_DISABLE_CLK_DELAY / 2));
+    zassert_ok(spi_submit(&transactions[1]));
+    zassert_ok(k_sem_take(&completion_sem, K_MSEC(100)));
+    zassert_ok(completions[1].err);
+    zassert_equal(num_transfers, 2);
+    // the configuration is kept, no more stalls
+    zassert_equal(device_stats.counters.clk_enable_stalls, 1);
+
+    k_sleep(K_TIMEOUT_ABS_US(idle_us + CONFIG_SPI_DISABLE_CLK_DELAY + 2 * SLACK_US));
+    zassert_true(sim_gpio_level_get(SCK_PIN), "SCK disabled before the delay since the last transaction");
+
+    idle_us = completions[1].time_us;
+    k_sleep(K_TIMEOUT_ABS_US(idle_us + CONFIG_SPI_DISABLE_CLK_DELAY - SLACK_US));
+    zassert_true(sim_gpio_level_get(SCK_PIN));
+    k_sleep(K_TIMEOUT_ABS_US(idle_us + CONFIG_SPI_DISABLE_CLK_DELAY + SLACK_US));
+    zassert_false(sim_gpio_level_get(SCK_PIN));
+    zassert_equal(device_stats.counters.clk_disables, 1);
+}
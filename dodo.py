@@ -8,16 +8,17 @@ PROGRAMMER_SSH_HOST = 'pi'
 
 @task_params([{'name': 'build_dir', 'default': 'build', 'short': 'b'}])
 def task_flash(build_dir):
-    FILES_TO_COPY = [
-        'zephyr.hex',
-        'zephyr.lst',
-        'zephyr.map',
-    ]
-    zephyr_dir = f'{APP_NRF_DIRECTORY}/{build_dir}/zephyr'
+    # sysbuild places the application in a subdirectory, and merges it with MCUboot into a single hex
+    zephyr_dir = f'{APP_NRF_DIRECTORY}/{build_dir}/{APP_NRF_DIRECTORY}/zephyr'
+    FILES_TO_COPY = {
+        f'{APP_NRF_DIRECTORY}/{build_dir}/merged.hex': 'zephyr.hex',
+        f'{zephyr_dir}/zephyr.lst': 'zephyr.lst',
+        f'{zephyr_dir}/zephyr.map': 'zephyr.map',
+    }
     return {
-        'file_dep': [f'{zephyr_dir}/{file}' for file in FILES_TO_COPY],
+        'file_dep': list(FILES_TO_COPY),
         'actions': [
-            *(f'scp {zephyr_dir}/{file} {PROGRAMMER_SSH_HOST}:{file}' for file in FILES_TO_COPY),
+            *(f'scp {local} {PROGRAMMER_SSH_HOST}:{remote}' for local, remote in FILES_TO_COPY.items()),
             f'ssh {PROGRAMMER_SSH_HOST} ./flash.sh'
         ],
         'verbosity': 2,
@@ -11,6 +11,7 @@ use std::{
     collections::HashMap,
     fmt::{Debug, Display, Write},
     iter,
+    time::Instant,
 };
 
 use crate::communicator::BootloaderCommunicator;
@@ -90,6 +91,25 @@ mod target {
 
     /// Type alias for a fixed-size array representing a single flash page content.
     pub type FlashPageContent = [u8; FLASH_PAGE_SIZE_BYTES as usize];
+
+    /// Number of flash pages available to the application, see `APP_NUM_PAGES` in bootloader `Descriptors.h`.
+    pub const APP_NUM_PAGES: usize = 0x1800 / FLASH_PAGE_SIZE_BYTES as usize;
+
+    /// Bootloader special address to verify the written pages, see `COMMAND_VERIFY` in `BootloaderHID.c`.
+    pub const COMMAND_VERIFY: u16 = 0xfffe;
+}
+
+/// Update CRC-16/XMODEM (poly 0x1021, init 0), as computed by `_crc_xmodem_update` in avr-libc.
+fn crc16_xmodem(crc: u16, data: &[u8]) -> u16 {
+    data.iter().fold(crc, |crc, &byte| {
+        (0..8).fold(crc ^ ((byte as u16) << 8), |crc, _| {
+            if crc & 0x8000 != 0 {
+                (crc << 1) ^ 0x1021
+            } else {
+                crc << 1
+            }
+        })
+    })
 }
 
 impl BootloaderCommunicator {
@@ -105,7 +125,33 @@ impl BootloaderCommunicator {
             data: &'a target::FlashPageContent,
         }
 
-        let bar = indicatif::ProgressBar::new(flash_data.0.len() as u64)
+        #[derive(Debug, PartialEq, Eq, DekuWrite)]
+        #[deku(endian = "little")]
+        struct VerifyPacket {
+            report_id: u8,
+            command: u16,
+            num_pages: u16,
+            crc: u16,
+        }
+
+        let start = Instant::now();
+
+        // only send pages which differ from the flash content
+        let page_crcs = self.read_page_crcs()?;
+        let changed_pages = flash_data
+            .0
+            .iter()
+            .filter(|(page_index, page_content)| {
+                page_crcs.get(*page_index as usize) != Some(&crc16_xmodem(0, &page_content[..]))
+            })
+            .collect::<Vec<_>>();
+        println!(
+            "{} of {} pages changed",
+            changed_pages.len(),
+            flash_data.0.len()
+        );
+
+        let bar = indicatif::ProgressBar::new(changed_pages.len() as u64)
             .with_message("Flashing")
             .with_style(
                 indicatif::ProgressStyle::default_bar()
@@ -113,7 +159,7 @@ impl BootloaderCommunicator {
                     .expect("template should be valid"),
             )
             .with_finish(indicatif::ProgressFinish::AndLeave);
-        for (page_index, page_content) in flash_data.0.iter().progress_with(bar) {
+        for (page_index, page_content) in changed_pages.iter().copied().progress_with(bar) {
             self.device.write(
                 FlashPagePacket {
                     report_id: 0,
@@ -125,8 +171,43 @@ impl BootloaderCommunicator {
             )?;
         }
 
+        // the bootloader refuses to start the application until written pages are verified,
+        // a failed verification is reported as a write error
+        self.device
+            .write(
+                VerifyPacket {
+                    report_id: 0,
+                    command: target::COMMAND_VERIFY,
+                    num_pages: changed_pages.len() as u16,
+                    crc: changed_pages
+                        .iter()
+                        .fold(0, |crc, (_, page)| crc16_xmodem(crc, &page[..])),
+                }
+                .to_bytes()?
+                .as_ref(),
+            )
+            .context("flash verification failed")?;
+        println!(
+            "Flashed and verified in {:.2} s",
+            start.elapsed().as_secs_f32()
+        );
+
         Ok(())
     }
+
+    /// Read CRC-16/XMODEM of each application flash page, indexed by page index.
+    fn read_page_crcs(&self) -> Result<Vec<u16>> {
+        let mut buf = [0u8; 1 + 2 * target::APP_NUM_PAGES];
+        let size = self
+            .device
+            .get_feature_report(&mut buf)
+            .context("failed to read page CRCs")?;
+        // the first byte is the report ID
+        Ok(buf[1..size]
+            .chunks_exact(2)
+            .map(|crc| u16::from_le_bytes([crc[0], crc[1]]))
+            .collect())
+    }
 }
 
 /// Fill `flash_map` with given page content, overwriting or joining existing data when necessary.
@@ -212,7 +293,14 @@ impl<'a, const N: usize> PageContent<'a, N> {
 mod tests {
     use std::{borrow::Cow, collections::HashMap};
 
-    use super::{fill_flash_map, iter_page_content, PageContent};
+    use super::{crc16_xmodem, fill_flash_map, iter_page_content, PageContent};
+
+    #[test]
+    fn test_crc16_xmodem() {
+        assert_eq!(crc16_xmodem(0, b"123456789"), 0x31c3);
+        // continuing over chunks equals computing over the whole data
+        assert_eq!(crc16_xmodem(crc16_xmodem(0, b"1234"), b"56789"), 0x31c3);
+    }
 
     #[test]
     fn test_create_page_content() {
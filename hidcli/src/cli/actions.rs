@@ -1,12 +1,21 @@
 use anyhow::Result;
-use std::{fs, path::PathBuf};
+use std::{
+    fs,
+    io::{self, BufRead, Write},
+    path::PathBuf,
+    time::Duration,
+};
 
 use crate::{
     avr_flashing::read_flash_data,
     cli::types::DeviceMode,
     communicator::{find_device, Device, DeviceCommunicator},
+    nrf_dfu, nrf_shell,
 };
 
+/// How long a shell command may stay silent before it's considered complete without the prompt.
+const SHELL_COMMAND_TIMEOUT: Duration = Duration::from_secs(2);
+
 fn with_device(func: impl FnOnce(&mut Device) -> Result<()>) -> Result<()> {
     match find_device()? {
         None => {
@@ -48,3 +57,47 @@ pub fn flash(file_path: &PathBuf) -> Result<()> {
     // Ok(())
     with_device(|device| device.bootloader_communicator()?.flash(&flash_data))
 }
+
+pub fn dfu(file_path: &PathBuf, resume: bool) -> Result<()> {
+    let image = fs::read(file_path)?;
+    println!("Read {} bytes from {}", image.len(), file_path.display());
+    with_device(|device| {
+        let bar = indicatif::ProgressBar::new(image.len() as u64)
+            .with_message("Updating")
+            .with_style(
+                indicatif::ProgressStyle::default_bar()
+                    .template("{msg}... {bar:30} {bytes:>9}/{total_bytes:9} {bytes_per_sec}")
+                    .expect("template should be valid"),
+            )
+            .with_finish(indicatif::ProgressFinish::AndLeave);
+        nrf_dfu::update(device.app_communicator()?, &image, resume, |offset| {
+            bar.set_position((offset as u64).min(image.len() as u64))
+        })?;
+        bar.finish();
+        println!("Image sent, nRF reboots to install it.");
+        Ok(())
+    })
+}
+
+pub fn shell(command: Option<String>) -> Result<()> {
+    with_device(|device| {
+        let comm = device.app_communicator()?;
+        let run = |line: &str| -> Result<()> {
+            let mut stdout = io::stdout();
+            nrf_shell::run_command(comm, line, SHELL_COMMAND_TIMEOUT, |data| {
+                // the output is flushed as it arrives, so that long dumps show progress
+                let _ = stdout.write_all(data).and_then(|_| stdout.flush());
+            })?;
+            Ok(())
+        };
+        match command {
+            Some(line) => run(&line),
+            None => {
+                for line in io::stdin().lock().lines() {
+                    run(&line?)?;
+                }
+                Ok(())
+            }
+        }
+    })
+}
@@ -18,4 +18,16 @@ pub fn get_command() -> Command {
                 .arg_required_else_help(true)
                 .arg(arg!(<PATH> "Image (.hex file)").value_parser(clap::value_parser!(PathBuf))),
         )
+        .subcommand(
+            Command::new("dfu")
+                .about("Update nRF firmware via AVR application")
+                .arg_required_else_help(true)
+                .arg(arg!(<PATH> "Signed MCUboot image (zephyr.signed.bin)").value_parser(clap::value_parser!(PathBuf)))
+                .arg(arg!(--resume "Continue an interrupted update of the same image")),
+        )
+        .subcommand(
+            Command::new("shell")
+                .about("Run nRF shell commands via AVR application (interactive without COMMAND)")
+                .arg(arg!([COMMAND] ... "Command line, e.g. settings read bt/name")),
+        )
 }
@@ -19,7 +19,7 @@ pub enum CommunicationError {
 /// running on the AVR microcontroller.
 #[derive(Debug)]
 pub struct AppCommunicator {
-    device: HidDevice,
+    pub(crate) device: HidDevice,
 }
 
 impl AppCommunicator {
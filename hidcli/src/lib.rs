@@ -1,3 +1,5 @@
 pub mod avr_flashing;
 pub mod cli;
 pub mod communicator;
+pub mod nrf_dfu;
+pub mod nrf_shell;
@@ -25,6 +25,17 @@ fn actual_main() -> Result<()> {
                 .get_one::<PathBuf>("PATH")
                 .expect("required in clap"),
         ),
+        Some(("dfu", sub_matches)) => hidcli::cli::actions::dfu(
+            sub_matches
+                .get_one::<PathBuf>("PATH")
+                .expect("required in clap"),
+            sub_matches.get_flag("resume"),
+        ),
+        Some(("shell", sub_matches)) => hidcli::cli::actions::shell(
+            sub_matches
+                .get_many::<String>("COMMAND")
+                .map(|words| words.cloned().collect::<Vec<_>>().join(" ")),
+        ),
         _ => unimplemented!(),
     }
 }
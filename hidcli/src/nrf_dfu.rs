@@ -0,0 +1,446 @@
+//! Firmware update of the nRF, streamed through the AVR application.
+//!
+//! The image is sent in chunks as output reports, which the AVR forwards to the nRF over SPI
+//! (see `avr_link.h`). The nRF writes chunks in order and ignores any other, its status (state and
+//! offset of the next chunk expected) is read back as a feature report. The AVR NAKs a chunk until
+//! the previous one is forwarded, so chunks are written back-to-back and the status is only checked
+//! once in a while to detect lost chunks and resume from the offset reported.
+
+use anyhow::{bail, ensure, Context, Result};
+use std::{thread, time::Duration};
+
+use crate::communicator::AppCommunicator;
+
+/// HID report ID used for the update, see `HID_REPORTID_DFU` in AVR `descriptors.h`.
+const REPORT_ID: u8 = 9;
+
+/// Image bytes carried by a chunk, see `AVR_LINK_DFU_CHUNK_DATA_SIZE`.
+pub const CHUNK_DATA_SIZE: usize = 16;
+
+/// Chunk offset finishing the update, see `AVR_LINK_DFU_OFFSET_FINISH`.
+const OFFSET_FINISH: u32 = 0xffff_ffff;
+
+/// Size of chunk report: report ID, offset, data and CRC.
+pub const CHUNK_REPORT_SIZE: usize = 1 + 4 + CHUNK_DATA_SIZE + 2;
+
+/// Size of status report: report ID, state and offset.
+pub const STATUS_REPORT_SIZE: usize = 1 + 1 + 4;
+
+/// Number of chunks written between status checks.
+const CHUNKS_PER_CHECK: u32 = 256;
+
+/// Number of times the status is polled while waiting for the nRF to catch up.
+const MAX_STATUS_POLLS: u32 = 50;
+const STATUS_POLL_INTERVAL: Duration = Duration::from_millis(10);
+
+/// Number of times sending is resumed from the offset reported before giving up.
+const MAX_RESUMES: u32 = 16;
+
+/// State of the update on the nRF, see `enum avr_link_dfu_state`.
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum DfuState {
+    Idle,
+    Receiving,
+    Done,
+    Error,
+    Unknown(u8),
+}
+
+impl From<u8> for DfuState {
+    fn from(value: u8) -> Self {
+        match value {
+            0 => DfuState::Idle,
+            1 => DfuState::Receiving,
+            2 => DfuState::Done,
+            3 => DfuState::Error,
+            other => DfuState::Unknown(other),
+        }
+    }
+}
+
+/// Status of the update on the nRF.
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub struct DfuStatus {
+    pub state: DfuState,
+    /// Offset of the next chunk expected.
+    pub offset: u32,
+}
+
+impl DfuStatus {
+    fn parse(report: &[u8]) -> Result<Self> {
+        ensure!(
+            report.len() == STATUS_REPORT_SIZE && report[0] == REPORT_ID,
+            "invalid status report"
+        );
+        Ok(DfuStatus {
+            state: report[1].into(),
+            offset: u32::from_le_bytes(report[2..6].try_into().expect("size is checked")),
+        })
+    }
+}
+
+/// Endpoint accepting update chunks, implemented by the device and by simulated devices in tests.
+pub trait DfuEndpoint {
+    /// Write a chunk report, blocks until the AVR accepts it.
+    fn write_chunk(&self, report: &[u8; CHUNK_REPORT_SIZE]) -> Result<()>;
+
+    /// Read the status report last sent by the nRF.
+    fn read_status(&self) -> Result<[u8; STATUS_REPORT_SIZE]>;
+}
+
+impl DfuEndpoint for AppCommunicator {
+    fn write_chunk(&self, report: &[u8; CHUNK_REPORT_SIZE]) -> Result<()> {
+        self.device.write(report)?;
+        Ok(())
+    }
+
+    fn read_status(&self) -> Result<[u8; STATUS_REPORT_SIZE]> {
+        let mut buf = [0u8; STATUS_REPORT_SIZE];
+        buf[0] = REPORT_ID;
+        let size = self.device.get_feature_report(&mut buf)?;
+        ensure!(size == STATUS_REPORT_SIZE, "short status report");
+        Ok(buf)
+    }
+}
+
+/// Compute CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF), as `avr_link_crc16`.
+fn crc16_ccitt_false(data: &[u8]) -> u16 {
+    data.iter().fold(0xffff, |crc, &byte| {
+        (0..8).fold(crc ^ ((byte as u16) << 8), |crc, _| {
+            if crc & 0x8000 != 0 {
+                (crc << 1) ^ 0x1021
+            } else {
+                crc << 1
+            }
+        })
+    })
+}
+
+/// Build chunk report, see `struct avr_link_dfu_chunk`.
+fn chunk_report(offset: u32, data: &[u8; CHUNK_DATA_SIZE]) -> [u8; CHUNK_REPORT_SIZE] {
+    let mut report = [0u8; CHUNK_REPORT_SIZE];
+    report[0] = REPORT_ID;
+    report[1..5].copy_from_slice(&offset.to_le_bytes());
+    report[5..5 + CHUNK_DATA_SIZE].copy_from_slice(data);
+    let crc = crc16_ccitt_false(&report[1..5 + CHUNK_DATA_SIZE]);
+    report[5 + CHUNK_DATA_SIZE..].copy_from_slice(&crc.to_le_bytes());
+    report
+}
+
+/// Get image data of the chunk at `offset`, padding the last one with erased flash value.
+fn chunk_data(image: &[u8], offset: u32) -> [u8; CHUNK_DATA_SIZE] {
+    let mut data = [0xffu8; CHUNK_DATA_SIZE];
+    let start = (offset as usize).min(image.len());
+    let end = (start + CHUNK_DATA_SIZE).min(image.len());
+    data[..end - start].copy_from_slice(&image[start..end]);
+    data
+}
+
+/// Sends an image and keeps track of the nRF status.
+struct Update<'a, E: DfuEndpoint> {
+    endpoint: &'a E,
+    image: &'a [u8],
+    /// Image size rounded up to whole chunks.
+    padded_size: u32,
+}
+
+impl<'a, E: DfuEndpoint> Update<'a, E> {
+    fn status(&self) -> Result<DfuStatus> {
+        let status = DfuStatus::parse(&self.endpoint.read_status()?)?;
+        if status.state == DfuState::Error {
+            bail!("nRF failed to write the image, see its log");
+        }
+        Ok(status)
+    }
+
+    /// Wait until the nRF has processed chunks up to `offset`, or stops making progress.
+    ///
+    /// Returns the last status, its offset is where sending should resume from.
+    fn settle(&self, offset: u32) -> Result<DfuStatus> {
+        let mut status = self.status()?;
+        for _ in 0..MAX_STATUS_POLLS {
+            if status.state != DfuState::Receiving || status.offset >= offset {
+                break;
+            }
+            thread::sleep(STATUS_POLL_INTERVAL);
+            let previous = status;
+            status = self.status()?;
+            if status == previous {
+                break;
+            }
+        }
+        Ok(status)
+    }
+
+    /// Send chunks from `offset` up to the end of the image, or until a write fails.
+    ///
+    /// Returns the offset the nRF expects next.
+    fn send_from(&self, mut offset: u32, progress: &mut impl FnMut(u32)) -> Result<u32> {
+        let mut num_chunks = 0;
+        while offset < self.padded_size {
+            if self
+                .endpoint
+                .write_chunk(&chunk_report(offset, &chunk_data(self.image, offset)))
+                .is_err()
+            {
+                // e.g. the AVR stalled because the nRF did not take the previous chunk in time
+                break;
+            }
+            offset += CHUNK_DATA_SIZE as u32;
+            num_chunks += 1;
+            if num_chunks % CHUNKS_PER_CHECK == 0 {
+                let status = self.settle(offset)?;
+                progress(status.offset);
+                if status.state != DfuState::Receiving || status.offset < offset {
+                    break;
+                }
+            }
+        }
+        let status = self.settle(offset)?;
+        progress(status.offset);
+        ensure!(
+            status.state == DfuState::Receiving,
+            "update was aborted by nRF (state {:?})",
+            status.state
+        );
+        Ok(status.offset)
+    }
+
+    fn finish(&self) -> Result<()> {
+        let mut data = [0u8; CHUNK_DATA_SIZE];
+        data[..4].copy_from_slice(&(self.image.len() as u32).to_le_bytes());
+        self.endpoint
+            .write_chunk(&chunk_report(OFFSET_FINISH, &data))
+            .context("failed to finish the update")?;
+        for _ in 0..MAX_STATUS_POLLS {
+            if self.status()?.state == DfuState::Done {
+                return Ok(());
+            }
+            thread::sleep(STATUS_POLL_INTERVAL);
+        }
+        bail!("nRF did not confirm the update")
+    }
+}
+
+/// Update nRF firmware with a signed MCUboot image (`zephyr.signed.bin`).
+///
+/// With `resume`, sending continues from the offset the nRF has reached with a previous (interrupted)
+/// update, which must have been of the same image. `progress` is called with the number of bytes
+/// confirmed by the nRF.
+pub fn update(
+    endpoint: &impl DfuEndpoint,
+    image: &[u8],
+    resume: bool,
+    mut progress: impl FnMut(u32),
+) -> Result<()> {
+    ensure!(!image.is_empty(), "image is empty");
+    let update = Update {
+        endpoint,
+        image,
+        padded_size: image.len().div_ceil(CHUNK_DATA_SIZE) as u32 * CHUNK_DATA_SIZE as u32,
+    };
+
+    let status = DfuStatus::parse(&endpoint.read_status()?)?;
+    let mut offset = if resume && status.state == DfuState::Receiving && status.offset <= update.padded_size {
+        status.offset
+    } else {
+        0
+    };
+
+    for _ in 0..MAX_RESUMES {
+        offset = update.send_from(offset, &mut progress)?;
+        if offset == update.padded_size {
+            return update.finish();
+        }
+    }
+    bail!("too many chunks lost, stopped at offset {offset}")
+}
+
+#[cfg(test)]
+mod tests {
+    use std::cell::RefCell;
+
+    use super::*;
+
+    /// Simulated AVR and nRF, following the rules of `dfu.c` on nRF.
+    #[derive(Default)]
+    struct SimulatedDevice {
+        state: RefCell<SimulatedState>,
+        /// Indices of chunk writes (counted from 0) to drop on the way.
+        drop_writes: Vec<usize>,
+        /// Indices of chunk writes to fail, as if the AVR stalled them.
+        fail_writes: Vec<usize>,
+        /// Index of chunk write after which the nRF stops accepting anything.
+        disconnect_after: Option<usize>,
+    }
+
+    #[derive(Default)]
+    struct SimulatedState {
+        num_writes: usize,
+        image: Vec<u8>,
+        state: u8,
+        offset: u32,
+        finished_size: Option<u32>,
+    }
+
+    impl SimulatedDevice {
+        fn process(&self, report: &[u8; CHUNK_REPORT_SIZE]) {
+            let mut sim = self.state.borrow_mut();
+            let offset = u32::from_le_bytes(report[1..5].try_into().unwrap());
+            let data = &report[5..5 + CHUNK_DATA_SIZE];
+            let crc = u16::from_le_bytes(report[5 + CHUNK_DATA_SIZE..].try_into().unwrap());
+            if crc16_ccitt_false(&report[1..5 + CHUNK_DATA_SIZE]) != crc {
+                return;
+            }
+            if offset == 0 {
+                sim.state = 1;
+                sim.offset = 0;
+                sim.image.clear();
+            }
+            if sim.state == 1 && offset == OFFSET_FINISH {
+                let size = u32::from_le_bytes(data[..4].try_into().unwrap());
+                if size <= sim.offset && sim.offset - size < CHUNK_DATA_SIZE as u32 {
+                    sim.finished_size = Some(size);
+                    sim.state = 2;
+                } else {
+                    sim.state = 3;
+                }
+            } else if sim.state == 1 && offset == sim.offset {
+                sim.image.extend_from_slice(data);
+                sim.offset += CHUNK_DATA_SIZE as u32;
+            }
+        }
+
+        fn received_image(&self) -> Vec<u8> {
+            let sim = self.state.borrow();
+            sim.image[..sim.finished_size.expect("update is not finished") as usize].to_vec()
+        }
+    }
+
+    impl DfuEndpoint for SimulatedDevice {
+        fn write_chunk(&self, report: &[u8; CHUNK_REPORT_SIZE]) -> Result<()> {
+            let index = {
+                let mut sim = self.state.borrow_mut();
+                sim.num_writes += 1;
+                sim.num_writes - 1
+            };
+            if self.fail_writes.contains(&index) {
+                bail!("stalled");
+            }
+            if self.disconnect_after.is_some_and(|last| index > last) || self.drop_writes.contains(&index) {
+                return Ok(());
+            }
+            self.process(report);
+            Ok(())
+        }
+
+        fn read_status(&self) -> Result<[u8; STATUS_REPORT_SIZE]> {
+            let sim = self.state.borrow();
+            let mut report = [REPORT_ID, sim.state, 0, 0, 0, 0];
+            report[2..].copy_from_slice(&sim.offset.to_le_bytes());
+            Ok(report)
+        }
+    }
+
+    fn test_image(size: usize) -> Vec<u8> {
+        (0..size).map(|i| (i * 7 + i / 256) as u8).collect()
+    }
+
+    #[test]
+    fn test_crc16_ccitt_false() {
+        assert_eq!(crc16_ccitt_false(b"123456789"), 0x29b1);
+    }
+
+    #[test]
+    fn test_chunk_report() {
+        let report = chunk_report(0x12345678, &[0xaa; CHUNK_DATA_SIZE]);
+        assert_eq!(report[..5], [REPORT_ID, 0x78, 0x56, 0x34, 0x12]);
+        assert_eq!(report[5..21], [0xaa; CHUNK_DATA_SIZE]);
+        let crc = crc16_ccitt_false(&report[1..21]);
+        assert_eq!(report[21..], crc.to_le_bytes());
+    }
+
+    #[test]
+    fn test_chunk_data_padding() {
+        let image = test_image(20);
+        assert_eq!(chunk_data(&image, 0)[..], image[..16]);
+        assert_eq!(chunk_data(&image, 16)[..4], image[16..]);
+        assert_eq!(chunk_data(&image, 16)[4..], [0xff; 12]);
+    }
+
+    #[test]
+    fn test_update() {
+        let device = SimulatedDevice::default();
+        let image = test_image(10_000);
+        let mut confirmed = 0;
+        update(&device, &image, false, |offset| confirmed = offset).unwrap();
+        assert_eq!(device.received_image(), image);
+        assert_eq!(confirmed as usize, image.len().div_ceil(CHUNK_DATA_SIZE) * CHUNK_DATA_SIZE);
+        // every chunk is written once, plus the finishing one
+        assert_eq!(device.state.borrow().num_writes, image.len().div_ceil(CHUNK_DATA_SIZE) + 1);
+    }
+
+    #[test]
+    fn test_update_with_lost_chunks() {
+        let device = SimulatedDevice {
+            drop_writes: vec![3, 300, 301, 625],
+            fail_writes: vec![100, 626],
+            ..Default::default()
+        };
+        let image = test_image(10_000);
+        update(&device, &image, false, |_| {}).unwrap();
+        assert_eq!(device.received_image(), image);
+    }
+
+    #[test]
+    fn test_update_resume() {
+        let image = test_image(10_000);
+        let device = SimulatedDevice {
+            disconnect_after: Some(199),
+            ..Default::default()
+        };
+        assert!(update(&device, &image, false, |_| {}).is_err());
+        assert_eq!(device.state.borrow().offset, 200 * CHUNK_DATA_SIZE as u32);
+
+        // reconnected, the update continues where it stopped
+        let device = SimulatedDevice {
+            state: device.state,
+            ..Default::default()
+        };
+        let writes_before = device.state.borrow().num_writes;
+        update(&device, &image, true, |_| {}).unwrap();
+        assert_eq!(device.received_image(), image);
+        assert_eq!(
+            device.state.borrow().num_writes - writes_before,
+            image.len().div_ceil(CHUNK_DATA_SIZE) - 200 + 1
+        );
+    }
+
+    #[test]
+    fn test_update_without_resume_starts_over() {
+        let image = test_image(1000);
+        let device = SimulatedDevice::default();
+        update(&device, &test_image(2000)[1000..], false, |_| {}).unwrap();
+        update(&device, &image, false, |_| {}).unwrap();
+        assert_eq!(device.received_image(), image);
+    }
+
+    #[test]
+    fn test_update_after_error() {
+        let device = SimulatedDevice::default();
+        device.state.borrow_mut().state = 3;
+        let image = test_image(1000);
+        // error from a previous update is cleared by starting over
+        update(&device, &image, true, |_| {}).unwrap();
+        assert_eq!(device.received_image(), image);
+    }
+
+    #[test]
+    fn test_update_gives_up() {
+        let device = SimulatedDevice {
+            disconnect_after: Some(10),
+            ..Default::default()
+        };
+        assert!(update(&device, &test_image(1000), false, |_| {}).is_err());
+    }
+}
@@ -0,0 +1,219 @@
+//! Shell of the nRF, tunneled through the application channel of the AVR.
+//!
+//! Command lines are written as feature reports, which the AVR forwards to the nRF over SPI
+//! (see `avr_link.h`). The shell output comes back in replies queued on the AVR, read as feature
+//! reports as well. A reply of zero size means there is nothing to read at the moment. Since the
+//! output is a plain text stream, a command is considered complete when the shell prompt is printed.
+
+use anyhow::{ensure, Result};
+use std::{
+    thread,
+    time::{Duration, Instant},
+};
+
+use crate::communicator::AppCommunicator;
+
+/// HID report ID of the channel, see `HID_REPORTID_APP_CHANNEL` in AVR `descriptors.h`.
+const REPORT_ID: u8 = 10;
+
+/// Maximum size of message data, see `AVR_LINK_APP_MESSAGE_MAX_SIZE`.
+pub const MESSAGE_MAX_SIZE: usize = 22;
+
+/// Size of channel report: report ID, message size and data.
+pub const REPORT_SIZE: usize = 1 + 1 + MESSAGE_MAX_SIZE;
+
+/// Printed by the nRF shell when it's ready for the next command, see `shell/avr_backend.c`.
+const PROMPT: &[u8] = b"usb:~$ ";
+
+/// Delay between polls while the nRF has nothing to say.
+const POLL_INTERVAL: Duration = Duration::from_millis(2);
+
+/// Endpoint of the channel, implemented by the device and by simulated devices in tests.
+pub trait ChannelEndpoint {
+    /// Write a message report, blocks until the AVR accepts it.
+    fn write_message(&self, report: &[u8; REPORT_SIZE]) -> Result<()>;
+
+    /// Read the oldest reply report queued on the AVR.
+    fn read_reply(&self) -> Result<[u8; REPORT_SIZE]>;
+}
+
+impl ChannelEndpoint for AppCommunicator {
+    fn write_message(&self, report: &[u8; REPORT_SIZE]) -> Result<()> {
+        self.device.send_feature_report(report)?;
+        Ok(())
+    }
+
+    fn read_reply(&self) -> Result<[u8; REPORT_SIZE]> {
+        let mut buf = [0u8; REPORT_SIZE];
+        buf[0] = REPORT_ID;
+        let size = self.device.get_feature_report(&mut buf)?;
+        ensure!(size == REPORT_SIZE, "short reply report");
+        Ok(buf)
+    }
+}
+
+/// Split `data` into message reports.
+fn message_reports(data: &[u8]) -> impl Iterator<Item = [u8; REPORT_SIZE]> + '_ {
+    data.chunks(MESSAGE_MAX_SIZE).map(|chunk| {
+        let mut report = [0u8; REPORT_SIZE];
+        report[0] = REPORT_ID;
+        report[1] = chunk.len() as u8;
+        report[2..2 + chunk.len()].copy_from_slice(chunk);
+        report
+    })
+}
+
+/// Read one reply, returns empty data if there is none.
+fn read_reply(endpoint: &impl ChannelEndpoint) -> Result<Vec<u8>> {
+    let report = endpoint.read_reply()?;
+    ensure!(
+        report[0] == REPORT_ID && report[1] as usize <= MESSAGE_MAX_SIZE,
+        "invalid reply report"
+    );
+    Ok(report[2..2 + report[1] as usize].to_vec())
+}
+
+/// Discard replies left from earlier (e.g. log messages or output of an interrupted command).
+fn drain(endpoint: &impl ChannelEndpoint) -> Result<()> {
+    while !read_reply(endpoint)?.is_empty() {}
+    Ok(())
+}
+
+/// Run a shell command on the nRF.
+///
+/// `output` is called with the output as it arrives, not including the prompt. If the prompt does not
+/// arrive and the nRF stays silent for `timeout`, the command is considered complete anyway.
+/// Returns the number of output bytes received.
+pub fn run_command(
+    endpoint: &impl ChannelEndpoint,
+    command: &str,
+    timeout: Duration,
+    mut output: impl FnMut(&[u8]),
+) -> Result<usize> {
+    drain(endpoint)?;
+    for report in message_reports(format!("{command}\n").as_bytes()) {
+        endpoint.write_message(&report)?;
+    }
+
+    // the tail which may be the beginning of the prompt is held back until more output arrives
+    let mut pending = Vec::new();
+    let mut num_received = 0;
+    let mut last_reply = Instant::now();
+    loop {
+        let data = read_reply(endpoint)?;
+        if data.is_empty() {
+            if last_reply.elapsed() > timeout {
+                output(&pending);
+                return Ok(num_received + pending.len());
+            }
+            thread::sleep(POLL_INTERVAL);
+            continue;
+        }
+        last_reply = Instant::now();
+        pending.extend_from_slice(&data);
+        if pending.ends_with(PROMPT) {
+            pending.truncate(pending.len() - PROMPT.len());
+            output(&pending);
+            return Ok(num_received + pending.len());
+        }
+        let keep = (1..PROMPT.len().min(pending.len() + 1))
+            .rev()
+            .find(|&size| pending.ends_with(&PROMPT[..size]))
+            .unwrap_or(0);
+        let ready = pending.len() - keep;
+        output(&pending[..ready]);
+        num_received += ready;
+        pending.drain(..ready);
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use std::{cell::RefCell, collections::VecDeque};
+
+    use super::*;
+
+    /// Simulated AVR and nRF shell, answering each command with the given output in replies.
+    struct SimulatedShell {
+        input: RefCell<Vec<u8>>,
+        replies: RefCell<VecDeque<Vec<u8>>>,
+        output: Vec<u8>,
+    }
+
+    impl SimulatedShell {
+        fn new(output: &[u8], stale: &[&[u8]]) -> Self {
+            SimulatedShell {
+                input: RefCell::default(),
+                replies: RefCell::new(stale.iter().map(|reply| reply.to_vec()).collect()),
+                output: output.to_vec(),
+            }
+        }
+    }
+
+    impl ChannelEndpoint for SimulatedShell {
+        fn write_message(&self, report: &[u8; REPORT_SIZE]) -> Result<()> {
+            assert_eq!(report[0], REPORT_ID);
+            let mut input = self.input.borrow_mut();
+            input.extend_from_slice(&report[2..2 + report[1] as usize]);
+            if input.ends_with(b"\n") {
+                let mut replies = self.replies.borrow_mut();
+                for chunk in self.output.chunks(5) {
+                    replies.push_back(chunk.to_vec());
+                }
+            }
+            Ok(())
+        }
+
+        fn read_reply(&self) -> Result<[u8; REPORT_SIZE]> {
+            let mut report = [0u8; REPORT_SIZE];
+            report[0] = REPORT_ID;
+            if let Some(reply) = self.replies.borrow_mut().pop_front() {
+                report[1] = reply.len() as u8;
+                report[2..2 + reply.len()].copy_from_slice(&reply);
+            }
+            Ok(report)
+        }
+    }
+
+    fn run(shell: &SimulatedShell, command: &str) -> Vec<u8> {
+        let mut output = Vec::new();
+        let size = run_command(shell, command, Duration::from_millis(20), |data| {
+            output.extend_from_slice(data)
+        })
+        .unwrap();
+        assert_eq!(size, output.len());
+        output
+    }
+
+    #[test]
+    fn test_message_reports() {
+        let data: Vec<u8> = (0..50).collect();
+        let reports: Vec<_> = message_reports(&data).collect();
+        assert_eq!(reports.len(), 3);
+        assert_eq!(reports[0][..2], [REPORT_ID, MESSAGE_MAX_SIZE as u8]);
+        assert_eq!(reports[0][2..], data[..22]);
+        assert_eq!(reports[2][..2], [REPORT_ID, 6]);
+        assert_eq!(reports[2][2..8], data[44..]);
+        assert_eq!(reports[2][8..], [0; 16]);
+    }
+
+    #[test]
+    fn test_run_command() {
+        let shell = SimulatedShell::new(b"\r\nspi stats\r\ntransactions: 42\r\nusb:~$ ", &[b"stale log\r\n"]);
+        let command = "platform spi stats with a command line longer than a message";
+        assert_eq!(run(&shell, command), b"\r\nspi stats\r\ntransactions: 42\r\n");
+        assert_eq!(*shell.input.borrow(), format!("{command}\n").as_bytes());
+    }
+
+    #[test]
+    fn test_run_command_prompt_prefix_in_output() {
+        let shell = SimulatedShell::new(b"usb:~ is not the prompt\r\nusb:~$ ", &[]);
+        assert_eq!(run(&shell, "x"), b"usb:~ is not the prompt\r\n");
+    }
+
+    #[test]
+    fn test_run_command_timeout() {
+        let shell = SimulatedShell::new(b"no prompt usb:~", &[]);
+        assert_eq!(run(&shell, "x"), b"no prompt usb:~");
+    }
+}
@@ -0,0 +1,151 @@
+#include "avr_link.h"
+
+#include <string.h>
+
+#ifdef __AVR__
+#include <avr/pgmspace.h>
+#define CRC_TABLE_ATTR PROGMEM
+#define CRC_TABLE_READ(idx) pgm_read_word(&crc16_table[idx])
+#else
+#define CRC_TABLE_ATTR
+#define CRC_TABLE_READ(idx) crc16_table[idx]
+#endif
+
+#define PAYLOAD_SIZE(frame) ((frame)[2])
+
+// CRC of each nibble value, small enough for AVR flash while avoiding bit-by-bit loop
+static const uint16_t crc16_table[16] CRC_TABLE_ATTR = {
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+    0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF,
+};
+
+uint16_t avr_link_crc16(const uint8_t* data, uint8_t size) {
+    uint16_t crc = 0xFFFF;
+    while (size--) {
+        uint8_t byte = *data++;
+        crc = (crc << 4) ^ CRC_TABLE_READ((crc >> 12) ^ (byte >> 4));
+        crc = (crc << 4) ^ CRC_TABLE_READ((crc >> 12) ^ (byte & 0x0F));
+    }
+    return crc;
+}
+
+void avr_link_frame_init(uint8_t* frame, uint8_t seq, uint8_t ack) {
+    frame[0] = seq;
+    frame[1] = ack;
+    PAYLOAD_SIZE(frame) = 0;
+}
+
+uint8_t avr_link_frame_space(const uint8_t* frame) {
+    uint8_t free = AVR_LINK_FRAME_MAX_PAYLOAD - PAYLOAD_SIZE(frame);
+    return free > AVR_LINK_MESSAGE_HEADER_SIZE ? free - AVR_LINK_MESSAGE_HEADER_SIZE : 0;
+}
+
+bool avr_link_frame_add(uint8_t* frame, uint8_t type, const void* data, uint8_t size) {
+    if (size > avr_link_frame_space(frame)) {
+        return false;
+    }
+    uint8_t* message = frame + AVR_LINK_FRAME_HEADER_SIZE + PAYLOAD_SIZE(frame);
+    message[0] = type;
+    message[1] = size;
+    memcpy(message + AVR_LINK_MESSAGE_HEADER_SIZE, data, size);
+    PAYLOAD_SIZE(frame) += AVR_LINK_MESSAGE_HEADER_SIZE + size;
+    return true;
+}
+
+uint8_t avr_link_frame_finish(uint8_t* frame) {
+    uint8_t size = AVR_LINK_FRAME_HEADER_SIZE + PAYLOAD_SIZE(frame);
+    uint16_t crc = avr_link_crc16(frame, size);
+    frame[size] = crc & 0xFF;
+    frame[size + 1] = crc >> 8;
+    return size + AVR_LINK_FRAME_CRC_SIZE;
+}
+
+bool avr_link_frame_check(const uint8_t* frame, uint8_t size) {
+    if (size < AVR_LINK_FRAME_OVERHEAD || PAYLOAD_SIZE(frame) > size - AVR_LINK_FRAME_OVERHEAD) {
+        return false;
+    }
+    uint8_t crc_offset = AVR_LINK_FRAME_HEADER_SIZE + PAYLOAD_SIZE(frame);
+    uint16_t crc = frame[crc_offset] | (frame[crc_offset + 1] << 8);
+    return crc == avr_link_crc16(frame, crc_offset);
+}
+
+bool avr_link_frame_next(const uint8_t* frame, uint8_t* offset, uint8_t* type, const uint8_t** data, uint8_t* size) {
+    const uint8_t* payload = frame + AVR_LINK_FRAME_HEADER_SIZE;
+    if (*offset + AVR_LINK_MESSAGE_HEADER_SIZE > PAYLOAD_SIZE(frame)) {
+        return false;
+    }
+    *type = payload[*offset];
+    *size = payload[*offset + 1];
+    *data = payload + *offset + AVR_LINK_MESSAGE_HEADER_SIZE;
+    *offset += AVR_LINK_MESSAGE_HEADER_SIZE + *size;
+    // a malformed message must not point past the payload
+    return *offset <= PAYLOAD_SIZE(frame);
+}
+
+bool avr_link_rx_accept(uint8_t* rx_seq, const uint8_t* frame, uint8_t size) {
+    if (!avr_link_frame_check(frame, size) || avr_link_frame_seq(frame) != (uint8_t) (*rx_seq + 1)) {
+        return false;
+    }
+    *rx_seq = avr_link_frame_seq(frame);
+    return true;
+}
+
+#define TX_WINDOW_FRAME(window, idx) ((window)->frames[((window)->head + (idx)) % AVR_LINK_TX_WINDOW_SIZE])
+
+void avr_link_tx_window_init(struct avr_link_tx_window* window) {
+    window->head = 0;
+    window->num_frames = 0;
+    window->num_sent = 0;
+    window->first_seq = 0;
+    window->is_synced = false;
+}
+
+bool avr_link_tx_window_pending(struct avr_link_tx_window* window) {
+    if (window->num_frames == AVR_LINK_TX_WINDOW_SIZE && window->num_sent == AVR_LINK_TX_WINDOW_SIZE) {
+        // acks keep getting lost, resend the frames to get one
+        window->num_sent = 0;
+    }
+    return window->num_sent < window->num_frames;
+}
+
+void avr_link_tx_window_push(struct avr_link_tx_window* window, const uint8_t* frame) {
+    memcpy(TX_WINDOW_FRAME(window, window->num_frames), frame, AVR_LINK_FRAME_HEADER_SIZE + PAYLOAD_SIZE(frame));
+    window->num_frames++;
+}
+
+const uint8_t* avr_link_tx_window_next(struct avr_link_tx_window* window, uint8_t ack, uint8_t* size) {
+    uint8_t* frame = TX_WINDOW_FRAME(window, window->num_sent);
+    frame[0] = window->first_seq + window->num_sent;
+    frame[1] = ack;
+    *size = avr_link_frame_finish(frame);
+    return frame;
+}
+
+void avr_link_tx_window_sent(struct avr_link_tx_window* window) {
+    window->num_sent++;
+}
+
+bool avr_link_tx_window_ack(struct avr_link_tx_window* window, uint8_t ack) {
+    if (!window->is_synced) {
+        // ack is the sequence number of whatever the AVR received last, so it tells nothing about our frames
+        window->is_synced = true;
+        window->num_sent = 0;
+        window->first_seq = ack + 1;
+        return true;
+    }
+    // frames after the ones being resent have been sent before the rewind, so they can be acknowledged too
+    uint8_t num_acked = ack - window->first_seq + 1;
+    if (num_acked <= window->num_frames) {
+        window->head = (window->head + num_acked) % AVR_LINK_TX_WINDOW_SIZE;
+        window->num_frames -= num_acked;
+        window->num_sent = window->num_sent > num_acked ? window->num_sent - num_acked : 0;
+        window->first_seq = ack + 1;
+    }
+    // the AVR has processed every frame but the last one before preparing its frame
+    if (window->num_sent <= 1 && window->first_seq == (uint8_t) (ack + 1)) {
+        return false;
+    }
+    window->num_sent = 0;
+    window->first_seq = ack + 1;
+    return true;
+}
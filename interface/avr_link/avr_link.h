@@ -0,0 +1,239 @@
+#pragma once
+
+/* Framed protocol between nRF (SPI master) and AVR (SPI slave).
+ *
+ * Each transaction (CS window) consists of a 2-byte handshake and a full-duplex exchange of one frame
+ * in each direction. A frame carries any number of typed messages:
+ *
+ *   | seq | ack | payload size | payload (messages) | CRC-16 (LE) |
+ *
+ * where each message is | type | size | data |. The sequence number is incremented with each frame sent,
+ * ack is the sequence number of the last valid frame received from the other side, so that a lost frame
+ * is detected by its sender. Bytes clocked after the end of a frame are ignored.
+ *
+ * AVR frame is prepared before the transaction, master frame is processed by AVR after CS goes high.
+ * The AVR thus acknowledges each master frame in the next transaction.
+ *
+ * Master frames are delivered reliably: the AVR accepts them in sequence only (see @ref avr_link_rx_accept),
+ * and the master keeps each frame until it's acknowledged (see struct avr_link_tx_window). When a frame
+ * is lost, the ones sent after it are discarded by the AVR, and the master resends all of them in order.
+ * AVR frames are not resent, they carry the current status and messages the host can repeat.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define AVR_LINK_VERSION 7
+
+#define AVR_LINK_HANDSHAKE_TX 0x42  // sent by master, followed by AVR_LINK_VERSION
+#define AVR_LINK_HANDSHAKE_RX 0x43  // response from AVR
+#define AVR_LINK_HANDSHAKE_SIZE 2
+
+#define AVR_LINK_FRAME_MAX_SIZE      32
+#define AVR_LINK_FRAME_HEADER_SIZE   3
+#define AVR_LINK_FRAME_CRC_SIZE      2
+#define AVR_LINK_FRAME_OVERHEAD      (AVR_LINK_FRAME_HEADER_SIZE + AVR_LINK_FRAME_CRC_SIZE)
+#define AVR_LINK_FRAME_MAX_PAYLOAD   (AVR_LINK_FRAME_MAX_SIZE - AVR_LINK_FRAME_OVERHEAD)
+#define AVR_LINK_MESSAGE_HEADER_SIZE 2
+
+enum avr_link_message_type {
+    // master to AVR
+    AVR_LINK_MSG_REPORT = 0x01,      // report ID followed by report data
+    AVR_LINK_MSG_DESCRIPTOR = 0x02,  // offset followed by a chunk of report descriptor
+    AVR_LINK_MSG_ENABLE_USB = 0x03,  // 1 byte, non-zero to enable USB controller
+    AVR_LINK_MSG_DFU_STATUS = 0x04,  // struct avr_link_dfu_status, sent after each DFU chunk
+    AVR_LINK_MSG_APP_REPLY = 0x05,   // application message for USB host, see AVR_LINK_STATUS_REPLY_SLOTS_MASK
+    AVR_LINK_MSG_WAKEUP = 0x06,      // no data, wake up suspended host, see AVR_LINK_STATUS_REMOTE_WAKEUP
+
+    // AVR to master
+    AVR_LINK_MSG_STATUS = 0x81,     // status bits, always present
+    AVR_LINK_MSG_DEVICE_ID = 0x82,  // 3 signature bytes, sent until master acknowledges a frame
+    AVR_LINK_MSG_APP = 0x83,        // application message, see AVR_LINK_STATUS_MESSAGE_PENDING
+    AVR_LINK_MSG_REPORT_STATS = 0x84,  // struct avr_link_report_stats, sent with IRQ asserted when changed
+    AVR_LINK_MSG_DFU_CHUNK = 0x85,     // struct avr_link_dfu_chunk, see AVR_LINK_STATUS_MESSAGE_PENDING
+    AVR_LINK_MSG_DESCRIPTOR_HASH = 0x86,  // avr_link_crc16 of report descriptor in use, sent along with device ID
+};
+
+#define AVR_LINK_STATUS_REPORT_QUEUE_READY (1 << 0)  // report queue can accept reports without merging them
+#define AVR_LINK_STATUS_USB_CONFIGURED     (1 << 1)  // host has configured the device
+#define AVR_LINK_STATUS_MESSAGE_PENDING    (1 << 2)  // frame contains an application message or a DFU chunk
+#define AVR_LINK_STATUS_REPLY_SLOTS_MASK   (3 << 3)  // number of application replies the AVR can still queue
+#define AVR_LINK_STATUS_REPLY_SLOTS_SHIFT  3
+#define AVR_LINK_STATUS_USB_SUSPENDED      (1 << 5)  // host has suspended the bus, it stays configured meanwhile
+#define AVR_LINK_STATUS_REMOTE_WAKEUP      (1 << 6)  // host allows to be woken up from suspend
+
+/* Application channel between USB host and the master, tunneled through the AVR.
+ *
+ * The host writes messages as feature reports, the AVR forwards each of them in a frame once the previous one
+ * is delivered (and NAKs the host meanwhile), the same way as DFU chunks, which share the buffer with messages.
+ * The master answers with any number of replies, which the AVR queues for the host to read as feature reports.
+ * The AVR reports free queue slots in its status. Since the status is prepared before the master frame is
+ * clocked in, a reply sent in the last frame is not accounted for in it yet.
+ */
+
+// a message takes the rest of a frame after status
+#define AVR_LINK_APP_MESSAGE_MAX_SIZE (AVR_LINK_FRAME_MAX_PAYLOAD - 2 * AVR_LINK_MESSAGE_HEADER_SIZE - 1)
+
+/**
+ * @brief Counters of the AVR report queue, wrapping around.
+ */
+struct __attribute__((__packed__)) avr_link_report_stats {
+    uint16_t busy;       // reports queued because the IN endpoint was busy
+    uint16_t overflows;  // reports merged into (or dropped from) a full queue
+};
+
+/* Firmware update of the master, streamed by USB host through the AVR.
+ *
+ * The host writes chunks as output reports, the AVR forwards each of them in a frame once the previous one
+ * is delivered (and NAKs the host meanwhile). The master writes chunks in order, a chunk at any other offset
+ * is ignored, as well as a chunk with invalid CRC. Offset 0 starts a new update. The master replies with its
+ * status, which the AVR keeps for the host to read as a feature report. The host can thus detect missing
+ * chunks and resume from the offset reported, even after an interruption.
+ */
+
+#define AVR_LINK_DFU_CHUNK_DATA_SIZE 16
+#define AVR_LINK_DFU_OFFSET_FINISH   0xFFFFFFFF  // chunk offset finishing the update, data holds image size
+
+/**
+ * @brief Chunk of firmware image.
+ */
+struct __attribute__((__packed__)) avr_link_dfu_chunk {
+    uint32_t offset;
+    uint8_t data[AVR_LINK_DFU_CHUNK_DATA_SIZE];
+    uint16_t crc;  // avr_link_crc16 of the preceding fields
+};
+
+enum avr_link_dfu_state {
+    AVR_LINK_DFU_IDLE = 0,
+    AVR_LINK_DFU_RECEIVING = 1,  // chunks are being written
+    AVR_LINK_DFU_DONE = 2,       // image finished, master reboots to install it
+    AVR_LINK_DFU_ERROR = 3,      // writing failed, update must be started over
+};
+
+/**
+ * @brief Firmware update status of the master.
+ */
+struct __attribute__((__packed__)) avr_link_dfu_status {
+    uint8_t state;    // enum avr_link_dfu_state
+    uint32_t offset;  // offset of the next chunk expected
+};
+
+// size of AVR frame carrying only status
+#define AVR_LINK_STATUS_FRAME_SIZE (AVR_LINK_FRAME_OVERHEAD + AVR_LINK_MESSAGE_HEADER_SIZE + 1)
+
+/**
+ * @brief Compute CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF) using a nibble lookup table.
+ */
+uint16_t avr_link_crc16(const uint8_t* data, uint8_t size);
+
+/**
+ * @brief Start a new frame in @p frame buffer (@ref AVR_LINK_FRAME_MAX_SIZE bytes).
+ */
+void avr_link_frame_init(uint8_t* frame, uint8_t seq, uint8_t ack);
+
+/**
+ * @brief Append a message to the frame. Returns false if it does not fit.
+ */
+bool avr_link_frame_add(uint8_t* frame, uint8_t type, const void* data, uint8_t size);
+
+/**
+ * @brief Get number of bytes that can still be added as message data, not including message header.
+ */
+uint8_t avr_link_frame_space(const uint8_t* frame);
+
+/**
+ * @brief Append CRC to the frame and return its total size.
+ */
+uint8_t avr_link_frame_finish(uint8_t* frame);
+
+/**
+ * @brief Validate frame received into buffer of @p size bytes.
+ */
+bool avr_link_frame_check(const uint8_t* frame, uint8_t size);
+
+static inline uint8_t avr_link_frame_seq(const uint8_t* frame) {
+    return frame[0];
+}
+
+static inline uint8_t avr_link_frame_ack(const uint8_t* frame) {
+    return frame[1];
+}
+
+/**
+ * @brief Iterate over messages of a valid frame.
+ *
+ * @param offset Iteration state, must be initialized to 0
+ * @return false when there are no more messages
+ */
+bool avr_link_frame_next(const uint8_t* frame, uint8_t* offset, uint8_t* type, const uint8_t** data, uint8_t* size);
+
+/**
+ * @brief Validate a received frame and check that it follows the last accepted one.
+ *
+ * Used by the AVR for master frames. Updates @p rx_seq if the frame is accepted.
+ */
+bool avr_link_rx_accept(uint8_t* rx_seq, const uint8_t* frame, uint8_t size);
+
+// maximum number of master frames stored until acknowledged
+#define AVR_LINK_TX_WINDOW_SIZE 4
+
+/**
+ * @brief Master frames which are not acknowledged by the AVR yet, oldest first.
+ *
+ * Frames are pushed without sequence number and ack, these are filled in each time a frame is (re)sent.
+ */
+struct avr_link_tx_window {
+    uint8_t frames[AVR_LINK_TX_WINDOW_SIZE][AVR_LINK_FRAME_MAX_SIZE];
+    uint8_t head;        // index of the oldest frame
+    uint8_t num_frames;  // number of frames stored
+    uint8_t num_sent;    // number of frames (from the oldest) clocked out since the last rewind
+    uint8_t first_seq;   // sequence number of the oldest frame
+    bool is_synced;      // cleared until the first ack, sequence number of the AVR is not known before
+};
+
+/**
+ * @brief Drop all frames, e.g. when the AVR (re)connects.
+ *
+ * The first ack received then only synchronizes sequence numbers with the AVR, frames sent until then
+ * are resent (if the AVR has received one of them by chance, it discards the copy as a duplicate).
+ */
+void avr_link_tx_window_init(struct avr_link_tx_window* window);
+
+/**
+ * @brief Check if a stored frame is waiting to be sent, in which case no frame should be pushed.
+ *
+ * When all stored frames are sent but the window is full, it's rewound to resend them.
+ */
+bool avr_link_tx_window_pending(struct avr_link_tx_window* window);
+
+/**
+ * @brief Store a new frame (started with @ref avr_link_frame_init) to be sent after the stored ones.
+ *
+ * Must only be called while no frame is pending.
+ */
+void avr_link_tx_window_push(struct avr_link_tx_window* window, const uint8_t* frame);
+
+/**
+ * @brief Get the next frame to send, with sequence number, @p ack and CRC filled in.
+ *
+ * Must only be called while a frame is pending.
+ *
+ * @param size Frame size
+ */
+const uint8_t* avr_link_tx_window_next(struct avr_link_tx_window* window, uint8_t ack, uint8_t* size);
+
+/**
+ * @brief Mark the frame returned by @ref avr_link_tx_window_next as clocked out.
+ */
+void avr_link_tx_window_sent(struct avr_link_tx_window* window);
+
+/**
+ * @brief Process ack of a valid AVR frame received along with the last frame sent.
+ *
+ * Drops acknowledged frames. If a frame before the last one sent is not acknowledged, it was lost
+ * (and the AVR has discarded the ones after it), so the window is rewound to resend them.
+ * The first ack after @ref avr_link_tx_window_init rewinds the window as well.
+ *
+ * @return true if the window was rewound
+ */
+bool avr_link_tx_window_ack(struct avr_link_tx_window* window, uint8_t ack);
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <stdbool.h>
 #include <stdint.h>
 
 #include "hid_report_map.h"
@@ -30,3 +31,34 @@ static inline void clear_non_persistent_data_in_report(struct hid_report *report
         }
     }
 }
+
+static inline int16_t sign_extend_hid_delta(uint16_t value, uint8_t num_bits) {
+    uint8_t shift = 16 - num_bits;
+    return ((int16_t) (value << shift)) >> shift;
+}
+
+/**
+ * @brief Add two deltas of given bit width, saturating the result.
+ */
+static inline int16_t add_hid_deltas(uint16_t a, uint16_t b, uint8_t num_bits) {
+    int16_t max = (1 << (num_bits - 1)) - 1;
+    int16_t sum = sign_extend_hid_delta(a, num_bits) + sign_extend_hid_delta(b, num_bits);
+    return sum > max ? max : (sum < -max ? -max : sum);
+}
+
+/**
+ * @brief Merge a newer report into an older one, so that no motion is lost.
+ *
+ * Buttons are taken from the newer report, so a click is lost if buttons differ
+ * (check with @ref can_merge_hid_reports_losslessly first).
+ */
+static inline void merge_hid_reports(struct hid_report* into, const struct hid_report* from) {
+    into->buttons = from->buttons;
+    into->wheel_delta = add_hid_deltas(into->wheel_delta, from->wheel_delta, 8);
+    into->x_delta = add_hid_deltas(into->x_delta, from->x_delta, 12);
+    into->y_delta = add_hid_deltas(into->y_delta, from->y_delta, 12);
+}
+
+static inline bool can_merge_hid_reports_losslessly(const struct hid_report* a, const struct hid_report* b) {
+    return a->buttons.v == b->buttons.v;
+}
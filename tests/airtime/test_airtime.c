@@ -0,0 +1,72 @@
+/* Tests of radio-on time estimates against values computed by hand from Core spec Vol 6, Part B, 2.1.
+ *
+ * An encrypted data PDU is 1 (1M) or 2 (2M) bytes of preamble, 4 bytes of access address, 2 bytes of header,
+ * the payload, 4 bytes of MIC if the payload is not empty and 3 bytes of CRC. The PHY sends a byte
+ * in 8 us (1M) or 4 us (2M).
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <zephyr/bluetooth/gap.h>
+
+#include "check.h"
+#include "hid_report_struct.h"
+#include "transport/bt/airtime.h"
+
+// shortest connection interval, in which a report is sent as soon as possible
+#define EVENT_LEN_US 7500
+
+static void test_pdu() {
+    // an empty PDU carries no MIC even if the link is encrypted
+    CHECK_EQ(airtime_pdu_us(BT_GAP_LE_PHY_1M, 0, true), 80);
+    CHECK_EQ(airtime_pdu_us(BT_GAP_LE_PHY_2M, 0, true), 44);
+    CHECK_EQ(airtime_pdu_us(BT_GAP_LE_PHY_1M, 27, false), 296);
+    CHECK_EQ(airtime_pdu_us(BT_GAP_LE_PHY_1M, 27, true), 328);
+    CHECK_EQ(airtime_pdu_us(BT_GAP_LE_PHY_2M, 27, true), 168);
+}
+
+static void test_report_event() {
+    // a report notification fits a PDU without data length extension
+    uint8_t payload_size = AIRTIME_NOTIFICATION_OVERHEAD + sizeof(struct hid_report);
+    CHECK_EQ(payload_size, 12);
+    CHECK(payload_size <= AIRTIME_LL_DEFAULT_MAX_PAYLOAD);
+
+    // empty central PDU, T_IFS, report PDU
+    CHECK_EQ(airtime_event_us(BT_GAP_LE_PHY_1M, payload_size, 1), 80 + 150 + 208);
+    CHECK_EQ(airtime_event_us(BT_GAP_LE_PHY_1M, payload_size, 1), 438);
+    CHECK_EQ(airtime_event_us(BT_GAP_LE_PHY_2M, payload_size, 1), 44 + 150 + 108);
+    CHECK_EQ(airtime_event_us(BT_GAP_LE_PHY_2M, payload_size, 1), 302);
+
+    // further exchanges are separated by T_IFS
+    CHECK_EQ(airtime_event_us(BT_GAP_LE_PHY_1M, payload_size, 2), 2 * 438 + 150);
+    CHECK_EQ(airtime_event_us(BT_GAP_LE_PHY_2M, payload_size, 2), 2 * 302 + 150);
+    CHECK_EQ(airtime_event_us(BT_GAP_LE_PHY_1M, payload_size, 0), 0);
+
+    CHECK_EQ(airtime_pdus_per_event(BT_GAP_LE_PHY_1M, payload_size, EVENT_LEN_US), 13);
+    CHECK_EQ(airtime_pdus_per_event(BT_GAP_LE_PHY_2M, payload_size, EVENT_LEN_US), 16);
+}
+
+static void test_pdus_per_event_bounds() {
+    const uint8_t phys[] = {BT_GAP_LE_PHY_1M, BT_GAP_LE_PHY_2M};
+    for (uint32_t i = 0; i < sizeof(phys) / sizeof(phys[0]); i++) {
+        uint8_t phy = phys[i];
+        uint32_t one_us = airtime_event_us(phy, 12, 1);
+        CHECK_EQ(airtime_pdus_per_event(phy, 12, one_us - 1), 0);
+        CHECK_EQ(airtime_pdus_per_event(phy, 12, one_us), 1);
+
+        // the count is the largest one whose event fits
+        for (uint32_t len_us = one_us; len_us <= 20000; len_us += 37) {
+            uint32_t num_pdus = airtime_pdus_per_event(phy, 12, len_us);
+            CHECK(airtime_event_us(phy, 12, num_pdus) <= len_us);
+            CHECK(airtime_event_us(phy, 12, num_pdus + 1) > len_us);
+        }
+    }
+}
+
+int main() {
+    test_pdu();
+    test_report_event();
+    test_pdus_per_event_bounds();
+    return 0;
+}
@@ -0,0 +1,320 @@
+/* Tests of the AVR link protocol, including a loopback of both link ends.
+ *
+ * Master frames go through struct avr_link_tx_window as in app-nrf/src/services/avr_comm.c, the AVR end
+ * accepts them with avr_link_rx_accept as in app-avr/src/spi_commands.c. Transactions fail the same way
+ * they do on the bus: the handshake is not answered (nothing is clocked), or a frame is corrupted
+ * in either direction. Each master frame carries a counter, which the AVR end must receive exactly once
+ * and in order.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "avr_link.h"
+#include "check.h"
+
+#define MSG_COUNTER AVR_LINK_MSG_REPORT
+
+enum fault {
+    FAULT_NONE,
+    FAULT_HANDSHAKE,     // AVR is busy or gone, no frame is clocked
+    FAULT_MASTER_FRAME,  // master frame is corrupted, AVR discards it
+    FAULT_AVR_FRAME,     // AVR frame is corrupted, master does not get the ack
+    FAULT_BOTH_FRAMES,
+    NUM_FAULTS,
+};
+
+struct master_end {
+    struct avr_link_tx_window window;
+    uint8_t rx_seq;
+    uint32_t num_pushed;
+    uint32_t num_rewinds;
+};
+
+struct avr_end {
+    uint8_t tx_seq;
+    uint8_t rx_seq;
+    uint32_t num_received;  // counters received in order
+};
+
+static void avr_process_frame(struct avr_end* avr, const uint8_t* frame, uint8_t size) {
+    if (!avr_link_rx_accept(&avr->rx_seq, frame, size)) {
+        return;
+    }
+    uint8_t offset = 0, type, data_size;
+    const uint8_t* data;
+    while (avr_link_frame_next(frame, &offset, &type, &data, &data_size)) {
+        if (type == MSG_COUNTER) {
+            uint32_t counter;
+            CHECK_EQ(data_size, sizeof(counter));
+            memcpy(&counter, data, sizeof(counter));
+            CHECK_EQ(counter, avr->num_received);
+            avr->num_received++;
+        }
+    }
+}
+
+/**
+ * @brief Push a frame with the next counter unless there is a frame to resend, like avr_comm_loop does.
+ *
+ * Once @p num_counters are pushed, frames with no messages are pushed instead, to get the acks.
+ */
+static void master_push(struct master_end* master, uint32_t num_counters) {
+    if (avr_link_tx_window_pending(&master->window)) {
+        return;
+    }
+    uint8_t frame[AVR_LINK_FRAME_MAX_SIZE];
+    avr_link_frame_init(frame, 0, 0);
+    if (master->num_pushed < num_counters) {
+        CHECK(avr_link_frame_add(frame, MSG_COUNTER, &master->num_pushed, sizeof(master->num_pushed)));
+        master->num_pushed++;
+    }
+    avr_link_tx_window_push(&master->window, frame);
+}
+
+static void transaction(struct master_end* master, struct avr_end* avr, enum fault fault) {
+    // AVR frame is prepared before the transaction, after the previous master frame is processed
+    uint8_t avr_frame[AVR_LINK_FRAME_MAX_SIZE];
+    uint8_t status = 0;
+    avr_link_frame_init(avr_frame, avr->tx_seq, avr->rx_seq);
+    avr_link_frame_add(avr_frame, AVR_LINK_MSG_STATUS, &status, sizeof(status));
+    uint8_t avr_frame_size = avr_link_frame_finish(avr_frame);
+
+    uint8_t size;
+    const uint8_t* frame = avr_link_tx_window_next(&master->window, master->rx_seq, &size);
+    if (fault == FAULT_HANDSHAKE) {
+        return;
+    }
+
+    uint8_t clocked_frame[AVR_LINK_FRAME_MAX_SIZE];
+    memcpy(clocked_frame, frame, size);
+    if (fault == FAULT_MASTER_FRAME || fault == FAULT_BOTH_FRAMES) {
+        clocked_frame[size - 1] ^= 0x10;
+    }
+    if (fault == FAULT_AVR_FRAME || fault == FAULT_BOTH_FRAMES) {
+        avr_frame[AVR_LINK_FRAME_HEADER_SIZE] ^= 0x01;
+    }
+
+    avr->tx_seq++;
+    avr_link_tx_window_sent(&master->window);
+    if (avr_link_frame_check(avr_frame, avr_frame_size)) {
+        master->rx_seq = avr_link_frame_seq(avr_frame);
+        master->num_rewinds += avr_link_tx_window_ack(&master->window, avr_link_frame_ack(avr_frame));
+    }
+    avr_process_frame(avr, clocked_frame, size);
+}
+
+/**
+ * @brief Start the master end, synchronizing with the AVR end like verify_avr_id does.
+ */
+static void master_connect(struct master_end* master, struct avr_end* avr) {
+    memset(master, 0, sizeof(*master));
+    avr_link_tx_window_init(&master->window);
+    master_push(master, 0);
+    transaction(master, avr, FAULT_NONE);
+    CHECK_EQ(master->num_rewinds, 1);
+    while (avr_link_tx_window_pending(&master->window)) {
+        transaction(master, avr, FAULT_NONE);
+    }
+    master->num_rewinds = 0;
+}
+
+// linear congruential generator, so that failures are reproducible
+static uint32_t random_state;
+
+static uint32_t random_next() {
+    random_state = random_state * 1103515245 + 12345;
+    return random_state >> 16;
+}
+
+/**
+ * @brief Run transactions until all counters are received, failing each one with @p fault_percent probability.
+ */
+static void run_link(struct master_end* master, struct avr_end* avr, uint32_t num_counters, uint32_t fault_percent) {
+    uint32_t max_transactions = 100 + num_counters * 20;
+    for (uint32_t i = 0; avr->num_received < num_counters; i++) {
+        CHECK(i < max_transactions);
+        enum fault fault = FAULT_NONE;
+        if (random_next() % 100 < fault_percent) {
+            fault = 1 + random_next() % (NUM_FAULTS - 1);
+        }
+        master_push(master, num_counters);
+        transaction(master, avr, fault);
+    }
+    CHECK_EQ(avr->num_received, num_counters);
+}
+
+static void test_crc16() {
+    // check value of CRC-16/CCITT-FALSE
+    CHECK_EQ(avr_link_crc16((const uint8_t*) "123456789", 9), 0x29B1);
+    CHECK_EQ(avr_link_crc16(NULL, 0), 0xFFFF);
+}
+
+static void test_frame_roundtrip() {
+    uint8_t frame[AVR_LINK_FRAME_MAX_SIZE];
+    const uint8_t status = 0x5A;
+    const uint8_t id[] = {0x1E, 0x93, 0x89};
+
+    avr_link_frame_init(frame, 7, 3);
+    CHECK(avr_link_frame_add(frame, AVR_LINK_MSG_STATUS, &status, sizeof(status)));
+    CHECK(avr_link_frame_add(frame, AVR_LINK_MSG_DEVICE_ID, id, sizeof(id)));
+    CHECK(avr_link_frame_add(frame, AVR_LINK_MSG_WAKEUP, NULL, 0));
+    uint8_t size = avr_link_frame_finish(frame);
+    CHECK_EQ(size, AVR_LINK_FRAME_OVERHEAD + 3 * AVR_LINK_MESSAGE_HEADER_SIZE + sizeof(status) + sizeof(id));
+
+    // bytes clocked after the frame are ignored
+    CHECK(avr_link_frame_check(frame, AVR_LINK_FRAME_MAX_SIZE));
+    CHECK(avr_link_frame_check(frame, size));
+    CHECK(!avr_link_frame_check(frame, size - 1));
+    CHECK_EQ(avr_link_frame_seq(frame), 7);
+    CHECK_EQ(avr_link_frame_ack(frame), 3);
+
+    uint8_t offset = 0, type, data_size;
+    const uint8_t* data;
+    CHECK(avr_link_frame_next(frame, &offset, &type, &data, &data_size));
+    CHECK_EQ(type, AVR_LINK_MSG_STATUS);
+    CHECK_EQ(data_size, 1);
+    CHECK_EQ(data[0], status);
+    CHECK(avr_link_frame_next(frame, &offset, &type, &data, &data_size));
+    CHECK_EQ(type, AVR_LINK_MSG_DEVICE_ID);
+    CHECK(data_size == sizeof(id) && !memcmp(data, id, sizeof(id)));
+    CHECK(avr_link_frame_next(frame, &offset, &type, &data, &data_size));
+    CHECK_EQ(type, AVR_LINK_MSG_WAKEUP);
+    CHECK_EQ(data_size, 0);
+    CHECK(!avr_link_frame_next(frame, &offset, &type, &data, &data_size));
+
+    for (uint8_t i = 0; i < size; i++) {
+        frame[i] ^= 0x80;
+        CHECK(!avr_link_frame_check(frame, size));
+        frame[i] ^= 0x80;
+    }
+}
+
+static void test_frame_space() {
+    uint8_t frame[AVR_LINK_FRAME_MAX_SIZE];
+    uint8_t data[AVR_LINK_FRAME_MAX_PAYLOAD] = {};
+
+    avr_link_frame_init(frame, 0, 0);
+    CHECK_EQ(avr_link_frame_space(frame), AVR_LINK_FRAME_MAX_PAYLOAD - AVR_LINK_MESSAGE_HEADER_SIZE);
+    CHECK(!avr_link_frame_add(frame, AVR_LINK_MSG_APP, data, AVR_LINK_FRAME_MAX_PAYLOAD - 1));
+    CHECK(avr_link_frame_add(frame, AVR_LINK_MSG_APP, data, AVR_LINK_FRAME_MAX_PAYLOAD - 2));
+    CHECK_EQ(avr_link_frame_space(frame), 0);
+    CHECK_EQ(avr_link_frame_finish(frame), AVR_LINK_FRAME_MAX_SIZE);
+
+    // application message fits into a frame along with status
+    avr_link_frame_init(frame, 0, 0);
+    CHECK(avr_link_frame_add(frame, AVR_LINK_MSG_STATUS, data, 1));
+    CHECK(avr_link_frame_add(frame, AVR_LINK_MSG_APP, data, AVR_LINK_APP_MESSAGE_MAX_SIZE));
+}
+
+static void test_rx_accept_in_sequence() {
+    uint8_t frame[AVR_LINK_FRAME_MAX_SIZE];
+    uint8_t rx_seq = 255;
+
+    avr_link_frame_init(frame, 0, 0);
+    uint8_t size = avr_link_frame_finish(frame);
+    CHECK(avr_link_rx_accept(&rx_seq, frame, size));
+    CHECK_EQ(rx_seq, 0);
+    // duplicate
+    CHECK(!avr_link_rx_accept(&rx_seq, frame, size));
+    // gap
+    avr_link_frame_init(frame, 2, 0);
+    size = avr_link_frame_finish(frame);
+    CHECK(!avr_link_rx_accept(&rx_seq, frame, size));
+    CHECK_EQ(rx_seq, 0);
+    // invalid
+    avr_link_frame_init(frame, 1, 0);
+    size = avr_link_frame_finish(frame);
+    frame[1] ^= 1;
+    CHECK(!avr_link_rx_accept(&rx_seq, frame, size));
+    frame[1] ^= 1;
+    CHECK(avr_link_rx_accept(&rx_seq, frame, size));
+    CHECK_EQ(rx_seq, 1);
+}
+
+static void test_lossless_link() {
+    struct master_end master;
+    struct avr_end avr = {.rx_seq = 9};
+    master_connect(&master, &avr);
+
+    // each transaction delivers one counter, the last one is acknowledged by the next frame
+    for (uint32_t i = 0; i < 1000; i++) {
+        master_push(&master, 1000);
+        transaction(&master, &avr, FAULT_NONE);
+        CHECK_EQ(avr.num_received, i + 1);
+        CHECK_EQ(master.window.num_frames, 1);
+    }
+    CHECK_EQ(master.num_rewinds, 0);
+}
+
+static void test_single_fault(enum fault fault) {
+    struct master_end master;
+    struct avr_end avr = {.rx_seq = 255};
+    master_connect(&master, &avr);
+
+    for (uint32_t i = 0; i < 5; i++) {
+        master_push(&master, 10);
+        transaction(&master, &avr, FAULT_NONE);
+    }
+    master_push(&master, 10);
+    transaction(&master, &avr, fault);
+    run_link(&master, &avr, 10, 0);
+    // a lost master frame is detected by the ack of the next one
+    CHECK_EQ(master.num_rewinds, fault == FAULT_MASTER_FRAME || fault == FAULT_BOTH_FRAMES);
+}
+
+static void test_acks_lost() {
+    struct master_end master;
+    struct avr_end avr = {.rx_seq = 255};
+    master_connect(&master, &avr);
+
+    // master frames get through but acks don't, so the window fills up and the frames are resent
+    for (uint32_t i = 0; i < 3 * AVR_LINK_TX_WINDOW_SIZE; i++) {
+        master_push(&master, 100);
+        transaction(&master, &avr, FAULT_AVR_FRAME);
+        CHECK(master.window.num_frames <= AVR_LINK_TX_WINDOW_SIZE);
+    }
+    CHECK_EQ(avr.num_received, AVR_LINK_TX_WINDOW_SIZE);
+    run_link(&master, &avr, 100, 0);
+}
+
+static void test_resync() {
+    // the first frame carries a counter already, it's resent after the first ack synchronizes the ends
+    // (the AVR discards the copy if it has accepted the first frame, which it does when its seq happens to follow)
+    for (uint32_t avr_rx_seq = 0; avr_rx_seq < 256; avr_rx_seq += 17) {
+        struct master_end master = {};
+        struct avr_end avr = {.rx_seq = avr_rx_seq};
+        avr_link_tx_window_init(&master.window);
+        run_link(&master, &avr, 50, 0);
+        CHECK_EQ(master.num_rewinds, 1);
+    }
+}
+
+static void test_faulty_link() {
+    const uint32_t fault_percents[] = {5, 30, 60};
+    for (uint32_t seed = 1; seed <= 20; seed++) {
+        for (uint32_t i = 0; i < sizeof(fault_percents) / sizeof(fault_percents[0]); i++) {
+            struct master_end master;
+            struct avr_end avr = {.rx_seq = seed * 13};
+            random_state = seed;
+            master_connect(&master, &avr);
+            run_link(&master, &avr, 2000, fault_percents[i]);
+        }
+    }
+}
+
+int main() {
+    test_crc16();
+    test_frame_roundtrip();
+    test_frame_space();
+    test_rx_accept_in_sequence();
+    test_lossless_link();
+    for (enum fault fault = FAULT_NONE; fault < NUM_FAULTS; fault++) {
+        test_single_fault(fault);
+    }
+    test_acks_lost();
+    test_resync();
+    test_faulty_link();
+    return 0;
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/**
+ * @brief Abort the test with the failed condition and its location.
+ */
+#define CHECK(cond)                                                           \
+    do {                                                                      \
+        if (!(cond)) {                                                        \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            exit(1);                                                          \
+        }                                                                     \
+    } while (0)
+
+#define CHECK_EQ(actual, expected)                                                      \
+    do {                                                                                \
+        long long actual_ = (actual), expected_ = (expected);                           \
+        if (actual_ != expected_) {                                                     \
+            fprintf(stderr, "%s:%d: check failed: %s == %lld, expected %lld\n",         \
+                    __FILE__, __LINE__, #actual, actual_, expected_);                   \
+            exit(1);                                                                    \
+        }                                                                               \
+    } while (0)
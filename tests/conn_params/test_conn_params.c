@@ -0,0 +1,255 @@
+/* Tests of the connection parameters policy, driven by a simulated central.
+ *
+ * The simulation is stepped by 1 ms and follows app-nrf/src/transport/bt/conn_params.c: the policy is
+ * evaluated when it asks to, right after activity it reports as needing evaluation, and right after
+ * the central updates parameters. The central answers each request after a delay, either by granting
+ * parameters (of its own choice within the requested range) or by ignoring it.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "check.h"
+#include "transport/bt/conn_params.h"
+
+#define CENTRAL_RESPONSE_MS 50
+#define MAX_REQUESTS 16
+
+enum central_mode {
+    CENTRAL_GRANT_MAX,           // longest interval of the range, requested latency
+    CENTRAL_GRANT_NO_LATENCY,    // shortest interval of the range, no latency
+    CENTRAL_GRANT_OUT_OF_RANGE,  // an interval which is not in the range
+    CENTRAL_IGNORE,
+};
+
+struct request {
+    int64_t time_ms;
+    enum conn_params_profile profile;
+};
+
+struct sim {
+    struct conn_params_policy policy;
+    int64_t now_ms;
+    int64_t eval_at_ms;
+    enum central_mode central_mode;
+    int64_t response_at_ms;  // CONN_PARAMS_NEVER if no request is being processed by the central
+    enum conn_params_profile pending;
+    uint16_t interval;
+    uint16_t latency;
+    struct request requests[MAX_REQUESTS];
+    int num_requests;
+};
+
+static void sim_connect(struct sim* sim, enum central_mode mode, uint16_t interval, uint16_t latency) {
+    *sim = (struct sim) {
+        .eval_at_ms = 0,
+        .central_mode = mode,
+        .response_at_ms = CONN_PARAMS_NEVER,
+        .interval = interval,
+        .latency = latency,
+    };
+    conn_params_policy_init(&sim->policy, 0);
+    conn_params_policy_granted(&sim->policy, interval, latency);
+}
+
+static void central_respond(struct sim* sim) {
+    const struct bt_le_conn_param* param = conn_params_profile_get(sim->pending);
+    switch (sim->central_mode) {
+        case CENTRAL_GRANT_MAX:
+            sim->interval = param->interval_max;
+            sim->latency = param->latency;
+            break;
+        case CENTRAL_GRANT_NO_LATENCY:
+            sim->interval = param->interval_min;
+            sim->latency = 0;
+            break;
+        case CENTRAL_GRANT_OUT_OF_RANGE:
+            sim->interval = param->interval_max + 1;
+            sim->latency = param->latency;
+            break;
+        case CENTRAL_IGNORE:
+            return;
+    }
+    conn_params_policy_granted(&sim->policy, sim->interval, sim->latency);
+    sim->eval_at_ms = sim->now_ms;
+}
+
+static void sim_evaluate(struct sim* sim) {
+    int64_t next_eval_ms;
+    enum conn_params_profile profile = conn_params_policy_evaluate(&sim->policy, sim->now_ms, &next_eval_ms);
+    if (profile != CONN_PARAMS_NONE) {
+        CHECK(sim->num_requests < MAX_REQUESTS);
+        sim->requests[sim->num_requests++] = (struct request) {sim->now_ms, profile};
+        sim->pending = profile;
+        sim->response_at_ms = sim->now_ms + CENTRAL_RESPONSE_MS;
+    }
+    // the policy must not ask to be evaluated in the past, or it would be spinning
+    CHECK(next_eval_ms > sim->now_ms);
+    sim->eval_at_ms = next_eval_ms;
+}
+
+/**
+ * @brief Run the simulation until the time, with activity every period from start until end (if period is not 0).
+ */
+static void sim_run(struct sim* sim, int64_t until_ms,
+                    int64_t activity_start_ms, int64_t activity_end_ms, int64_t activity_period_ms) {
+    for (; sim->now_ms < until_ms; sim->now_ms++) {
+        if (sim->now_ms == sim->response_at_ms) {
+            sim->response_at_ms = CONN_PARAMS_NEVER;
+            central_respond(sim);
+        }
+        if (activity_period_ms && sim->now_ms >= activity_start_ms && sim->now_ms <= activity_end_ms &&
+            (sim->now_ms - activity_start_ms) % activity_period_ms == 0) {
+            if (conn_params_policy_activity(&sim->policy, sim->now_ms)) {
+                sim->eval_at_ms = sim->now_ms;
+            }
+        }
+        if (sim->now_ms >= sim->eval_at_ms) {
+            sim_evaluate(sim);
+        }
+    }
+}
+
+static void check_request(const struct sim* sim, int index, int64_t time_ms, enum conn_params_profile profile) {
+    CHECK(index < sim->num_requests);
+    CHECK_EQ(sim->requests[index].time_ms, time_ms);
+    CHECK_EQ(sim->requests[index].profile, profile);
+}
+
+static void test_idle_after_connect() {
+    struct sim sim;
+    // interval chosen by the central matches no profile
+    sim_connect(&sim, CENTRAL_GRANT_MAX, 48, 0);
+    CHECK_EQ(sim.policy.granted, CONN_PARAMS_NONE);
+
+    // nothing is requested while the central sets up the connection, then the user is already idle
+    sim_run(&sim, 60000, 0, 0, 0);
+    CHECK_EQ(sim.num_requests, 1);
+    check_request(&sim, 0, CONN_PARAMS_CONNECT_DELAY_MS, CONN_PARAMS_IDLE);
+    CHECK_EQ(sim.policy.granted, CONN_PARAMS_IDLE);
+    CHECK_EQ(sim.latency, CONFIG_APP_BT_CONN_IDLE_LATENCY);
+}
+
+static void test_idle_parameters_kept() {
+    struct sim sim;
+    // less latency than requested is fine
+    sim_connect(&sim, CENTRAL_GRANT_MAX, CONFIG_APP_BT_CONN_IDLE_INT_MIN, 0);
+    CHECK_EQ(sim.policy.granted, CONN_PARAMS_IDLE);
+
+    sim_run(&sim, 60000, 0, 0, 0);
+    CHECK_EQ(sim.num_requests, 0);
+}
+
+static void test_activity_during_connect_delay() {
+    struct sim sim;
+    sim_connect(&sim, CENTRAL_GRANT_MAX, 48, 0);
+
+    sim_run(&sim, 10000, 1000, 8000, 8);
+    CHECK_EQ(sim.num_requests, 1);
+    check_request(&sim, 0, CONN_PARAMS_CONNECT_DELAY_MS, CONN_PARAMS_ACTIVE);
+    CHECK_EQ(sim.policy.granted, CONN_PARAMS_ACTIVE);
+    CHECK_EQ(sim.interval, CONFIG_APP_BT_CONN_ACTIVE_INT_MAX);
+    CHECK_EQ(sim.latency, 0);
+}
+
+static void test_active_and_idle_transitions() {
+    struct sim sim;
+    sim_connect(&sim, CENTRAL_GRANT_MAX, 48, 0);
+    sim_run(&sim, 10000, 0, 0, 0);
+    CHECK_EQ(sim.num_requests, 1);
+    CHECK_EQ(sim.policy.granted, CONN_PARAMS_IDLE);
+
+    // the first report switches to active right away, further reports don't cause requests
+    sim_run(&sim, 30000, 10000, 20000, 8);
+    CHECK_EQ(sim.num_requests, 3);
+    check_request(&sim, 1, 10000, CONN_PARAMS_ACTIVE);
+    // idle delay counts from the last report
+    check_request(&sim, 2, 20000 + CONFIG_APP_BT_CONN_IDLE_DELAY_MS, CONN_PARAMS_IDLE);
+    CHECK_EQ(sim.policy.granted, CONN_PARAMS_IDLE);
+
+    // short bursts of activity, each one switching to active and back to idle
+    sim_run(&sim, 60000, 40000, 40000, 1);
+    sim_run(&sim, 90000, 70000, 70100, 10);
+    CHECK_EQ(sim.num_requests, 7);
+    check_request(&sim, 3, 40000, CONN_PARAMS_ACTIVE);
+    check_request(&sim, 4, 40000 + CONFIG_APP_BT_CONN_IDLE_DELAY_MS, CONN_PARAMS_IDLE);
+    check_request(&sim, 5, 70000, CONN_PARAMS_ACTIVE);
+    check_request(&sim, 6, 70100 + CONFIG_APP_BT_CONN_IDLE_DELAY_MS, CONN_PARAMS_IDLE);
+}
+
+static void test_activity_while_request_pending() {
+    struct sim sim;
+    sim_connect(&sim, CENTRAL_GRANT_MAX, 48, 0);
+    sim_run(&sim, 10000, 0, 0, 0);
+
+    // activity goes on while the central processes the active request, no duplicate request is made
+    sim_run(&sim, 11000, 10000, 11000, 1);
+    CHECK_EQ(sim.num_requests, 2);
+    check_request(&sim, 1, 10000, CONN_PARAMS_ACTIVE);
+    CHECK_EQ(sim.policy.granted, CONN_PARAMS_ACTIVE);
+}
+
+static void test_no_latency_granted() {
+    struct sim sim;
+    sim_connect(&sim, CENTRAL_GRANT_NO_LATENCY, 48, 0);
+
+    // the central does not allow latency, idle interval alone is accepted as the idle profile
+    sim_run(&sim, 60000, 0, 0, 0);
+    CHECK_EQ(sim.num_requests, 1);
+    CHECK_EQ(sim.policy.granted, CONN_PARAMS_IDLE);
+    CHECK_EQ(sim.latency, 0);
+}
+
+static void test_request_not_granted(enum central_mode mode) {
+    struct sim sim;
+    sim_connect(&sim, mode, 48, 0);
+
+    // the same request is repeated only after the retry period
+    sim_run(&sim, 40000, 0, 0, 0);
+    CHECK_EQ(sim.num_requests, 2);
+    check_request(&sim, 0, CONN_PARAMS_CONNECT_DELAY_MS, CONN_PARAMS_IDLE);
+    check_request(&sim, 1, CONN_PARAMS_CONNECT_DELAY_MS + CONN_PARAMS_RETRY_MS, CONN_PARAMS_IDLE);
+
+    // a different profile is requested right away
+    sim_run(&sim, 80000, 40000, 80000, 8);
+    CHECK_EQ(sim.num_requests, 4);
+    check_request(&sim, 2, 40000, CONN_PARAMS_ACTIVE);
+    check_request(&sim, 3, 40000 + CONN_PARAMS_RETRY_MS, CONN_PARAMS_ACTIVE);
+    CHECK_EQ(sim.policy.granted, CONN_PARAMS_NONE);
+}
+
+static void test_active_interval_changed() {
+    struct sim sim;
+    conn_params_profile_set_interval(CONN_PARAMS_ACTIVE, 9, 9);
+    const struct bt_le_conn_param* param = conn_params_profile_get(CONN_PARAMS_ACTIVE);
+    CHECK_EQ(param->interval_min, 9);
+    CHECK_EQ(param->interval_max, 9);
+
+    // the previous active interval is no longer the active profile
+    sim_connect(&sim, CENTRAL_GRANT_MAX, CONFIG_APP_BT_CONN_ACTIVE_INT_MIN, 0);
+    CHECK_EQ(sim.policy.granted, CONN_PARAMS_NONE);
+
+    sim_run(&sim, 10000, 0, 10000, 8);
+    CHECK_EQ(sim.num_requests, 1);
+    check_request(&sim, 0, CONN_PARAMS_CONNECT_DELAY_MS, CONN_PARAMS_ACTIVE);
+    CHECK_EQ(sim.interval, 9);
+    CHECK_EQ(sim.policy.granted, CONN_PARAMS_ACTIVE);
+
+    conn_params_profile_set_interval(CONN_PARAMS_ACTIVE, CONFIG_APP_BT_CONN_ACTIVE_INT_MIN,
+                                     CONFIG_APP_BT_CONN_ACTIVE_INT_MAX);
+}
+
+int main() {
+    CHECK(conn_params_profile_get(CONN_PARAMS_NONE) == NULL);
+
+    test_idle_after_connect();
+    test_idle_parameters_kept();
+    test_activity_during_connect_delay();
+    test_active_and_idle_transitions();
+    test_activity_while_request_pending();
+    test_no_latency_granted();
+    test_request_not_granted(CENTRAL_IGNORE);
+    test_request_not_granted(CENTRAL_GRANT_OUT_OF_RANGE);
+    test_active_interval_changed();
+    return 0;
+}
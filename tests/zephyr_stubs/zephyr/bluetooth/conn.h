@@ -0,0 +1,14 @@
+#pragma once
+
+#include <stdint.h>
+
+/* Subset of the Zephyr BT connection API used by the code under test. */
+
+struct bt_conn;
+
+struct bt_le_conn_param {
+    uint16_t interval_min;
+    uint16_t interval_max;
+    uint16_t latency;
+    uint16_t timeout;
+};
@@ -0,0 +1,10 @@
+#pragma once
+
+/* Subset of Zephyr GAP definitions used by the code under test. */
+
+enum {
+    BT_GAP_LE_PHY_NONE = 0,
+    BT_GAP_LE_PHY_1M = 1 << 0,
+    BT_GAP_LE_PHY_2M = 1 << 1,
+    BT_GAP_LE_PHY_CODED = 1 << 2,
+};
@@ -0,0 +1,10 @@
+#pragma once
+
+/* Subset of Zephyr utilities used by the code under test. */
+
+#define BUILD_ASSERT(cond, msg) _Static_assert(cond, msg)
+
+#define ARRAY_SIZE(array) (sizeof(array) / sizeof((array)[0]))
+
+#define MIN(a, b) (((a) < (b)) ? (a) : (b))
+#define MAX(a, b) (((a) > (b)) ? (a) : (b))